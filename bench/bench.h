@@ -0,0 +1,20 @@
+/***
+ * bench.h
+ *
+ * Timing helpers shared by the benchmarks, see the benchmark targets in meson.build.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+
+#define BENCH_RUNS 5 // every measurement is the best of this many runs
+
+static inline double bench_now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec * 1e3 + (double) t.tv_nsec / 1e6;
+}
+
+#endif // BENCH_H
@@ -0,0 +1,119 @@
+/**
+ * Lexes identifier-heavy inputs and reports the cost per token, which is dominated by telling keywords apart from
+ * identifiers and interning the identifiers. Each input is whitespace separated words written to a temporary file,
+ * and the number of keywords the lexer finds has to match the number written.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/abc_lexer.h"
+#include "bench.h"
+
+#define NUM_WORDS 2000000
+#define NUM_NAMES 4096 // distinct identifiers, so interning mostly finds existing symbols
+
+static const char *const KEYWORDS[] = {"if", "else", "while", "print", "return", "int", "void", "and", "or"};
+#define NUM_KEYWORDS (sizeof(KEYWORDS) / sizeof(KEYWORDS[0]))
+
+// same first char and length as a keyword, so they hash to a keyword's slot and need the compare
+static const char *const NEAR_KEYWORDS[] = {"iz", "elsa", "whale", "prism", "retain", "inx", "vote", "ant", "ox"};
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// A random identifier of 3 to 12 chars that starts with x, so it is never a keyword.
+static void make_name(char *name) {
+    size_t len = 3 + rng() % 10;
+    name[0] = 'x';
+    for (size_t i = 1; i < len; i++) {
+        name[i] = (char) ((rng() % 4 == 0 ? 'A' : 'a') + rng() % 26);
+    }
+    name[len] = '\0';
+}
+
+// Write NUM_WORDS words, keyword_percent of them keywords and the rest from names, to a new temporary file.
+static bool write_input(char *path, unsigned keyword_percent, const char *const *names, size_t num_names,
+                        size_t *num_keywords) {
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return false;
+    }
+    FILE *out = fdopen(fd, "w");
+    *num_keywords = 0;
+    for (size_t i = 0; i < NUM_WORDS; i++) {
+        const char *word;
+        if (rng() % 100 < keyword_percent) {
+            word = KEYWORDS[rng() % NUM_KEYWORDS];
+            (*num_keywords)++;
+        } else {
+            word = names[rng() % num_names];
+        }
+        fputs(word, out);
+        fputc(i % 8 == 7 ? '\n' : ' ', out);
+    }
+    return fclose(out) == 0;
+}
+
+static bool is_keyword(enum abc_token_type type) { return type >= TOKEN_AND && type <= TOKEN_VOID_TYPE; }
+
+static bool run(const char *what, unsigned keyword_percent, const char *const *names, size_t num_names) {
+    char path[] = "/tmp/ablc_lexer_bench_XXXXXX";
+    size_t expected_keywords;
+    if (!write_input(path, keyword_percent, names, num_names, &expected_keywords)) {
+        return false;
+    }
+    double best = 0;
+    size_t num_tokens = 0;
+    size_t num_keywords = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        struct abc_lexer lexer;
+        if (!abc_lexer_init(&lexer, path)) {
+            unlink(path);
+            return false;
+        }
+        num_tokens = num_keywords = 0;
+        double start = bench_now_ms();
+        struct abc_token token;
+        while ((token = abc_lexer_next_token(&lexer)).type != TOKEN_EOF) {
+            num_tokens++;
+            num_keywords += is_keyword(token.type);
+        }
+        double ms = bench_now_ms() - start;
+        abc_lexer_destroy(&lexer);
+        if (run == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    unlink(path);
+    if (num_tokens != NUM_WORDS || num_keywords != expected_keywords) {
+        fprintf(stderr, "%s: lexed %zu tokens and %zu keywords, wrote %d and %zu\n", what, num_tokens, num_keywords,
+                NUM_WORDS, expected_keywords);
+        return false;
+    }
+    printf("%-40s %8.1f ms %6.2f ns/token\n", what, best, best * 1e6 / (double) num_tokens);
+    return true;
+}
+
+int main(void) {
+    static char storage[NUM_NAMES][16];
+    const char *names[NUM_NAMES];
+    for (size_t i = 0; i < NUM_NAMES; i++) {
+        make_name(storage[i]);
+        names[i] = storage[i];
+    }
+
+    bool ok = run("keywords only", 100, names, NUM_NAMES) &&
+              run("30% keywords, 70% identifiers", 30, names, NUM_NAMES) &&
+              run("identifiers only", 0, names, NUM_NAMES) &&
+              run("identifiers sharing a keyword's slot", 0, NEAR_KEYWORDS, NUM_KEYWORDS);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
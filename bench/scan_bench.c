@@ -0,0 +1,197 @@
+/**
+ * Compares the abc_scan implementations the running CPU supports on a large buffer shaped like generated sources:
+ * deep indentation, long identifiers and some integers. The buffer is tokenized the way the lexer does it, and every
+ * implementation has to find the same number of tokens as the scalar one. An AVX2 variant, which is no faster than
+ * SSE2 beyond noise since most runs end within the first chunk, is kept here to check that this holds.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/abc_scan.h"
+#include "bench.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BENCH_X86
+#endif
+
+#define BUF_SIZE (64u << 20)
+
+#ifdef BENCH_X86
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_in_range(__m256i x, char lo, char range) {
+    __m256i off = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(off, _mm256_set1_epi8(range)), off);
+}
+
+AVX2 static const uint8_t *avx2_skip_whitespace(const uint8_t *cur, const uint8_t *end) {
+    while (end - cur >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) cur);
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+                                                     _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')),
+                                                     _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(ws);
+        if (mask != 0xFFFFFFFF) {
+            return cur + __builtin_ctz(~mask);
+        }
+        cur += 32;
+    }
+    return abc_scan_sse2.skip_whitespace(cur, end);
+}
+
+AVX2 static const uint8_t *avx2_skip_alnum(const uint8_t *cur, const uint8_t *end) {
+    while (end - cur >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) cur);
+        __m256i alpha = avx2_in_range(_mm256_or_si256(chunk, _mm256_set1_epi8(0x20)), 'a', 25);
+        __m256i digit = avx2_in_range(chunk, '0', 9);
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(alpha, digit));
+        if (mask != 0xFFFFFFFF) {
+            return cur + __builtin_ctz(~mask);
+        }
+        cur += 32;
+    }
+    return abc_scan_sse2.skip_alnum(cur, end);
+}
+
+AVX2 static const uint8_t *avx2_skip_digits(const uint8_t *cur, const uint8_t *end) {
+    while (end - cur >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) cur);
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(avx2_in_range(chunk, '0', 9));
+        if (mask != 0xFFFFFFFF) {
+            return cur + __builtin_ctz(~mask);
+        }
+        cur += 32;
+    }
+    return abc_scan_sse2.skip_digits(cur, end);
+}
+
+static const struct abc_scan scan_avx2 = {
+        .name = "avx2",
+        .skip_whitespace = avx2_skip_whitespace,
+        .skip_alnum = avx2_skip_alnum,
+        .skip_digits = avx2_skip_digits,
+};
+
+#endif // BENCH_X86
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+static size_t append_word(uint8_t *buf, size_t at, bool digits, size_t max_word) {
+    size_t len = digits ? 1 + rng() % 10 : 4 + rng() % max_word;
+    for (size_t i = 0; i < len; i++) {
+        buf[at++] = digits ? (uint8_t) ('0' + rng() % 10) : (uint8_t) ((rng() % 4 == 0 ? 'A' : 'a') + rng() % 26);
+    }
+    return at;
+}
+
+// Lines of up to max_indent levels of indentation followed by identifiers of up to max_word chars, integers and
+// punctuation.
+static uint8_t *make_input(size_t size, size_t max_indent, size_t max_word) {
+    uint8_t *buf = malloc(size);
+    if (buf == NULL) {
+        return NULL;
+    }
+    size_t at = 0;
+    while (at + 1024 < size) {
+        size_t indent = 4 * (rng() % max_indent);
+        for (size_t i = 0; i < indent; i++) {
+            buf[at++] = ' ';
+        }
+        int words = 1 + (int) (rng() % 5);
+        for (int i = 0; i < words; i++) {
+            at = append_word(buf, at, rng() % 5 == 0, max_word);
+            buf[at++] = rng() % 2 == 0 ? ' ' : '+';
+        }
+        buf[at++] = ';';
+        buf[at++] = '\n';
+    }
+    while (at < size) {
+        buf[at++] = '\n';
+    }
+    return buf;
+}
+
+static size_t count_tokens(const struct abc_scan *scan, const uint8_t *cur, const uint8_t *end) {
+    size_t tokens = 0;
+    while (cur < end) {
+        cur = scan->skip_whitespace(cur, end);
+        if (cur == end) {
+            break;
+        }
+        if (*cur >= '0' && *cur <= '9') {
+            cur = scan->skip_digits(cur, end);
+        } else if ((*cur | 0x20) >= 'a' && (*cur | 0x20) <= 'z') {
+            cur = scan->skip_alnum(cur, end);
+        } else {
+            cur++;
+        }
+        tokens++;
+    }
+    return tokens;
+}
+
+static int run(const char *shape, size_t max_indent, size_t max_word) {
+    const struct abc_scan *scans[3] = {&abc_scan_scalar};
+    size_t num_scans = 1;
+#ifdef BENCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        scans[num_scans++] = &abc_scan_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        scans[num_scans++] = &scan_avx2;
+    }
+#endif
+
+    uint8_t *buf = make_input(BUF_SIZE, max_indent, max_word);
+    if (buf == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    size_t expected = 0;
+    for (size_t i = 0; i < num_scans; i++) {
+        double best = 0;
+        size_t tokens = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            double start = bench_now_ms();
+            tokens = count_tokens(scans[i], buf, buf + BUF_SIZE);
+            double ms = bench_now_ms() - start;
+            if (run == 0 || ms < best) {
+                best = ms;
+            }
+        }
+        if (i == 0) {
+            expected = tokens;
+        } else if (tokens != expected) {
+            fprintf(stderr, "%s found %zu tokens, scalar %zu\n", scans[i]->name, tokens, expected);
+            free(buf);
+            return EXIT_FAILURE;
+        }
+        printf("%-8s %8.1f ms %6.2f ns/token\n", scans[i]->name, best, best * 1e6 / (double) tokens);
+    }
+    printf("%s: %zu tokens in %u MiB\n\n", shape, expected, BUF_SIZE >> 20);
+    free(buf);
+    return EXIT_SUCCESS;
+}
+
+int main(void) {
+    printf("%-8s %8s    %6s\n", "scan", "best", "per token");
+    if (run("typical: up to 28 spaces of indentation, identifiers of 4 to 39 chars", 8, 36) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    if (run("long runs: up to 124 spaces of indentation, identifiers of 4 to 127 chars", 32, 124) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    printf("selected: %s\n", abc_scan_select()->name);
+    return EXIT_SUCCESS;
+}
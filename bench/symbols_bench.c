@@ -0,0 +1,117 @@
+/**
+ * Compiles generated programs with the ablc given as the only argument and reports how the compile time grows with the
+ * number of symbols. One program declares n variables in main, each initialized from the previous one, the other has
+ * n functions each calling the previous one. Lookups are hashed, so doubling n should about double the time; the
+ * benchmark fails when going from the smallest to the largest n takes more than twice the linear growth.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define MIN_SYMBOLS 2000
+#define MAX_SYMBOLS 16000
+
+static void write_vars(FILE *out, size_t n) {
+    fputs("void main() {\n    int v0 = 1;\n", out);
+    for (size_t i = 1; i < n; i++) {
+        fprintf(out, "    int v%zu = v%zu + 1;\n", i, i - 1);
+    }
+    fprintf(out, "    print(v%zu);\n}\n", n - 1);
+}
+
+static void write_funs(FILE *out, size_t n) {
+    fputs("int f0(int a) {\n    return a + 1;\n}\n", out);
+    for (size_t i = 1; i < n; i++) {
+        fprintf(out, "int f%zu(int a) {\n    return f%zu(a) + 1;\n}\n", i, i - 1);
+    }
+    fprintf(out, "void main() {\n    print(f%zu(0));\n}\n", n - 1);
+}
+
+// Run ablc on path without writing any output, false if it could not be run or failed.
+static bool compile(const char *ablc, const char *path) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        execl(ablc, ablc, path, "--skip-output", (char *) NULL);
+        perror("execl");
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Best compile time of BENCH_RUNS in ms for the program write generates for n symbols, negative on failure.
+static double time_program(const char *ablc, void (*write)(FILE *, size_t), size_t n) {
+    char path[] = "/tmp/ablc_symbols_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return -1;
+    }
+    FILE *out = fdopen(fd, "w");
+    write(out, n);
+    if (fclose(out) != 0) {
+        unlink(path);
+        return -1;
+    }
+    double best = -1;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        double start = bench_now_ms();
+        if (!compile(ablc, path)) {
+            fprintf(stderr, "%s failed on %zu symbols\n", ablc, n);
+            best = -1;
+            break;
+        }
+        double ms = bench_now_ms() - start;
+        if (best < 0 || ms < best) {
+            best = ms;
+        }
+    }
+    unlink(path);
+    return best;
+}
+
+static bool run(const char *ablc, const char *what, void (*write)(FILE *, size_t)) {
+    printf("%s\n%8s %10s %12s\n", what, "n", "ms", "us/symbol");
+    double first = 0;
+    double last = 0;
+    for (size_t n = MIN_SYMBOLS; n <= MAX_SYMBOLS; n *= 2) {
+        double ms = time_program(ablc, write, n);
+        if (ms < 0) {
+            return false;
+        }
+        printf("%8zu %10.1f %12.2f\n", n, ms, ms * 1e3 / (double) n);
+        first = n == MIN_SYMBOLS ? ms : first;
+        last = ms;
+    }
+    double growth = last / first;
+    double linear = (double) MAX_SYMBOLS / MIN_SYMBOLS;
+    printf("%zux the symbols took %.1fx the time\n\n", (size_t) (MAX_SYMBOLS / MIN_SYMBOLS), growth);
+    if (growth > 2 * linear) {
+        fprintf(stderr, "%s: compile time grows faster than linearly\n", what);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <path to ablc>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool ok = run(argv[1], "one function with n chained variables", write_vars);
+    ok &= run(argv[1], "n functions each calling the previous one", write_funs);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -7,52 +7,129 @@
 
 #include "abc_lexer.h"
 
-#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static void max_munch(const struct abc_lexer *lexer, enum abc_token_type type, char start, struct abc_token *token);
-static bool match(const struct abc_lexer *lexer, char c);
-static void lex_int(struct abc_lexer *lexer, uint8_t start, struct abc_token *token);
-static void lex_keyword_or_identifier(struct abc_lexer *lexer, uint8_t start, struct abc_token *token);
+#define READ_CHUNK_SIZE 65536
 
-static char *my_strdup(struct abc_pool *pool, const uint8_t *src, int len) {
-    char *result = abc_pool_alloc(pool, len + 1, 1);
-    strncpy(result, (char *) src, len);
-    result[len] = '\0';
-    return result;
+static void max_munch(struct abc_lexer *lexer, enum abc_token_type type, struct abc_token *token);
+static bool match(struct abc_lexer *lexer, char c);
+static void lex_int(struct abc_lexer *lexer, struct abc_token *token);
+static void lex_keyword_or_identifier(struct abc_lexer *lexer, struct abc_token *token);
+
+/*
+ * Read everything from fd into a malloc'd buffer, used when the input can not be mapped.
+ */
+static bool read_all(int fd, struct abc_lexer *lexer) {
+    size_t cap = READ_CHUNK_SIZE;
+    size_t len = 0;
+    uint8_t *buf = malloc(cap);
+    if (buf == NULL) {
+        return false;
+    }
+    ssize_t n;
+    while ((n = read(fd, buf + len, cap - len)) != 0) {
+        if (n < 0) {
+            free(buf);
+            return false;
+        }
+        len += (size_t) n;
+        if (len == cap) {
+            cap *= 2;
+            uint8_t *tmp = realloc(buf, cap);
+            if (tmp == NULL) {
+                free(buf);
+                return false;
+            }
+            buf = tmp;
+        }
+    }
+    lexer->src = buf;
+    lexer->src_len = len;
+    lexer->src_mapped = false;
+    return true;
+}
+
+static bool load_input(struct abc_lexer *lexer, const char *filename) {
+    bool is_stdin = strcmp(filename, "-") == 0;
+    int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    bool ok;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *mapped = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            lexer->src = mapped;
+            lexer->src_len = (size_t) st.st_size;
+            lexer->src_mapped = true;
+            ok = true;
+        } else {
+            ok = read_all(fd, lexer);
+        }
+    } else {
+        ok = read_all(fd, lexer);
+    }
+    if (!is_stdin) {
+        close(fd);
+    }
+    return ok;
 }
 
 void abc_lexer_destroy(struct abc_lexer *lexer) {
-    fclose(lexer->file);
+    if (lexer->src_mapped) {
+        munmap((void *) lexer->src, lexer->src_len);
+    } else {
+        free((void *) lexer->src);
+    }
     abc_pool_destroy(lexer->pool);
 }
 
 bool abc_lexer_init(struct abc_lexer *lexer, const char *filename) {
-    lexer->file = fopen(filename, "r");
-    if (!lexer->file) {
+    if (!load_input(lexer, filename)) {
         perror("Error opening file");
         lexer->has_error = true;
         return false;
     }
-    lexer->line = 1;
+    if (lexer->src_len > UINT32_MAX) {
+        // token offsets are 32 bits
+        fprintf(stderr, "input file too large\n");
+        lexer->has_error = true;
+        return false;
+    }
+    lexer->cur = lexer->src;
+    lexer->end = lexer->src + lexer->src_len;
+    lexer->scan = abc_scan_select();
     lexer->has_error = false;
-
-    lexer->buf_pos = 0;
+    lexer->has_line_starts = false;
 
     lexer->has_peek = lexer->is_eof = false;
     lexer->pool = abc_pool_create();
+    abc_intern_init(&lexer->symbols, lexer->pool);
 
     return true;
 }
 
+static void lex_error(struct abc_lexer *lexer, struct abc_token *token, const char *what) {
+    int line, column;
+    abc_lexer_position(lexer, token->offset, &line, &column);
+    lexer->has_error = true;
+    token->type = TOKEN_ERROR;
+    fprintf(stderr, "Failed to lex %s at line %d column %d: %.*s\n", what, line, column, (int) token->len,
+            (const char *) lexer->src + token->offset);
+}
+
 struct abc_token abc_lexer_next_token(struct abc_lexer *lexer) {
     struct abc_token result = {0};
     uint8_t ch;
-    int tmpch;
 
     if (lexer->is_eof) {
         result.type = TOKEN_EOF;
-        result.line = lexer->line;
+        result.offset = (uint32_t) lexer->src_len;
         return result;
     }
     if (lexer->has_peek) {
@@ -60,79 +137,75 @@ struct abc_token abc_lexer_next_token(struct abc_lexer *lexer) {
         return lexer->peeked;
     }
 
-    while ((tmpch = fgetc(lexer->file)) != EOF) {
-        ch = (uint8_t) tmpch;
-        lexer->buf_pos = 0;
+    // Skip whitespace
+    lexer->cur = lexer->scan->skip_whitespace(lexer->cur, lexer->end);
+    if (lexer->cur < lexer->end) {
+        result.offset = (uint32_t) (lexer->cur - lexer->src);
+        result.len = 1;
+        ch = *lexer->cur++;
 
-        // Skip whitespace
-        if (ch == '\n') {
-            lexer->line++;
-            continue;
-        }
-        if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
-            continue;
-        }
-        // Basic tokens
-        if (ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '(' || ch == ')' || ch == '{' || ch == '}' ||
-            ch == ',' || ch == ';') {
-            result.line = lexer->line;
-            result.lexeme = my_strdup(lexer->pool, &ch, 1);
-            if (ch == '+')
+        switch (ch) {
+            // Basic tokens
+            case '+':
                 result.type = TOKEN_PLUS;
-            else if (ch == '-')
+                return result;
+            case '-':
                 result.type = TOKEN_MINUS;
-            else if (ch == '*')
+                return result;
+            case '*':
                 result.type = TOKEN_STAR;
-            else if (ch == '/')
+                return result;
+            case '/':
                 result.type = TOKEN_SLASH;
-            else if (ch == '(')
+                return result;
+            case '(':
                 result.type = TOKEN_LPAREN;
-            else if (ch == ')')
+                return result;
+            case ')':
                 result.type = TOKEN_RPAREN;
-            else if (ch == '{')
+                return result;
+            case '{':
                 result.type = TOKEN_LBRACE;
-            else if (ch == '}')
+                return result;
+            case '}':
                 result.type = TOKEN_RBRACE;
-            else if (ch == ',')
+                return result;
+            case ',':
                 result.type = TOKEN_COMMA;
-            else
+                return result;
+            case ';':
                 result.type = TOKEN_SEMICOLON;
-            return result;
-        }
-        if (ch == '>') {
-            max_munch(lexer, TOKEN_GREATER, '>', &result);
-            return result;
-        }
-        if (ch == '<') {
-            max_munch(lexer, TOKEN_LESS, '<', &result);
-            return result;
-        }
-        if (ch == '=') {
-            max_munch(lexer, TOKEN_EQUALS, '=', &result);
-            return result;
-        }
-        if (ch == '!') {
-            max_munch(lexer, TOKEN_BANG, '!', &result);
-            return result;
+                return result;
+            case '>':
+                max_munch(lexer, TOKEN_GREATER, &result);
+                return result;
+            case '<':
+                max_munch(lexer, TOKEN_LESS, &result);
+                return result;
+            case '=':
+                max_munch(lexer, TOKEN_EQUALS, &result);
+                return result;
+            case '!':
+                max_munch(lexer, TOKEN_BANG, &result);
+                return result;
+            default:
+                break;
         }
         if (ch >= '0' && ch <= '9') {
-            lex_int(lexer, ch, &result);
+            lex_int(lexer, &result);
             return result;
         }
         if (isalpha(ch)) {
             // keyword or identifier
-            lex_keyword_or_identifier(lexer, ch, &result);
+            lex_keyword_or_identifier(lexer, &result);
             return result;
         }
-        result.type = TOKEN_ERROR;
-        result.line = lexer->line;
-        lexer->has_error = true;
-        fprintf(stderr, "Failed to lex at line %d unexpected character: %c\n", lexer->line, ch);
+        lex_error(lexer, &result, "unexpected character");
         return result;
     }
 
     lexer->is_eof = true;
-    result.line = lexer->line;
+    result.offset = (uint32_t) lexer->src_len;
     result.type = TOKEN_EOF;
     return result;
 }
@@ -146,111 +219,204 @@ struct abc_token abc_lexer_peek(struct abc_lexer *lexer) {
     return res;
 }
 
-static void max_munch(const struct abc_lexer *lexer, const enum abc_token_type type, const char start,
-                      struct abc_token *token) {
-    char buf[2] = {start};
-    token->line = lexer->line;
+void abc_lexer_tokenize(struct abc_lexer *lexer, struct abc_token_buf *buf) {
+    // Sources rarely have more than one token per two bytes, reserve that up front to avoid regrowth.
+    size_t cap = (size_t) (lexer->end - lexer->cur) / 2 + 1;
+    abc_arr_init_cap(&buf->types, sizeof(uint8_t), cap, lexer->pool);
+    abc_arr_init_cap(&buf->offsets, sizeof(uint32_t), cap, lexer->pool);
+    abc_arr_init_cap(&buf->payloads, sizeof(uint32_t), cap, lexer->pool);
+    buf->symbols = &lexer->symbols;
+
+    struct abc_token token;
+    do {
+        token = abc_lexer_next_token(lexer);
+        uint8_t type = (uint8_t) token.type;
+        uint32_t payload = token.type == TOKEN_IDENTIFIER ? token.sym : token.len;
+        // The three arrays grow in lockstep, only go through abc_arr_push when they are full.
+        size_t i = buf->types.len;
+        if (i == buf->types.cap) {
+            abc_arr_push(&buf->types, &type);
+            abc_arr_push(&buf->offsets, &token.offset);
+            abc_arr_push(&buf->payloads, &payload);
+            continue;
+        }
+        ((uint8_t *) buf->types.data)[i] = type;
+        ((uint32_t *) buf->offsets.data)[i] = token.offset;
+        ((uint32_t *) buf->payloads.data)[i] = payload;
+        buf->types.len = buf->offsets.len = buf->payloads.len = i + 1;
+    } while (token.type != TOKEN_EOF);
+}
+
+struct abc_token abc_token_buf_get(const struct abc_token_buf *buf, size_t i) {
+    if (i >= buf->types.len) {
+        i = buf->types.len - 1;
+    }
+    struct abc_token token = {
+            .type = ((uint8_t *) buf->types.data)[i],
+            .offset = ((uint32_t *) buf->offsets.data)[i],
+    };
+    uint32_t payload = ((uint32_t *) buf->payloads.data)[i];
+    if (token.type == TOKEN_IDENTIFIER) {
+        token.sym = payload;
+        token.len = ((struct abc_intern_entry *) buf->symbols->entries.data)[payload].len;
+    } else {
+        token.len = payload;
+    }
+    return token;
+}
+
+static void max_munch(struct abc_lexer *lexer, const enum abc_token_type type, struct abc_token *token) {
     if (match(lexer, '=')) {
-        buf[1] = '=';
         token->type = type + 1;
-        token->lexeme = my_strdup(lexer->pool, (uint8_t *) buf, 2);
+        token->len = 2;
     } else {
         token->type = type;
-        token->lexeme = my_strdup(lexer->pool, (uint8_t *) buf, 1);
     }
 }
 
-static bool match(const struct abc_lexer *lexer, const char c) {
-    const int ch = fgetc(lexer->file);
-    if (ch == c) {
+static bool match(struct abc_lexer *lexer, const char c) {
+    if (lexer->cur < lexer->end && *lexer->cur == (uint8_t) c) {
+        lexer->cur++;
         return true;
     }
-    ungetc(ch, lexer->file);
     return false;
 }
 
-static void lex_int(struct abc_lexer *lexer, uint8_t start, struct abc_token *token) {
-    int errnocpy = errno;
-    int ch = -1;
-    lexer->buf[lexer->buf_pos++] = start;
-    while (ch = fgetc(lexer->file), lexer->buf_pos < ABC_LEXER_BUFFER_SIZE && isdigit(ch)) {
-        lexer->buf[lexer->buf_pos++] = ch;
-    }
-    ungetc(ch, lexer->file);
-    if (lexer->buf_pos == ABC_LEXER_BUFFER_SIZE - 1) {
-        goto err;
+/*
+ * Value of the digits in [start, end), returns false on overflow.
+ */
+static bool int_value(const uint8_t *start, const uint8_t *end, long *value) {
+    long res = 0;
+    for (const uint8_t *p = start; p < end; p++) {
+        int digit = *p - '0';
+        if (res > (LONG_MAX - digit) / 10) {
+            return false;
+        }
+        res = res * 10 + digit;
     }
-    lexer->buf[lexer->buf_pos] = '\0';
-
+    *value = res;
+    return true;
+}
 
-    errno = 0;
-    char *endptr;
-    long res = strtol((char *) lexer->buf, &endptr, 10);
-    if (*endptr != '\0' || errno != 0) {
-        goto err;
+static void lex_int(struct abc_lexer *lexer, struct abc_token *token) {
+    // the first digit is already consumed.
+    lexer->cur = lexer->scan->skip_digits(lexer->cur, lexer->end);
+    token->len = (uint32_t) (lexer->cur - lexer->src) - token->offset;
+    long value;
+    if (!int_value(lexer->src + token->offset, lexer->cur, &value)) {
+        lex_error(lexer, token, "int");
+        return;
     }
-    token->line = lexer->line;
     token->type = TOKEN_INT;
-    token->lexeme = my_strdup(lexer->pool, lexer->buf, lexer->buf_pos);
-    token->data = (void *) res;
-    errno = errnocpy;
-    return;
+}
 
-err:
-    lexer->has_error = true;
-    token->type = TOKEN_ERROR;
-    token->lexeme = my_strdup(lexer->pool, (uint8_t *)"invalid integer token", sizeof("invalid integer token") - 1);
-    token->line = lexer->line;
-    fprintf(stderr, "Failed to lex int at line %d\n", lexer->line);
-    errno = errnocpy;
+long abc_lexer_token_int(const struct abc_lexer *lexer, const struct abc_token *token) {
+    assert(token->type == TOKEN_INT);
+    long value = 0;
+    bool ok = int_value(lexer->src + token->offset, lexer->src + token->offset + token->len, &value);
+    assert(ok);
+    (void) ok;
+    return value;
 }
 
-static void lex_keyword_or_identifier(struct abc_lexer *lexer, uint8_t start, struct abc_token *token) {
-    int ch;
-    lexer->buf[lexer->buf_pos++] = start;
-    bool err = false;
-    while ((ch = fgetc(lexer->file)) != EOF && isalnum(ch)) {
-        if (lexer->buf_pos < ABC_LEXER_BUFFER_SIZE) {
-            lexer->buf[lexer->buf_pos++] = ch;
-        } else {
-            err = true;
+/*
+ * Keywords are recognized with a perfect hash over (first char, length): (c + 7 * len) & 15 maps every keyword to a
+ * distinct slot, so each identifier costs one table lookup and at most one compare. When adding a keyword, pick new
+ * constants that keep the slots distinct, the build fails otherwise.
+ */
+#define KEYWORD_HASH(c, len) (((unsigned) (c) + 7u * (unsigned) (len)) & 15u)
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 6
+
+// X(first char, length, string, token type)
+#define KEYWORDS(X)                                                                                                    \
+    X('i', 2, "if", TOKEN_IF)                                                                                          \
+    X('e', 4, "else", TOKEN_ELSE)                                                                                      \
+    X('w', 5, "while", TOKEN_WHILE)                                                                                    \
+    X('p', 5, "print", TOKEN_PRINT)                                                                                    \
+    X('r', 6, "return", TOKEN_RETURN)                                                                                  \
+    X('i', 3, "int", TOKEN_INT_TYPE)                                                                                   \
+    X('v', 4, "void", TOKEN_VOID_TYPE)                                                                                 \
+    X('a', 3, "and", TOKEN_AND)                                                                                        \
+    X('o', 2, "or", TOKEN_OR)
+
+#define KEYWORD_ENTRY(c, len, str, type) [KEYWORD_HASH(c, len)] = {str, len, type},
+// The slot bits only add up to their union when no two keywords share a slot.
+#define KEYWORD_SLOT_SUM(c, len, str, type) +(1u << KEYWORD_HASH(c, len))
+#define KEYWORD_SLOT_UNION(c, len, str, type) | (1u << KEYWORD_HASH(c, len))
+#define KEYWORD_CHECK_LEN(c, len, str, type)                                                                           \
+    _Static_assert(sizeof(str) - 1 == (len) && (len) >= KEYWORD_MIN_LEN && (len) <= KEYWORD_MAX_LEN,                   \
+                   "wrong length for keyword " str);
+
+_Static_assert((0 KEYWORDS(KEYWORD_SLOT_SUM)) == (0 KEYWORDS(KEYWORD_SLOT_UNION)),
+               "two keywords hash to the same slot, change KEYWORD_HASH");
+KEYWORDS(KEYWORD_CHECK_LEN)
+
+static const struct keyword {
+    const char *str;
+    size_t len;
+    enum abc_token_type type;
+} keywords[16] = {KEYWORDS(KEYWORD_ENTRY)};
+
+static void lex_keyword_or_identifier(struct abc_lexer *lexer, struct abc_token *token) {
+    lexer->cur = lexer->scan->skip_alnum(lexer->cur, lexer->end);
+    token->len = (uint32_t) (lexer->cur - lexer->src) - token->offset;
+    size_t len = token->len;
+
+    const char *buf = (const char *) lexer->src + token->offset;
+    if (len >= KEYWORD_MIN_LEN && len <= KEYWORD_MAX_LEN) {
+        const struct keyword *keyword = &keywords[KEYWORD_HASH(buf[0], len)];
+        if (keyword->len == len && memcmp(keyword->str, buf, len) == 0) {
+            token->type = keyword->type;
+            return;
         }
     }
-    ungetc(ch, lexer->file);
+    token->type = TOKEN_IDENTIFIER;
+    token->sym = abc_intern(&lexer->symbols, buf, len);
+}
 
-    token->line = lexer->line;
-    if (err) {
-        token->type = TOKEN_ERROR;
-        token->lexeme = my_strdup(lexer->pool, lexer->buf, lexer->buf_pos);
-        lexer->has_error = true;
-        fprintf(stderr, "Failed to lex keyword or identifier at line %d: %.*s\n", lexer->line, lexer->buf_pos,
-                (char *) lexer->buf);
-        return;
+/* POSITIONS */
+
+/*
+ * Record the offset every line starts at. Only done the first time a position is needed, which is normally when
+ * reporting an error.
+ */
+static void build_line_starts(struct abc_lexer *lexer) {
+    abc_arr_init(&lexer->line_starts, sizeof(uint32_t), lexer->pool);
+    uint32_t start = 0;
+    abc_arr_push(&lexer->line_starts, &start);
+    const uint8_t *p = lexer->src;
+    while ((p = memchr(p, '\n', lexer->end - p)) != NULL) {
+        p++;
+        start = (uint32_t) (p - lexer->src);
+        abc_arr_push(&lexer->line_starts, &start);
     }
+    lexer->has_line_starts = true;
+}
 
-    token->lexeme = my_strdup(lexer->pool, lexer->buf, lexer->buf_pos);
-    char *buf = (char *) lexer->buf;
-    if (lexer->buf_pos == 2 && strncmp(buf, "if", lexer->buf_pos) == 0) {
-        token->type = TOKEN_IF;
-    } else if (lexer->buf_pos == 4 && strncmp(buf, "else", lexer->buf_pos) == 0) {
-        token->type = TOKEN_ELSE;
-    } else if (lexer->buf_pos == 5 && strncmp(buf, "while", lexer->buf_pos) == 0) {
-        token->type = TOKEN_WHILE;
-    } else if (lexer->buf_pos == 5 && strncmp(buf, "print", lexer->buf_pos) == 0) {
-        token->type = TOKEN_PRINT;
-    } else if (lexer->buf_pos == 3 && strncmp(buf, "int", lexer->buf_pos) == 0) {
-        token->type = TOKEN_INT_TYPE;
-    } else if (lexer->buf_pos == 4 && strncmp(buf, "void", lexer->buf_pos) == 0) {
-        token->type = TOKEN_VOID_TYPE;
-    } else if (lexer->buf_pos == 6 && strncmp(buf, "return", lexer->buf_pos) == 0) {
-        token->type = TOKEN_RETURN;
-    } else if (lexer->buf_pos == 3 && strncmp(buf, "and", lexer->buf_pos) == 0) {
-        token->type = TOKEN_AND;
-    } else if (lexer->buf_pos == 2 && strncmp(buf, "or", lexer->buf_pos) == 0) {
-        token->type = TOKEN_OR;
-    } else {
-        token->type = TOKEN_IDENTIFIER;
+void abc_lexer_position(struct abc_lexer *lexer, uint32_t offset, int *line, int *column) {
+    if (!lexer->has_line_starts) {
+        build_line_starts(lexer);
     }
+    // last line start <= offset
+    const uint32_t *starts = lexer->line_starts.data;
+    size_t lo = 0, hi = lexer->line_starts.len;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (starts[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *line = (int) lo + 1;
+    *column = (int) (offset - starts[lo]) + 1;
+}
+
+int abc_lexer_line(struct abc_lexer *lexer, uint32_t offset) {
+    int line, column;
+    abc_lexer_position(lexer, offset, &line, &column);
+    return line;
 }
 
 const char *abc_lexer_token_type_str(enum abc_token_type type)  {
@@ -11,10 +11,11 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "abc_scan.h"
+#include "data/abc_arr.h"
+#include "data/abc_intern.h"
 #include "data/abc_pool.h"
 
-#define ABC_LEXER_BUFFER_SIZE 1024
-
 // Order for TOKEN_X, TOKEN_X_EQUALS matter for lexer.
 enum abc_token_type {
     TOKEN_EQUALS,
@@ -52,22 +53,34 @@ enum abc_token_type {
 
 const char *abc_lexer_token_type_str(enum abc_token_type type);
 
+// A token is a slice of the source buffer, nothing is copied. Use abc_lexer_position to get the line/column of a
+// token, and the symbol table or abc_lexer_token_int for identifiers and integers.
 struct abc_token {
     enum abc_token_type type;
-    int line;
-    // Not present for TOKEN_ERROR
-    char *lexeme;
-    // For integers, the integer value is stored as a long.
-    void *data;
+    uint32_t offset;
+    uint32_t len;
+    // Interned symbol, only for TOKEN_IDENTIFIER.
+    abc_sym sym;
 };
 
-struct abc_lexer {
-    FILE *file;
-    int line;
+// Structure of arrays token stream, see abc_lexer_tokenize. The last token is always TOKEN_EOF.
+struct abc_token_buf {
+    struct abc_arr types; // uint8_t (enum abc_token_type)
+    struct abc_arr offsets; // uint32_t
+    struct abc_arr payloads; // uint32_t, the symbol for identifiers and the length for everything else
+    const struct abc_intern *symbols;
+};
 
-    // Scratch area.
-    uint8_t buf[ABC_LEXER_BUFFER_SIZE];
-    int buf_pos;
+struct abc_lexer {
+    // The whole input, either memory mapped or read in one go (pipes, stdin).
+    const uint8_t *src;
+    size_t src_len;
+    bool src_mapped;
+    // Scan position, always in [src, end].
+    const uint8_t *cur;
+    const uint8_t *end;
+    // Scanning primitives for the running CPU.
+    const struct abc_scan *scan;
 
     bool has_error;
 
@@ -76,10 +89,17 @@ struct abc_lexer {
 
     bool is_eof;
     struct abc_pool *pool;
+    // Identifier symbols, shared with every later phase.
+    struct abc_intern symbols;
+
+    // Offset of the first byte of every line, built on first use.
+    bool has_line_starts;
+    struct abc_arr line_starts; // uint32_t
 };
 
 /**
- * Initializes the lexer.
+ * Initializes the lexer. Regular files are memory mapped, anything else (pipes, character devices) is read into
+ * memory up front. A filename of "-" reads from stdin.
  * @param lexer the lexer.
  * @param filename the file to lex.
  * @return true on success, false otherwise.
@@ -102,13 +122,46 @@ struct abc_token abc_lexer_next_token(struct abc_lexer *lexer);
 struct abc_token abc_lexer_peek(struct abc_lexer *lexer);
 
 /**
- * Destroys a token, called when ready to discard a token.
- * @param token the token.
+ * Lexes all remaining tokens, up to and including TOKEN_EOF, into buf. Tokens can then be accessed by index with
+ * abc_token_buf_get. The buffer is allocated in the lexer pool.
+ * @param lexer the lexer.
+ * @param buf the buffer to initialize.
+ */
+void abc_lexer_tokenize(struct abc_lexer *lexer, struct abc_token_buf *buf);
+
+/**
+ * Get token i of the buffer, indexes past the end return the final TOKEN_EOF.
+ * @param buf the token buffer.
+ * @param i the index.
+ * @return the token.
+ */
+struct abc_token abc_token_buf_get(const struct abc_token_buf *buf, size_t i);
+
+/**
+ * Get the value of an integer token.
+ * @param lexer the lexer.
+ * @param token a TOKEN_INT token.
+ * @return the value.
+ */
+long abc_lexer_token_int(const struct abc_lexer *lexer, const struct abc_token *token);
+
+/**
+ * Get the 1-based line and column of a source offset. The line table is computed the first time this is called.
+ * @param lexer the lexer.
+ * @param offset a token offset.
+ * @param line set to the line.
+ * @param column set to the column.
+ */
+void abc_lexer_position(struct abc_lexer *lexer, uint32_t offset, int *line, int *column);
+
+/**
+ * Get the 1-based line of a source offset, see abc_lexer_position.
  */
-void abc_lexer_token_free(struct abc_token *token);
+int abc_lexer_line(struct abc_lexer *lexer, uint32_t offset);
 
 /**
- * Destroys the lexer, closing the file, deleting all memory allocated (including for token lexemes etc.).
+ * Destroys the lexer, unmapping/freeing the input and deleting its pool, which holds the symbols, the line table and
+ * token buffers. Tokens are slices of the input, so none of them may be used afterwards.
  * @param lexer the lexer to destroy.
  */
 void abc_lexer_destroy(struct abc_lexer *lexer);
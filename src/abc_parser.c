@@ -2,59 +2,161 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <stdlib.h>
 
 #include "abc_lexer.h"
 #include "data/abc_arr.h"
+#include "data/abc_parallel.h"
 
 static bool parse_fun_decl(struct abc_parser *parser, struct abc_fun_decl *fun_decl);
+static bool parse_fun_signature(struct abc_parser *parser, struct abc_fun_decl *fun_decl);
+static bool parse_fun_body(struct abc_parser *parser, struct abc_fun_decl *fun_decl);
 static bool parse_decl(struct abc_parser *parser, struct abc_decl *decl);
 static bool parse_var_decl(struct abc_parser *parser, struct abc_decl *decl);
 static bool parse_stmt_decl(struct abc_parser *parser, struct abc_decl *decl);
-static bool parse_stmt(struct abc_parser *parser, struct abc_stmt *stmt);
+static abc_node parse_stmt(struct abc_parser *parser);
 static bool parse_expr_stmt(struct abc_parser *parser, struct abc_expr_stmt *stmt);
 static bool parse_if_stmt(struct abc_parser *parser, struct abc_if_stmt *stmt);
 static bool parse_while_stmt(struct abc_parser *parser, struct abc_while_stmt *stmt);
 static bool parse_block_stmt(struct abc_parser *parser, struct abc_block_stmt *block);
 static bool parse_print_stmt(struct abc_parser *parser, struct abc_print_stmt *stmt);
 static bool parse_return_stmt(struct abc_parser *parser, struct abc_return_stmt *stmt);
-static struct abc_expr *parse_expr(struct abc_parser *parser, int precedence);
-static struct abc_expr *parse_expr_lhs(struct abc_parser *parser);
-static struct abc_expr *parse_expr_postfix(struct abc_parser *parser, struct abc_expr *lhs);
-struct abc_expr *parse_infix_expr(struct abc_parser *parser, struct abc_expr *lhs, int precedence);
+static abc_node parse_expr(struct abc_parser *parser, int precedence);
+
+// Operator stack frames of the expression parser, see parse_expr.
+enum expr_frame_kind {
+    FRAME_ROOT,
+    FRAME_UNARY,
+    FRAME_BINARY,
+    FRAME_ASSIGN,
+    FRAME_GROUPING,
+    FRAME_CALL,
+};
+
+struct expr_frame {
+    uint8_t kind; // enum expr_frame_kind
+    uint8_t op;
+    int precedence;
+    uint32_t offset; // of the operator token
+    abc_node lhs; // left operand of binary frames
+    abc_sym identifier; // assignment target and callee
+    size_t args_base; // scratch_args position of call frames
+};
+
+static struct abc_token next_token(struct abc_parser *parser) {
+    if (parser->tokens == NULL) {
+        return abc_lexer_next_token(parser->lexer);
+    }
+    struct abc_token token = abc_token_buf_get(parser->tokens, parser->pos);
+    if (token.type != TOKEN_EOF) {
+        parser->pos++;
+    }
+    return token;
+}
+
+static struct abc_token peek_token(struct abc_parser *parser) {
+    if (parser->tokens == NULL) {
+        return abc_lexer_peek(parser->lexer);
+    }
+    return abc_token_buf_get(parser->tokens, parser->pos);
+}
+
+static abc_node push_expr(struct abc_parser *parser, const struct abc_expr *expr) {
+    abc_node node = (abc_node) parser->ast->exprs.len;
+    abc_arr_push(&parser->ast->exprs, (void *) expr);
+    return node;
+}
+
+static abc_node push_stmt(struct abc_parser *parser, const struct abc_stmt *stmt) {
+    abc_node node = (abc_node) parser->ast->stmts.len;
+    abc_arr_push(&parser->ast->stmts, (void *) stmt);
+    return node;
+}
+
+// Move the scratch entries from base onwards to the end of dst, returning their range in dst.
+static struct abc_range flush_scratch(struct abc_arr *scratch, size_t base, struct abc_arr *dst) {
+    struct abc_range range = {.start = (uint32_t) dst->len, .len = (uint32_t) (scratch->len - base)};
+    for (size_t i = base; i < scratch->len; i++) {
+        abc_arr_push(dst, (char *) scratch->data + i * scratch->elem_size);
+    }
+    scratch->len = base;
+    return range;
+}
 
 static void synchronize(struct abc_parser *parser) {
-    struct abc_token token = abc_lexer_peek(parser->lexer);
+    struct abc_token token = peek_token(parser);
     while (token.type != TOKEN_EOF && token.type != TOKEN_LBRACE) {
-        abc_lexer_next_token(parser->lexer);
-        token = abc_lexer_peek(parser->lexer);
+        next_token(parser);
+        token = peek_token(parser);
     }
 }
 
-static void report_error(struct abc_parser *parser, int line, char *fmt, ...) {
+// printf helpers for the source text of a token
+#define TOKEN_FMT "%.*s"
+#define TOKEN_ARG(parser, token) (int) (token).len, (const char *) (parser)->lexer->src + (token).offset
+
+static FILE *error_stream(struct abc_parser *parser) {
+    if (parser->err != NULL) {
+        return parser->err;
+    }
+    if (parser->err_stream == NULL && (parser->err_stream = open_memstream(&parser->err_buf, &parser->err_len)) == NULL) {
+        fprintf(stderr, "failed to create error buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    return parser->err_stream;
+}
+
+// Hands the errors collected since the last call over to the caller, who must free them.
+static char *take_errors(struct abc_parser *parser, size_t *len) {
+    if (parser->err_stream == NULL) {
+        *len = 0;
+        return NULL;
+    }
+    fclose(parser->err_stream);
+    parser->err_stream = NULL;
+    *len = parser->err_len;
+    return parser->err_buf;
+}
+
+static void report_error(struct abc_parser *parser, uint32_t offset, char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    fprintf(stderr, "Error at line %d:", line);
-    vfprintf(stderr, fmt, ap);
-    fprintf(stderr, "\n");
+    FILE *err = error_stream(parser);
+    fprintf(err, "Error at line %d:", abc_lexer_line(parser->lexer, offset));
+    vfprintf(err, fmt, ap);
+    fprintf(err, "\n");
     va_end(ap);
     parser->has_error = true;
 }
 
 static bool match_token(struct abc_parser *parser, enum abc_token_type type) {
-    struct abc_token token = abc_lexer_next_token(parser->lexer);
+    struct abc_token token = next_token(parser);
     if (token.type == type) {
         return true;
     }
     // TODO: get a str instead of the int value for the token type...
-    report_error(parser, token.line, "expect %s got %s",
+    report_error(parser, token.offset, "expect %s got %s",
         abc_lexer_token_type_str(type), abc_lexer_token_type_str(token.type));
     return false;
 }
 
 void abc_parser_init(struct abc_parser *parser, struct abc_lexer *lexer) {
     parser->lexer = lexer;
+    parser->tokens = NULL;
+    parser->pos = 0;
     parser->has_error = false;
+    parser->err = stderr;
+    parser->err_stream = NULL;
     parser->pool = abc_pool_create();
+    parser->ast = NULL;
+    abc_arr_init(&parser->scratch_decls, sizeof(struct abc_decl), parser->pool);
+    abc_arr_init(&parser->scratch_args, sizeof(abc_node), parser->pool);
+    abc_arr_init(&parser->expr_frames, sizeof(struct expr_frame), parser->pool);
+}
+
+void abc_parser_init_tokens(struct abc_parser *parser, struct abc_lexer *lexer, const struct abc_token_buf *tokens) {
+    abc_parser_init(parser, lexer);
+    parser->tokens = tokens;
 }
 
 void abc_parser_destroy(struct abc_parser *parser) {
@@ -64,9 +166,10 @@ void abc_parser_destroy(struct abc_parser *parser) {
 struct abc_program abc_parser_parse(struct abc_parser *parser) {
     struct abc_program program;
     abc_arr_init(&program.fun_decls, sizeof(struct abc_fun_decl), parser->pool);
+    program.symbols = &parser->lexer->symbols;
 
     struct abc_token token;
-    while ((token = abc_lexer_peek(parser->lexer)).type != TOKEN_EOF) {
+    while ((token = peek_token(parser)).type != TOKEN_EOF) {
         struct abc_fun_decl fun_decl;
         if (parse_fun_decl(parser, &fun_decl)) {
             abc_arr_push(&program.fun_decls, &fun_decl);
@@ -78,19 +181,274 @@ struct abc_program abc_parser_parse(struct abc_parser *parser) {
     return program;
 }
 
+/* PARALLEL AND LAZY */
+
+// Bodies are parsed straight into program.fun_decls, which does not grow while the workers run.
+struct fun_job {
+    bool has_body; // false if the signature failed to parse
+    size_t decl; // index into program.fun_decls
+    size_t body_start; // token index of the opening brace
+    bool reachable; // kept in the program, always true unless parsing lazily
+    bool parsed;
+    bool ok;
+    size_t next_same_name; // next job with a body and the same name, SIZE_MAX ends the list
+    char *signature_errors;
+    size_t signature_errors_len;
+    char *body_errors;
+    size_t body_errors_len;
+};
+
+struct parallel_parse {
+    struct abc_parser *workers;
+    size_t threads;
+    struct fun_job *jobs;
+    struct abc_fun_decl *fun_decls;
+    const size_t *batch; // job indices to parse, NULL parses all jobs
+};
+
+// Returns the token index after the brace matching the one at pos, or the index of the final TOKEN_EOF.
+static size_t skip_block(const struct abc_token_buf *tokens, size_t pos) {
+    const uint8_t *types = tokens->types.data;
+    size_t eof = tokens->types.len - 1;
+    size_t depth = 0;
+    for (; pos < eof; pos++) {
+        if (types[pos] == TOKEN_LBRACE) {
+            depth++;
+        } else if (types[pos] == TOKEN_RBRACE && --depth == 0) {
+            return pos + 1;
+        }
+    }
+    return eof;
+}
+
+/*
+ * Parse the signatures and skip the bodies by brace matching. Errors are collected per function so they can be
+ * reported in source order together with the body errors.
+ */
+static void skim_program(struct abc_parser *parser, struct abc_program *program, struct abc_arr *jobs) {
+    assert(parser->tokens != NULL);
+    abc_arr_init(&program->fun_decls, sizeof(struct abc_fun_decl), parser->pool);
+    program->symbols = &parser->lexer->symbols;
+
+    FILE *err = parser->err;
+    parser->err = NULL;
+    abc_arr_init(jobs, sizeof(struct fun_job), parser->pool);
+    struct abc_token token;
+    while ((token = peek_token(parser)).type != TOKEN_EOF) {
+        struct fun_job job = {.next_same_name = SIZE_MAX};
+        struct abc_fun_decl fun_decl;
+        if (parse_fun_signature(parser, &fun_decl)) {
+            job.has_body = true;
+            job.decl = program->fun_decls.len;
+            abc_arr_push(&program->fun_decls, &fun_decl);
+            job.body_start = parser->pos;
+            parser->pos = skip_block(parser->tokens, parser->pos);
+        } else {
+            synchronize(parser);
+        }
+        job.signature_errors = take_errors(parser, &job.signature_errors_len);
+        abc_arr_push(jobs, &job);
+    }
+    parser->err = err;
+
+    // line lookups are built lazily, do it before the workers report errors.
+    (void) abc_lexer_line(parser->lexer, 0);
+}
+
+static struct parallel_parse start_workers(struct abc_parser *parser, struct abc_program *program,
+                                           struct abc_arr *jobs, size_t threads) {
+    if (threads > jobs->len) {
+        threads = jobs->len;
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    struct parallel_parse pp = {
+            .workers = malloc(sizeof(struct abc_parser) * threads),
+            .threads = threads,
+            .jobs = jobs->data,
+            .fun_decls = program->fun_decls.data,
+            .batch = NULL,
+    };
+    if (pp.workers == NULL) {
+        fprintf(stderr, "parser allocation failed %s\n", __FILE__);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < threads; i++) {
+        abc_parser_init_tokens(&pp.workers[i], parser->lexer, parser->tokens);
+        pp.workers[i].err = NULL;
+    }
+    return pp;
+}
+
+static void parse_body_job(void *ctx, size_t worker_id, size_t index) {
+    struct parallel_parse *pp = ctx;
+    struct abc_parser *worker = &pp->workers[worker_id];
+    struct fun_job *job = &pp->jobs[pp->batch != NULL ? pp->batch[index] : index];
+    if (!job->has_body) {
+        return;
+    }
+
+    worker->has_error = false;
+    worker->pos = job->body_start;
+    job->parsed = true;
+    job->ok = parse_fun_body(worker, &pp->fun_decls[job->decl]) && !worker->has_error;
+    job->body_errors = take_errors(worker, &job->body_errors_len);
+}
+
+// Report the errors in source order, drop the functions that failed or are not reachable and release the workers.
+static void finish_workers(struct abc_parser *parser, struct abc_program *program, struct abc_arr *jobs,
+                           struct parallel_parse *pp) {
+    size_t kept = 0;
+    for (size_t i = 0; i < jobs->len; i++) {
+        struct fun_job *job = &pp->jobs[i];
+        if (job->signature_errors_len > 0) {
+            fwrite(job->signature_errors, 1, job->signature_errors_len, parser->err);
+        }
+        if (job->body_errors_len > 0) {
+            fwrite(job->body_errors, 1, job->body_errors_len, parser->err);
+        }
+        free(job->signature_errors);
+        free(job->body_errors);
+        if (job->parsed && !job->ok) {
+            parser->has_error = true;
+        } else if (job->parsed && job->reachable) {
+            pp->fun_decls[kept++] = pp->fun_decls[job->decl];
+        }
+    }
+    program->fun_decls.len = kept;
+    for (size_t i = 0; i < pp->threads; i++) {
+        abc_pool_merge(parser->pool, pp->workers[i].pool);
+    }
+    free(pp->workers);
+}
+
+struct abc_program abc_parser_parse_parallel(struct abc_parser *parser, size_t threads) {
+    struct abc_program program;
+    struct abc_arr jobs;
+    skim_program(parser, &program, &jobs);
+    for (size_t i = 0; i < jobs.len; i++) {
+        ((struct fun_job *) jobs.data)[i].reachable = true;
+    }
+
+    struct parallel_parse pp = start_workers(parser, &program, &jobs, threads);
+    abc_parallel_for(jobs.len, pp.threads, parse_body_job, &pp);
+    finish_workers(parser, &program, &jobs, &pp);
+    return program;
+}
+
+// Queue the functions named name that have not been reached yet.
+static void reach_functions(struct fun_job *jobs, const size_t *by_name, abc_sym name, struct abc_arr *queue) {
+    for (size_t i = by_name[name]; i != SIZE_MAX; i = jobs[i].next_same_name) {
+        if (!jobs[i].reachable) {
+            jobs[i].reachable = true;
+            abc_arr_push(queue, &i);
+        }
+    }
+}
+
+struct abc_program abc_parser_parse_lazy(struct abc_parser *parser, size_t threads, bool check_unreachable) {
+    struct abc_program program;
+    struct abc_arr jobs;
+    skim_program(parser, &program, &jobs);
+    struct fun_job *job_data = jobs.data;
+    struct parallel_parse pp = start_workers(parser, &program, &jobs, threads);
+
+    // functions by name, symbols are dense so a table indexed by symbol will do
+    size_t num_symbols = program.symbols->entries.len;
+    size_t *by_name = abc_pool_alloc(parser->pool, sizeof(size_t) * (num_symbols + 1), 1);
+    for (size_t i = 0; i <= num_symbols; i++) {
+        by_name[i] = SIZE_MAX;
+    }
+    for (size_t i = jobs.len; i-- > 0;) {
+        if (job_data[i].has_body) {
+            abc_sym name = pp.fun_decls[job_data[i].decl].name.sym;
+            job_data[i].next_same_name = by_name[name];
+            by_name[name] = i;
+        }
+    }
+
+    // Walk the call graph from main one wave at a time, each wave is parsed in parallel. Without a main there is
+    // nothing to start from, so everything is parsed.
+    struct abc_arr wave, next_wave;
+    abc_arr_init(&wave, sizeof(size_t), parser->pool);
+    abc_arr_init(&next_wave, sizeof(size_t), parser->pool);
+    abc_sym main_sym;
+    if (abc_intern_find(program.symbols, "main", 4, &main_sym)) {
+        reach_functions(job_data, by_name, main_sym, &wave);
+    }
+    if (wave.len == 0) {
+        for (size_t i = 0; i < jobs.len; i++) {
+            job_data[i].reachable = true;
+            abc_arr_push(&wave, &i);
+        }
+    }
+    while (wave.len > 0) {
+        pp.batch = wave.data;
+        abc_parallel_for(wave.len, pp.threads, parse_body_job, &pp);
+        next_wave.len = 0;
+        for (size_t i = 0; i < wave.len; i++) {
+            struct fun_job *job = &job_data[((size_t *) wave.data)[i]];
+            if (!job->ok) {
+                continue;
+            }
+            struct abc_ast *ast = &pp.fun_decls[job->decl].ast;
+            struct abc_expr *exprs = ast->exprs.data;
+            for (size_t j = 0; j < ast->exprs.len; j++) {
+                if (exprs[j].tag == ABC_EXPR_CALL) {
+                    reach_functions(job_data, by_name, exprs[j].val.call_expr.callee, &next_wave);
+                }
+            }
+        }
+        struct abc_arr tmp = wave;
+        wave = next_wave;
+        next_wave = tmp;
+    }
+
+    // the rest is only parsed for its errors and then dropped
+    if (check_unreachable) {
+        wave.len = 0;
+        for (size_t i = 0; i < jobs.len; i++) {
+            if (!job_data[i].reachable) {
+                abc_arr_push(&wave, &i);
+            }
+        }
+        pp.batch = wave.data;
+        abc_parallel_for(wave.len, pp.threads, parse_body_job, &pp);
+    }
+
+    finish_workers(parser, &program, &jobs, &pp);
+    return program;
+}
+
 /* FUNCTIONS */
 
+static void init_ast(struct abc_parser *parser, struct abc_ast *ast) {
+    abc_arr_init(&ast->exprs, sizeof(struct abc_expr), parser->pool);
+    abc_arr_init(&ast->stmts, sizeof(struct abc_stmt), parser->pool);
+    abc_arr_init(&ast->decls, sizeof(struct abc_decl), parser->pool);
+    abc_arr_init(&ast->args, sizeof(abc_node), parser->pool);
+    abc_arr_init(&ast->ints, sizeof(long), parser->pool);
+    parser->ast = ast;
+}
+
 static bool parse_fun_decl(struct abc_parser *parser, struct abc_fun_decl *fun_decl) {
-    struct abc_token type_token = abc_lexer_next_token(parser->lexer);
+    return parse_fun_signature(parser, fun_decl) && parse_fun_body(parser, fun_decl);
+}
+
+// Parses the return type, name and parameters, leaving the parser at the body.
+static bool parse_fun_signature(struct abc_parser *parser, struct abc_fun_decl *fun_decl) {
+    struct abc_token type_token = next_token(parser);
     if (type_token.type != TOKEN_INT_TYPE && type_token.type != TOKEN_VOID_TYPE) {
-        report_error(parser, type_token.line, "Expected int or void, got %s", type_token.lexeme);
+        report_error(parser, type_token.offset, "Expected int or void, got " TOKEN_FMT, TOKEN_ARG(parser, type_token));
         return false;
     }
     fun_decl->type = type_token.type == TOKEN_INT_TYPE ? PARSER_TYPE_INT : PARSER_TYPE_VOID;
 
-    struct abc_token id_token = abc_lexer_next_token(parser->lexer);
+    struct abc_token id_token = next_token(parser);
     if (id_token.type != TOKEN_IDENTIFIER) {
-        report_error(parser, id_token.line, "Expected an identifier after type, got %s", id_token.lexeme);
+        report_error(parser, id_token.offset, "Expected an identifier after type, got " TOKEN_FMT,
+                     TOKEN_ARG(parser, id_token));
         return false;
     }
     fun_decl->name = id_token;
@@ -99,43 +457,46 @@ static bool parse_fun_decl(struct abc_parser *parser, struct abc_fun_decl *fun_d
         return false;
     }
 
-    struct abc_token tmp_token = abc_lexer_next_token(parser->lexer);
-    bool has_err = false;
-    abc_arr_init(&fun_decl->params, sizeof(struct abc_param), abc_pool_create());
+    struct abc_token tmp_token = next_token(parser);
+    abc_arr_init(&fun_decl->params, sizeof(struct abc_param), parser->pool);
     while (tmp_token.type != TOKEN_RPAREN) {
         struct abc_param param;
         if (tmp_token.type != TOKEN_INT_TYPE && tmp_token.type != TOKEN_VOID_TYPE) {
-            report_error(parser, tmp_token.line, "Expected int or void, got %s", tmp_token.lexeme);
-            has_err = true;
-            break;
+            report_error(parser, tmp_token.offset, "Expected int or void, got " TOKEN_FMT,
+                         TOKEN_ARG(parser, tmp_token));
+            return false;
         }
         param.type = tmp_token.type == TOKEN_INT_TYPE ? PARSER_TYPE_INT : PARSER_TYPE_VOID;
-        tmp_token = abc_lexer_next_token(parser->lexer);
+        tmp_token = next_token(parser);
         if (tmp_token.type != TOKEN_IDENTIFIER) {
-            report_error(parser, tmp_token.line, "Expected an identifier, got %s", tmp_token.lexeme);
-            has_err = true;
-            break;
+            report_error(parser, tmp_token.offset, "Expected an identifier, got " TOKEN_FMT,
+                         TOKEN_ARG(parser, tmp_token));
+            return false;
         }
         param.token = tmp_token;
-        tmp_token = abc_lexer_next_token(parser->lexer);
+        tmp_token = next_token(parser);
         abc_arr_push(&fun_decl->params, &param);
         if (tmp_token.type == TOKEN_COMMA) {
-            tmp_token = abc_lexer_next_token(parser->lexer);
+            tmp_token = next_token(parser);
         }
     }
-    if (has_err || !parse_block_stmt(parser, &fun_decl->body)) {
-        abc_pool_destroy(fun_decl->params.pool);
+    return true;
+}
+
+static bool parse_fun_body(struct abc_parser *parser, struct abc_fun_decl *fun_decl) {
+    init_ast(parser, &fun_decl->ast);
+    struct abc_stmt body = {.tag = ABC_STMT_BLOCK};
+    if (!parse_block_stmt(parser, &body.val.block_stmt)) {
         return false;
     }
-
-    abc_arr_migrate_pool(&fun_decl->params, parser->pool);
+    fun_decl->body = push_stmt(parser, &body);
     return true;
 }
 
 /* DECLARATIONS */
 
 static bool parse_decl(struct abc_parser *parser, struct abc_decl *decl) {
-    struct abc_token token = abc_lexer_peek(parser->lexer);
+    struct abc_token token = peek_token(parser);
     if (token.type == TOKEN_VOID_TYPE || token.type == TOKEN_INT_TYPE) {
         return parse_var_decl(parser, decl);
     }
@@ -145,23 +506,23 @@ static bool parse_decl(struct abc_parser *parser, struct abc_decl *decl) {
 static bool parse_var_decl(struct abc_parser *parser, struct abc_decl *decl) {
     decl->tag = ABC_DECL_VAR;
 
-    struct abc_token type_token = abc_lexer_next_token(parser->lexer);
+    struct abc_token type_token = next_token(parser);
     if (type_token.type != TOKEN_INT_TYPE && type_token.type != TOKEN_VOID_TYPE) {
-        report_error(parser, type_token.line, "Expected int or void, got %s", type_token.lexeme);
+        report_error(parser, type_token.offset, "Expected int or void, got " TOKEN_FMT, TOKEN_ARG(parser, type_token));
         return false;
     }
-    decl->val.var.type = type_token.type == TOKEN_INT_TYPE ? PARSER_TYPE_INT : PARSER_TYPE_VOID;
+    decl->type = type_token.type == TOKEN_INT_TYPE ? PARSER_TYPE_INT : PARSER_TYPE_VOID;
 
-    struct abc_token id = abc_lexer_peek(parser->lexer);
+    struct abc_token id = peek_token(parser);
     if (id.type != TOKEN_IDENTIFIER) {
-        report_error(parser, id.line, "Expected an identifier, got %s", id.lexeme);
+        report_error(parser, id.offset, "Expected an identifier, got " TOKEN_FMT, TOKEN_ARG(parser, id));
         return false;
     }
-    abc_lexer_next_token(parser->lexer);
-    decl->val.var.name = id;
+    next_token(parser);
+    decl->val.var.name = id.sym;
 
-    if (abc_lexer_peek(parser->lexer).type != TOKEN_EQUALS) {
-        decl->val.var.has_init = false;
+    if (peek_token(parser).type != TOKEN_EQUALS) {
+        decl->val.var.init = ABC_NODE_NONE;
         if (!match_token(parser, TOKEN_SEMICOLON)) {
             return false;
         }
@@ -169,10 +530,9 @@ static bool parse_var_decl(struct abc_parser *parser, struct abc_decl *decl) {
     }
     match_token(parser, TOKEN_EQUALS);
 
-    decl->val.var.has_init = true;
     decl->val.var.init = parse_expr(parser, 0);
-    if (decl->val.var.init == NULL) {
-        report_error(parser, id.line, "unable to parse var decl initializer");
+    if (decl->val.var.init == ABC_NODE_NONE) {
+        report_error(parser, id.offset, "unable to parse var decl initializer");
         return false;
     }
     if (!match_token(parser, TOKEN_SEMICOLON)) {
@@ -183,32 +543,42 @@ static bool parse_var_decl(struct abc_parser *parser, struct abc_decl *decl) {
 
 static bool parse_stmt_decl(struct abc_parser *parser, struct abc_decl *decl) {
     decl->tag = ABC_DECL_STMT;
-    return parse_stmt(parser, &decl->val.stmt.stmt);
+    decl->val.stmt.stmt = parse_stmt(parser);
+    return decl->val.stmt.stmt != ABC_NODE_NONE;
 }
 
 /* STATEMENTS */
 
-static bool parse_stmt(struct abc_parser *parser, struct abc_stmt *stmt) {
-    switch (abc_lexer_peek(parser->lexer).type) {
+static abc_node parse_stmt(struct abc_parser *parser) {
+    struct abc_stmt stmt;
+    bool ok;
+    switch (peek_token(parser).type) {
         case TOKEN_IF:
-            stmt->tag = ABC_STMT_IF;
-            return parse_if_stmt(parser, &stmt->val.if_stmt);
+            stmt.tag = ABC_STMT_IF;
+            ok = parse_if_stmt(parser, &stmt.val.if_stmt);
+            break;
         case TOKEN_WHILE:
-            stmt->tag = ABC_STMT_WHILE;
-            return parse_while_stmt(parser, &stmt->val.while_stmt);
+            stmt.tag = ABC_STMT_WHILE;
+            ok = parse_while_stmt(parser, &stmt.val.while_stmt);
+            break;
         case TOKEN_LBRACE:
-            stmt->tag = ABC_STMT_BLOCK;
-            return parse_block_stmt(parser, &stmt->val.block_stmt);
+            stmt.tag = ABC_STMT_BLOCK;
+            ok = parse_block_stmt(parser, &stmt.val.block_stmt);
+            break;
         case TOKEN_PRINT:
-            stmt->tag = ABC_STMT_PRINT;
-            return parse_print_stmt(parser, &stmt->val.print_stmt);
+            stmt.tag = ABC_STMT_PRINT;
+            ok = parse_print_stmt(parser, &stmt.val.print_stmt);
+            break;
         case TOKEN_RETURN:
-            stmt->tag = ABC_STMT_RETURN;
-            return parse_return_stmt(parser, &stmt->val.return_stmt);
+            stmt.tag = ABC_STMT_RETURN;
+            ok = parse_return_stmt(parser, &stmt.val.return_stmt);
+            break;
         default:
-            stmt->tag = ABC_STMT_EXPR;
-            return parse_expr_stmt(parser, &stmt->val.expr_stmt);
+            stmt.tag = ABC_STMT_EXPR;
+            ok = parse_expr_stmt(parser, &stmt.val.expr_stmt);
+            break;
     }
+    return ok ? push_stmt(parser, &stmt) : ABC_NODE_NONE;
 }
 
 static bool parse_block_stmt(struct abc_parser *parser, struct abc_block_stmt *block) {
@@ -216,31 +586,32 @@ static bool parse_block_stmt(struct abc_parser *parser, struct abc_block_stmt *b
         return false;
     }
 
-    abc_arr_init(&block->decls, sizeof(struct abc_decl), abc_pool_create());
-    struct abc_token token = abc_lexer_peek(parser->lexer);
+    // nested blocks use the scratch space above base, so the decls of this block end up contiguous.
+    size_t base = parser->scratch_decls.len;
+    struct abc_token token = peek_token(parser);
     bool has_err = false;
     while (token.type != TOKEN_EOF && token.type != TOKEN_RBRACE) {
         struct abc_decl decl;
         if (!parse_decl(parser, &decl)) {
-            report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse line in block statement");
+            report_error(parser, peek_token(parser).offset, "failed to parse line in block statement");
             has_err = true;
             break;
         }
-        abc_arr_push(&block->decls, &decl);
-        token = abc_lexer_peek(parser->lexer);
+        abc_arr_push(&parser->scratch_decls, &decl);
+        token = peek_token(parser);
     }
     if (has_err || !match_token(parser, TOKEN_RBRACE)) {
-        abc_pool_destroy(block->decls.pool);
+        parser->scratch_decls.len = base;
         return false;
     }
-    abc_arr_migrate_pool(&block->decls, parser->pool);
+    block->decls = flush_scratch(&parser->scratch_decls, base, &parser->ast->decls);
     return true;
 }
 
 static bool parse_expr_stmt(struct abc_parser *parser, struct abc_expr_stmt *stmt) {
     stmt->expr = parse_expr(parser, 0);
-    if (stmt->expr == NULL) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "unable to parse expression stmt");
+    if (stmt->expr == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "unable to parse expression stmt");
         return false;
     }
     if (!match_token(parser, TOKEN_SEMICOLON)) {
@@ -256,9 +627,9 @@ static bool parse_if_stmt(struct abc_parser *parser, struct abc_if_stmt *stmt) {
     if (!match_token(parser, TOKEN_LPAREN)) {
         return false;
     }
-    struct abc_expr *expr;
-    if ((expr = parse_expr(parser, 0)) == NULL) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse if cond");
+    abc_node expr;
+    if ((expr = parse_expr(parser, 0)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse if cond");
         return false;
     }
     stmt->cond = expr;
@@ -266,24 +637,23 @@ static bool parse_if_stmt(struct abc_parser *parser, struct abc_if_stmt *stmt) {
         return false;
     }
 
-    struct abc_stmt *body = abc_stmt(parser->pool);
-    if (!parse_stmt(parser, body)) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse if statement body");
+    abc_node body;
+    if ((body = parse_stmt(parser)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse if statement body");
         return false;
     }
     stmt->then_stmt = body;
 
     // check for else
-    const struct abc_token token = abc_lexer_peek(parser->lexer);
+    const struct abc_token token = peek_token(parser);
     if (token.type != TOKEN_ELSE) {
-        stmt->has_else = false;
-        stmt->else_stmt = NULL;
+        stmt->else_stmt = ABC_NODE_NONE;
         return true;
     }
-    stmt->has_else = true;
-    struct abc_stmt *else_stmt = abc_stmt(parser->pool);
-    if (!parse_stmt(parser, else_stmt)) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse else statement body");
+    (void) next_token(parser);
+    abc_node else_stmt;
+    if ((else_stmt = parse_stmt(parser)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse else statement body");
         return false;
     }
     stmt->else_stmt = else_stmt;
@@ -298,18 +668,18 @@ static bool parse_while_stmt(struct abc_parser *parser, struct abc_while_stmt *s
     if (!match_token(parser, TOKEN_LPAREN)) {
         return false;
     }
-    struct abc_expr *cond;
-    if ((cond = parse_expr(parser, 0)) == NULL) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse while cond");
+    abc_node cond;
+    if ((cond = parse_expr(parser, 0)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse while cond");
         return false;
     }
     if (!match_token(parser, TOKEN_RPAREN)) {
         return false;
     }
     // body
-    struct abc_stmt *body = abc_stmt(parser->pool);
-    if (!parse_stmt(parser, body)) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse while body");
+    abc_node body;
+    if ((body = parse_stmt(parser)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse while body");
         return false;
     }
 
@@ -325,9 +695,9 @@ static bool parse_print_stmt(struct abc_parser *parser, struct abc_print_stmt *s
     if (!match_token(parser, TOKEN_LPAREN)) {
         return false;
     }
-    struct abc_expr *expr;
-    if ((expr = parse_expr(parser, 0)) == NULL) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse print stmt expr");
+    abc_node expr;
+    if ((expr = parse_expr(parser, 0)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse print stmt expr");
         return false;
     }
     if (!match_token(parser, TOKEN_RPAREN)) {
@@ -344,24 +714,22 @@ static bool parse_return_stmt(struct abc_parser *parser, struct abc_return_stmt
     if (!match_token(parser, TOKEN_RETURN)) {
         return false;
     }
-    const struct abc_token token = abc_lexer_peek(parser->lexer);
+    const struct abc_token token = peek_token(parser);
     if (token.type == TOKEN_SEMICOLON) {
         (void) match_token(parser, TOKEN_SEMICOLON);
-        stmt->has_expr = false;
-        stmt->expr = NULL;
+        stmt->expr = ABC_NODE_NONE;
         return true;
     }
 
-    struct abc_expr *expr;
-    if ((expr = parse_expr(parser, 0)) == NULL) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse return stmt expr");
+    abc_node expr;
+    if ((expr = parse_expr(parser, 0)) == ABC_NODE_NONE) {
+        report_error(parser, peek_token(parser).offset, "failed to parse return stmt expr");
         return false;
     }
     if (!match_token(parser, TOKEN_SEMICOLON)) {
         return false;
     }
     stmt->expr = expr;
-    stmt->has_expr = true;
     return true;
 }
 
@@ -391,179 +759,250 @@ static struct binding_power {
 static int left_binding_powers[TOKEN_EOF] = {[TOKEN_BANG] = 15, [TOKEN_MINUS] = 15};
 static int right_binding_powers[TOKEN_EOF] = {[TOKEN_LPAREN] = 16};
 
-static struct abc_expr *parse_expr(struct abc_parser *parser, int precedence) {
-    assert(precedence >= 0);
-    struct abc_expr *lhs;
-    if ((lhs = parse_expr_lhs(parser)) == NULL) {
-        return NULL;
-    }
+/*
+ * Expressions are parsed without recursion. Every operator whose right operand is still being parsed has a frame on
+ * parser->expr_frames, together with the precedence its operand must bind tighter than. When an operand is complete
+ * the next token either starts a new frame (it binds tighter than the top frame) or the top frame is reduced into a
+ * node, which becomes the operand of the frame below. Nesting depth is therefore only limited by memory.
+ */
+static void push_frame(struct abc_parser *parser, struct expr_frame frame) {
+    abc_arr_push(&parser->expr_frames, &frame);
+}
+
+static struct expr_frame *top_frame(struct abc_parser *parser) {
+    return (struct expr_frame *) parser->expr_frames.data + parser->expr_frames.len - 1;
+}
 
-    int right_bp;
-    struct binding_power binding_power;
-    while (1) {
-        struct abc_token token = abc_lexer_peek(parser->lexer);
-        if ((right_bp = right_binding_powers[token.type]) > 0) {
-            if (right_bp < precedence) {
+// Report the failure of every pending frame down to base, innermost first.
+static void unwind_frames(struct abc_parser *parser, size_t base) {
+    while (parser->expr_frames.len > base) {
+        struct expr_frame frame = *top_frame(parser);
+        parser->expr_frames.len--;
+        switch ((enum expr_frame_kind) frame.kind) {
+            case FRAME_UNARY:
+                report_error(parser, peek_token(parser).offset, "failed to parse unary expr");
+                break;
+            case FRAME_BINARY:
+                report_error(parser, frame.offset, "failed to parse binary expr");
+                report_error(parser, frame.offset, "failed to parse infix expr");
+                break;
+            case FRAME_ASSIGN:
+                report_error(parser, peek_token(parser).offset, "failed to parse assign expr");
+                report_error(parser, frame.offset, "failed to parse infix expr");
+                break;
+            case FRAME_GROUPING:
+                report_error(parser, peek_token(parser).offset, "failed to parse grouping expr");
+                break;
+            case FRAME_CALL:
+                parser->scratch_args.len = frame.args_base;
+                break;
+            case FRAME_ROOT:
                 break;
-            }
-            struct abc_expr *tmp = parse_expr_postfix(parser, lhs);
-            if (tmp == NULL) {
-                return NULL;
-            }
-            lhs = tmp;
-            continue;
-        }
-        if ((binding_power = binding_powers[token.type]).left <= 0 || binding_power.left < precedence) {
-            break;
-        }
-        struct abc_expr *tmp = parse_infix_expr(parser, lhs, binding_power.right);
-        if (tmp == NULL) {
-            report_error(parser, token.line, "failed to parse infix expr");
-            return NULL;
         }
-        lhs = tmp;
     }
-
-    return lhs;
 }
 
-static struct abc_expr *parse_expr_lhs(struct abc_parser *parser) {
-    struct abc_token token = abc_lexer_peek(parser->lexer);
-    struct abc_expr *expr = abc_expr(parser->pool);
+// Parse a leaf, or push the frame of a prefix operator. Returns ABC_NODE_NONE with ok set when a frame was pushed.
+static abc_node parse_operand(struct abc_parser *parser, bool *ok) {
+    struct abc_token token = peek_token(parser);
+    struct abc_expr expr = {0};
+    long value;
+    *ok = true;
     switch (token.type) {
         case TOKEN_INT:
-            expr->tag = ABC_EXPR_LITERAL;
-            expr->val.lit_expr.lit.tag = ABC_LITERAL_INT;
-            expr->val.lit_expr.lit.val.integer = (long) token.data;
-            (void) match_token(parser, token.type);
-            return expr;
+            expr.tag = ABC_EXPR_LITERAL;
+            expr.lit_tag = ABC_LITERAL_INT;
+            value = abc_lexer_token_int(parser->lexer, &token);
+            expr.val.lit_expr.val.integer = (uint32_t) parser->ast->ints.len;
+            abc_arr_push(&parser->ast->ints, &value);
+            (void) next_token(parser);
+            return push_expr(parser, &expr);
         case TOKEN_IDENTIFIER:
-            expr->tag = ABC_EXPR_LITERAL;
-            expr->val.lit_expr.lit.tag = ABC_LITERAL_ID;
-            expr->val.lit_expr.lit.val.identifier = token;
-            (void) abc_lexer_next_token(parser->lexer);
-            return expr;
+            expr.tag = ABC_EXPR_LITERAL;
+            expr.lit_tag = ABC_LITERAL_ID;
+            expr.val.lit_expr.val.identifier = token.sym;
+            (void) next_token(parser);
+            return push_expr(parser, &expr);
         case TOKEN_LPAREN:
-            (void) match_token(parser, token.type);
-            expr->tag = ABC_EXPR_GROUPING;
-            expr->val.grouping_expr.expr = parse_expr(parser, 0);
-            if (expr->val.grouping_expr.expr == NULL) {
-                report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse grouping expr");
-                return NULL;
-            }
-            if (!match_token(parser, TOKEN_RPAREN)) {
-                return NULL;
-            }
-            return expr;
+            (void) next_token(parser);
+            push_frame(parser, (struct expr_frame) {.kind = FRAME_GROUPING, .precedence = 0});
+            return ABC_NODE_NONE;
         case TOKEN_BANG:
             // fall through
         case TOKEN_MINUS:
-            expr->tag = ABC_EXPR_UNARY;
-            expr->val.unary_expr.op = token;
-            expr->val.unary_expr.expr = parse_expr(parser, left_binding_powers[token.type]);
-            if (expr->val.unary_expr.expr == NULL) {
-                (void) match_token(parser, token.type);
-                report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse unary expr");
-                return NULL;
-            }
-            (void) abc_lexer_next_token(parser->lexer);
-            return expr;
+            (void) next_token(parser);
+            push_frame(parser, (struct expr_frame) {
+                    .kind = FRAME_UNARY, .op = (uint8_t) token.type, .precedence = left_binding_powers[token.type]});
+            return ABC_NODE_NONE;
         default:
-            report_error(parser, token.line, "unexpected token to start expr: %s", token.lexeme);
-            (void) match_token(parser, token.type);
-            return NULL;
+            report_error(parser, token.offset, "unexpected token to start expr: " TOKEN_FMT, TOKEN_ARG(parser, token));
+            (void) next_token(parser);
+            *ok = false;
+            return ABC_NODE_NONE;
     }
-    assert(0); // unreachable
 }
 
-// lhs is freed on success, on failure it is not.
-static struct abc_expr *parse_expr_postfix(struct abc_parser *parser, struct abc_expr *lhs) {
+// Start a call frame for lhs, the current token is the opening parenthesis.
+static bool start_call(struct abc_parser *parser, abc_node lhs) {
     // only function calls currently
-    if (lhs->tag != ABC_EXPR_LITERAL || lhs->val.lit_expr.lit.tag != ABC_LITERAL_ID) {
-        report_error(parser, abc_lexer_peek(parser->lexer).line, "expect identifier as func name");
-        return NULL;
-    }
-    if (!match_token(parser, TOKEN_LPAREN)) {
-        return NULL;
-    }
-    struct abc_token token = abc_lexer_peek(parser->lexer);
-    struct abc_arr args;
-    abc_arr_init(&args, sizeof(struct abc_expr *), abc_pool_create());
-    bool has_err = false;
-    while (token.type != TOKEN_RPAREN) {
-        struct abc_expr *arg = parse_expr(parser, 0);
-        if (arg == NULL) {
-            has_err = true;
-            break;
-        }
-        abc_arr_push(&args, &arg);
-        token = abc_lexer_peek(parser->lexer);
-        if (token.type == TOKEN_COMMA) {
-            (void) match_token(parser, token.type);
-            token = abc_lexer_peek(parser->lexer);
-        }
-    }
-
-    if (!has_err) {
-        (void) match_token(parser, TOKEN_RPAREN);
-        struct abc_expr *res = abc_expr(parser->pool);
-        abc_arr_migrate_pool(&args, parser->pool);
-        res->tag = ABC_EXPR_CALL;
-        res->val.call_expr.args = args;
-        res->val.call_expr.callee = lhs->val.lit_expr.lit;
-        return res;
+    struct abc_expr *callee = abc_ast_expr(parser->ast, lhs);
+    if (callee->tag != ABC_EXPR_LITERAL || callee->lit_tag != ABC_LITERAL_ID) {
+        report_error(parser, peek_token(parser).offset, "expect identifier as func name");
+        return false;
     }
-    // cleanup
-    abc_pool_destroy(args.pool);
-    return NULL;
+    (void) next_token(parser);
+    push_frame(parser, (struct expr_frame) {
+            .kind = FRAME_CALL,
+            .precedence = 0,
+            .identifier = callee->val.lit_expr.val.identifier,
+            .args_base = parser->scratch_args.len,
+    });
+    return true;
 }
 
-// lhs might be freed on success, but never on error.
-struct abc_expr *parse_infix_expr(struct abc_parser *parser, struct abc_expr *lhs, int precedence) {
-    struct abc_token op = abc_lexer_next_token(parser->lexer);
+// Start a binary or assignment frame with lhs as left operand, the current token is the operator.
+static bool start_infix(struct abc_parser *parser, abc_node lhs, int precedence) {
+    struct abc_token op = next_token(parser);
     if (op.type == TOKEN_EQUALS) {
         // assign expr
-        if (lhs->tag != ABC_EXPR_LITERAL || lhs->val.lit_expr.lit.tag != ABC_LITERAL_ID) {
-            report_error(parser, abc_lexer_peek(parser->lexer).line, "expect identifier as lhs of assign");
-            return NULL;
-        }
-        struct abc_expr *rhs = parse_expr(parser, precedence);
-        if (rhs == NULL) {
-            report_error(parser, abc_lexer_peek(parser->lexer).line, "failed to parse assign expr");
-            return NULL;
+        struct abc_expr *target = abc_ast_expr(parser->ast, lhs);
+        if (target->tag != ABC_EXPR_LITERAL || target->lit_tag != ABC_LITERAL_ID) {
+            report_error(parser, peek_token(parser).offset, "expect identifier as lhs of assign");
+            report_error(parser, op.offset, "failed to parse infix expr");
+            return false;
         }
-        struct abc_expr *res = abc_expr(parser->pool);
-        res->tag = ABC_EXPR_ASSIGN;
-        res->val.assign_expr.lit.tag = ABC_LITERAL_ID;
-        res->val.assign_expr.lit.val.identifier = lhs->val.lit_expr.lit.val.identifier;
-        res->val.assign_expr.expr = rhs;
-        return res;
+        push_frame(parser, (struct expr_frame) {
+                .kind = FRAME_ASSIGN,
+                .precedence = precedence,
+                .offset = op.offset,
+                .identifier = target->val.lit_expr.val.identifier,
+        });
+        return true;
     }
     if (op.type == TOKEN_PLUS || op.type == TOKEN_MINUS || op.type == TOKEN_STAR || op.type == TOKEN_SLASH ||
         op.type == TOKEN_AND || op.type == TOKEN_OR || op.type == TOKEN_GREATER || op.type == TOKEN_GREATER_EQUALS ||
         op.type == TOKEN_LESS || op.type == TOKEN_LESS_EQUALS || op.type == TOKEN_EQUALS_EQUALS ||
         op.type == TOKEN_BANG_EQUALS) {
         // binary expr
-        struct abc_expr *rhs = parse_expr(parser, precedence);
-        if (!rhs) {
-            report_error(parser, op.line, "failed to parse binary expr");
-            return NULL;
-        }
-        struct abc_expr *res = abc_expr(parser->pool);
-        res->tag = ABC_EXPR_BINARY;
-        res->val.bin_expr.op = op;
-        res->val.bin_expr.left = lhs;
-        res->val.bin_expr.right = rhs;
-        return res;
+        push_frame(parser, (struct expr_frame) {
+                .kind = FRAME_BINARY, .op = (uint8_t) op.type, .precedence = precedence, .offset = op.offset,
+                .lhs = lhs});
+        return true;
     }
     // invalid op
-    report_error(parser, op.line, "unexpected binary expression operation token '%s'", op.lexeme);
-    return NULL;
+    report_error(parser, op.offset, "unexpected binary expression operation token '" TOKEN_FMT "'",
+                 TOKEN_ARG(parser, op));
+    report_error(parser, op.offset, "failed to parse infix expr");
+    return false;
+}
+
+/*
+ * Reduce the top frame with its completed operand. Returns the resulting node, or ABC_NODE_NONE with *more set when
+ * the frame expects another operand (the next call argument).
+ */
+static abc_node reduce_frame(struct abc_parser *parser, abc_node operand, bool *more, bool *ok) {
+    struct expr_frame frame = *top_frame(parser);
+    struct abc_expr res = {0};
+    *more = false;
+    *ok = true;
+    switch ((enum expr_frame_kind) frame.kind) {
+        case FRAME_UNARY:
+            res.tag = ABC_EXPR_UNARY;
+            res.op = frame.op;
+            res.val.unary_expr.expr = operand;
+            break;
+        case FRAME_BINARY:
+            res.tag = ABC_EXPR_BINARY;
+            res.op = frame.op;
+            res.val.bin_expr.left = frame.lhs;
+            res.val.bin_expr.right = operand;
+            break;
+        case FRAME_ASSIGN:
+            res.tag = ABC_EXPR_ASSIGN;
+            res.val.assign_expr.identifier = frame.identifier;
+            res.val.assign_expr.expr = operand;
+            break;
+        case FRAME_GROUPING:
+            if (!match_token(parser, TOKEN_RPAREN)) {
+                parser->expr_frames.len--;
+                *ok = false;
+                return ABC_NODE_NONE;
+            }
+            res.tag = ABC_EXPR_GROUPING;
+            res.val.grouping_expr.expr = operand;
+            break;
+        case FRAME_CALL:
+            abc_arr_push(&parser->scratch_args, &operand);
+            if (peek_token(parser).type == TOKEN_COMMA) {
+                (void) next_token(parser);
+            }
+            if (peek_token(parser).type != TOKEN_RPAREN) {
+                *more = true;
+                return ABC_NODE_NONE;
+            }
+            (void) next_token(parser);
+            res.tag = ABC_EXPR_CALL;
+            res.val.call_expr.callee = frame.identifier;
+            res.val.call_expr.args = flush_scratch(&parser->scratch_args, frame.args_base, &parser->ast->args);
+            break;
+        case FRAME_ROOT:
+            assert(0);
+    }
+    parser->expr_frames.len--;
+    return push_expr(parser, &res);
+}
+
+static abc_node parse_expr(struct abc_parser *parser, int precedence) {
+    assert(precedence >= 0);
+    size_t base = parser->expr_frames.len;
+    push_frame(parser, (struct expr_frame) {.kind = FRAME_ROOT, .precedence = precedence});
+
+    abc_node operand = ABC_NODE_NONE;
+    bool ok = true;
+    bool more;
+    while (ok) {
+        if (operand == ABC_NODE_NONE) {
+            operand = parse_operand(parser, &ok);
+            continue;
+        }
+        struct abc_token token = peek_token(parser);
+        int frame_precedence = top_frame(parser)->precedence;
+        int right_bp;
+        struct binding_power binding_power;
+        if ((right_bp = right_binding_powers[token.type]) > 0 && right_bp >= frame_precedence) {
+            ok = start_call(parser, operand);
+            operand = ABC_NODE_NONE;
+            // an empty argument list completes the call right away
+            if (ok && peek_token(parser).type == TOKEN_RPAREN) {
+                struct expr_frame frame = *top_frame(parser);
+                struct abc_expr res = {.tag = ABC_EXPR_CALL, .val.call_expr.callee = frame.identifier};
+                (void) next_token(parser);
+                res.val.call_expr.args = flush_scratch(&parser->scratch_args, frame.args_base, &parser->ast->args);
+                parser->expr_frames.len--;
+                operand = push_expr(parser, &res);
+            }
+            continue;
+        }
+        if (right_bp == 0 && (binding_power = binding_powers[token.type]).left > 0 &&
+            binding_power.left >= frame_precedence) {
+            ok = start_infix(parser, operand, binding_power.right);
+            operand = ABC_NODE_NONE;
+            continue;
+        }
+        if (top_frame(parser)->kind == FRAME_ROOT) {
+            parser->expr_frames.len = base;
+            return operand;
+        }
+        operand = reduce_frame(parser, operand, &more, &ok);
+    }
+
+    unwind_frames(parser, base);
+    return ABC_NODE_NONE;
 }
 
 /* MISC */
-static void print_stmt(struct abc_stmt *stmt, FILE *f, int indent);
-static void print_expr(struct abc_expr *expr, FILE *f);
+static void print_stmt(struct abc_program *program, struct abc_ast *ast, abc_node node, FILE *f, int indent);
+static void print_expr(struct abc_program *program, struct abc_ast *ast, abc_node node, FILE *f);
 
 static void print_indent(int indent, FILE *f) {
     for (int i = 0; i < indent * 4; i++) {
@@ -571,102 +1010,106 @@ static void print_indent(int indent, FILE *f) {
     }
 }
 
-static void print_decl(struct abc_decl *decl, FILE *f, int indent) {
+static void print_decl(struct abc_program *program, struct abc_ast *ast, struct abc_decl *decl, FILE *f, int indent) {
     if (decl->tag == ABC_DECL_STMT) {
-        print_stmt(&decl->val.stmt.stmt, f, indent);
+        print_stmt(program, ast, decl->val.stmt.stmt, f, indent);
     } else {
         struct abc_var_decl var_decl = decl->val.var;
         print_indent(indent, f);
-        fprintf(f, "%s ", var_decl.type == PARSER_TYPE_INT ? "int" : "void");
-        fprintf(f, "%s", var_decl.name.lexeme);
-        if (!var_decl.has_init) {
+        fprintf(f, "%s ", decl->type == PARSER_TYPE_INT ? "int" : "void");
+        fprintf(f, "%s", abc_intern_str(program->symbols, var_decl.name));
+        if (var_decl.init == ABC_NODE_NONE) {
             fprintf(f, ";\n");
             return;
         }
         fprintf(f, " = ");
-        print_expr(var_decl.init, f);
+        print_expr(program, ast, var_decl.init, f);
         fprintf(f, ";\n");
     }
 }
 
-static void print_block_stmt(struct abc_block_stmt *block_stmt, FILE *f, int indent) {
+static void print_block_stmt(struct abc_program *program, struct abc_ast *ast, struct abc_block_stmt *block_stmt,
+                             FILE *f, int indent) {
     fprintf(f, "{\n");
+    struct abc_decl *decls = abc_ast_decls(ast, block_stmt->decls);
     for (size_t i = 0; i < block_stmt->decls.len; i++) {
-        struct abc_decl decl = ((struct abc_decl *)block_stmt->decls.data)[i];
-        print_decl(&decl, f, indent);
+        print_decl(program, ast, &decls[i], f, indent);
     }
     print_indent(indent - 1, f);
     fprintf(f, "}\n");
 }
 
-static void print_stmt(struct abc_stmt *stmt, FILE *f, int indent) {
-    switch (stmt->tag) {
+static void print_stmt(struct abc_program *program, struct abc_ast *ast, abc_node node, FILE *f, int indent) {
+    struct abc_stmt *stmt = abc_ast_stmt(ast, node);
+    switch ((enum abc_stmt_tag) stmt->tag) {
         case ABC_STMT_EXPR:
             print_indent(indent, f);
-            print_expr(stmt->val.expr_stmt.expr, f);
+            print_expr(program, ast, stmt->val.expr_stmt.expr, f);
             fprintf(f, ";\n");
             break;
         case ABC_STMT_IF:
             print_indent(indent, f);
             fprintf(f, "if (");
-            print_expr(stmt->val.if_stmt.cond, f);
+            print_expr(program, ast, stmt->val.if_stmt.cond, f);
             fprintf(f, ")");
-            print_stmt(stmt->val.if_stmt.then_stmt, f, indent);
-            if (stmt->val.if_stmt.has_else) {
+            print_stmt(program, ast, stmt->val.if_stmt.then_stmt, f, indent);
+            if (stmt->val.if_stmt.else_stmt != ABC_NODE_NONE) {
                 print_indent(indent, f);
                 fprintf(f, "else ");
-                print_stmt(stmt->val.if_stmt.else_stmt, f, indent);
+                print_stmt(program, ast, stmt->val.if_stmt.else_stmt, f, indent);
             }
             break;
         case ABC_STMT_WHILE:
             print_indent(indent, f);
             fprintf(f, "while (");
-            print_expr(stmt->val.while_stmt.cond, f);
+            print_expr(program, ast, stmt->val.while_stmt.cond, f);
             fprintf(f, ")");
-            print_stmt(stmt->val.while_stmt.body, f, indent + 1);
+            print_stmt(program, ast, stmt->val.while_stmt.body, f, indent + 1);
             break;
         case ABC_STMT_BLOCK:
-            print_block_stmt(&stmt->val.block_stmt, f, indent + 1);
+            print_block_stmt(program, ast, &stmt->val.block_stmt, f, indent + 1);
             break;
         case ABC_STMT_PRINT:
             print_indent(indent, f);
             fprintf(f, "print(");
-            print_expr(stmt->val.print_stmt.expr, f);
+            print_expr(program, ast, stmt->val.print_stmt.expr, f);
             fprintf(f, ");\n");
             break;
         case ABC_STMT_RETURN:
             print_indent(indent, f);
             fprintf(f, "return");
-            if (stmt->val.return_stmt.has_expr) {
+            if (stmt->val.return_stmt.expr != ABC_NODE_NONE) {
                 fprintf(f, " ");
-                print_expr(stmt->val.return_stmt.expr, f);
+                print_expr(program, ast, stmt->val.return_stmt.expr, f);
             }
             fprintf(f, ";\n");
             break;
     }
 }
 
-static void print_expr(struct abc_expr *expr, FILE *f) {
-    switch (expr->tag) {
+static void print_expr(struct abc_program *program, struct abc_ast *ast, abc_node node, FILE *f) {
+    struct abc_expr *expr = abc_ast_expr(ast, node);
+    abc_node *args;
+    switch ((enum abc_expr_tag) expr->tag) {
         case ABC_EXPR_BINARY:
             fprintf(f, "(");
-            print_expr(expr->val.bin_expr.left, f);
-            fprintf(f, " %s ", expr->val.bin_expr.op.lexeme);
-            print_expr(expr->val.bin_expr.right, f);
+            print_expr(program, ast, expr->val.bin_expr.left, f);
+            fprintf(f, " %s ", abc_lexer_token_type_str(expr->op));
+            print_expr(program, ast, expr->val.bin_expr.right, f);
             fprintf(f, ")");
             break;
         case ABC_EXPR_UNARY:
             fprintf(f, "(");
-            fprintf(f, "%s", expr->val.unary_expr.op.lexeme);
-            print_expr(expr->val.unary_expr.expr, f);
+            fprintf(f, "%s", abc_lexer_token_type_str(expr->op));
+            print_expr(program, ast, expr->val.unary_expr.expr, f);
             fprintf(f, ")");
             break;
         case ABC_EXPR_CALL:
-            fprintf(f, "%s", expr->val.call_expr.callee.val.identifier.lexeme);
+            fprintf(f, "%s", abc_intern_str(program->symbols, expr->val.call_expr.callee));
             fprintf(f, "(");
+            args = abc_ast_args(ast, expr->val.call_expr.args);
             for (size_t i = 0; i < expr->val.call_expr.args.len; i++) {
-                struct abc_expr *arg = ((struct abc_expr **) expr->val.call_expr.args.data)[i];
-                print_expr(arg, f);
+                print_expr(program, ast, args[i], f);
                 if (i < expr->val.call_expr.args.len - 1) {
                     fprintf(f, ", ");
                 }
@@ -674,45 +1117,45 @@ static void print_expr(struct abc_expr *expr, FILE *f) {
             fprintf(f, ")");
             break;
         case ABC_EXPR_LITERAL:
-            if (expr->val.lit_expr.lit.tag == ABC_LITERAL_INT) {
-                fprintf(f, "%ld", expr->val.lit_expr.lit.val.integer);
+            if (expr->lit_tag == ABC_LITERAL_INT) {
+                fprintf(f, "%ld", abc_ast_int(ast, &expr->val.lit_expr));
             } else {
-                fprintf(f, "%s", expr->val.lit_expr.lit.val.identifier.lexeme);
+                fprintf(f, "%s", abc_intern_str(program->symbols, expr->val.lit_expr.val.identifier));
             }
             break;
         case ABC_EXPR_ASSIGN:
             fprintf(f, "(");
-            fprintf(f, "%s", expr->val.assign_expr.lit.val.identifier.lexeme);
+            fprintf(f, "%s", abc_intern_str(program->symbols, expr->val.assign_expr.identifier));
             fprintf(f, " = ");
-            print_expr(expr->val.assign_expr.expr, f);
+            print_expr(program, ast, expr->val.assign_expr.expr, f);
             fprintf(f, ")");
             break;
         case ABC_EXPR_GROUPING:
             fprintf(f, "(");
-            print_expr(expr->val.grouping_expr.expr, f);
+            print_expr(program, ast, expr->val.grouping_expr.expr, f);
             fprintf(f, ")");
             break;
     }
 }
 
-static void print_fun_decl(struct abc_fun_decl *fun_decl, FILE *f) {
+static void print_fun_decl(struct abc_program *program, struct abc_fun_decl *fun_decl, FILE *f) {
     fprintf(f, "%s ", fun_decl->type == PARSER_TYPE_INT ? "int" : "void");
-    fprintf(f, "%s(", fun_decl->name.lexeme);
+    fprintf(f, "%s(", abc_intern_str(program->symbols, fun_decl->name.sym));
     for (size_t i = 0; i < fun_decl->params.len; i++) {
         struct abc_param param = ((struct abc_param *)fun_decl->params.data)[i];
         fprintf(f, "%s ", param.type == PARSER_TYPE_INT ? "int" : "void");
-        fprintf(f, "%s", param.token.lexeme);
+        fprintf(f, "%s", abc_intern_str(program->symbols, param.token.sym));
         if (i < fun_decl->params.len - 1) {
             fprintf(f, ", ");
         }
     }
     fprintf(f, ") ");
-    print_block_stmt(&fun_decl->body, f, 1);
+    print_block_stmt(program, &fun_decl->ast, &abc_ast_stmt(&fun_decl->ast, fun_decl->body)->val.block_stmt, f, 1);
 }
 
 void abc_parser_print(struct abc_program *program, FILE *f) {
     for (size_t i = 0; i < program->fun_decls.len; i++) {
         struct abc_fun_decl fun_decl = ((struct abc_fun_decl *)program->fun_decls.data)[i];
-        print_fun_decl(&fun_decl, f);
+        print_fun_decl(program, &fun_decl, f);
     }
 }
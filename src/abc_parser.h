@@ -5,15 +5,13 @@
 #define ABC_PARSER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "data/abc_arr.h"
 #include "abc_lexer.h"
 #include "data/abc_pool.h"
 #include "abc_type.h"
 
-// Forward declarations needed for cyclic references.
-struct abc_expr;
-
 // misc
 
 enum abc_parser_type {
@@ -26,6 +24,19 @@ struct abc_param {
     struct abc_token token;
 };
 
+/*
+ * The AST of a function is stored in per-kind arrays, see struct abc_ast. Nodes refer to each other by 32-bit index,
+ * variable length children (block decls, call args) are ranges into side arrays.
+ */
+typedef uint32_t abc_node;
+
+#define ABC_NODE_NONE UINT32_MAX
+
+struct abc_range {
+    uint32_t start;
+    uint32_t len;
+};
+
 // BEGIN LIT
 
 enum abc_lit_tag {
@@ -33,14 +44,6 @@ enum abc_lit_tag {
     ABC_LITERAL_ID
 };
 
-struct abc_lit {
-	enum abc_lit_tag tag;
-    union {
-        struct abc_token identifier;
-        long integer;
-    } val;
-};
-
 // END LIT
 
 // BEGIN EXPR
@@ -55,37 +58,40 @@ enum abc_expr_tag {
 };
 
 struct abc_bin_expr {
-    struct abc_expr *left;
-    struct abc_expr *right;
-    struct abc_token op;
+    abc_node left;
+    abc_node right;
 };
 
 struct abc_unary_expr {
-    struct abc_token op;
-    struct abc_expr *expr;
+    abc_node expr;
 };
 
 struct abc_call_expr {
-    struct abc_lit callee;
-    struct abc_arr args;
+    abc_sym callee;
+    struct abc_range args; // abc_ast.args
 };
 
 struct abc_grouping_expr {
-    struct abc_expr *expr;
+    abc_node expr;
 };
 
 struct abc_lit_expr {
-    struct abc_lit lit;
+    union {
+        abc_sym identifier;
+        uint32_t integer; // index into abc_ast.ints
+    } val;
 };
 
 struct abc_assign_expr {
-    struct abc_lit lit;
-    struct abc_expr *expr;
+    abc_sym identifier;
+    abc_node expr;
 };
 
 struct abc_expr {
-    enum abc_expr_tag tag;
-    enum abc_type type; // set by typechecker
+    uint8_t tag; // enum abc_expr_tag
+    uint8_t type; // enum abc_type, set by typechecker
+    uint8_t op; // enum abc_token_type of binary and unary expressions
+    uint8_t lit_tag; // enum abc_lit_tag of literal expressions
     union {
         struct abc_bin_expr bin_expr;
         struct abc_unary_expr unary_expr;
@@ -96,10 +102,6 @@ struct abc_expr {
     } val;
 };
 
-static inline struct abc_expr *abc_expr(struct abc_pool *pool) {
-    return abc_pool_alloc(pool, sizeof(struct abc_expr), 1);
-}
-
 // END EXPR
 
 // BEGIN STMT
@@ -114,36 +116,34 @@ enum abc_stmt_tag {
 };
 
 struct abc_expr_stmt {
-    struct abc_expr *expr;
+    abc_node expr;
 };
 
 struct abc_if_stmt {
-    struct abc_expr *cond;
-    struct abc_stmt *then_stmt;
-    bool has_else;
-    struct abc_stmt *else_stmt;
+    abc_node cond;
+    abc_node then_stmt;
+    abc_node else_stmt; // ABC_NODE_NONE without else
 };
 
 struct abc_while_stmt {
-    struct abc_expr *cond;
-    struct abc_stmt *body;
+    abc_node cond;
+    abc_node body;
 };
 
 struct abc_block_stmt {
-    struct abc_arr decls;
+    struct abc_range decls; // abc_ast.decls
 };
 
 struct abc_print_stmt {
-    struct abc_expr *expr;
+    abc_node expr;
 };
 
 struct abc_return_stmt {
-    bool has_expr;
-    struct abc_expr *expr;
+    abc_node expr; // ABC_NODE_NONE for a bare return
 };
 
 struct abc_stmt {
-    enum abc_stmt_tag tag;
+    uint8_t tag; // enum abc_stmt_tag
     union {
 		struct abc_expr_stmt expr_stmt;
         struct abc_if_stmt if_stmt;
@@ -154,10 +154,6 @@ struct abc_stmt {
     } val;
 };
 
-static inline struct abc_stmt *abc_stmt(struct abc_pool *pool) {
-    return abc_pool_alloc(pool, sizeof(struct abc_stmt), 1);
-}
-
 // END STMT
 
 // BEGIN DECL
@@ -168,19 +164,17 @@ enum abc_decl_tag {
 };
 
 struct abc_var_decl {
-    enum abc_parser_type type;
-    struct abc_token name;
-    bool has_init;
-    // valid if has_init == true
-	struct abc_expr *init;
+    abc_sym name;
+    abc_node init; // ABC_NODE_NONE without initializer
 };
 
 struct abc_stmt_decl {
-    struct abc_stmt stmt;
+    abc_node stmt;
 };
 
 struct abc_decl {
-	enum abc_decl_tag tag;
+    uint8_t tag; // enum abc_decl_tag
+    uint8_t type; // enum abc_parser_type of variable declarations
     union {
 		struct abc_var_decl var;
 		struct abc_stmt_decl stmt;
@@ -190,30 +184,81 @@ struct abc_decl {
 // END DECL
 
 // BEGIN ROOT
+
+// Node storage of one function, all arrays are allocated in the parser pool.
+struct abc_ast {
+    struct abc_arr exprs; // abc_expr
+    struct abc_arr stmts; // abc_stmt
+    struct abc_arr decls; // abc_decl, children of block statements
+    struct abc_arr args; // abc_node, arguments of calls
+    struct abc_arr ints; // long, values of integer literals
+};
+
+static inline struct abc_expr *abc_ast_expr(const struct abc_ast *ast, abc_node node) {
+    return (struct abc_expr *) ast->exprs.data + node;
+}
+
+static inline struct abc_stmt *abc_ast_stmt(const struct abc_ast *ast, abc_node node) {
+    return (struct abc_stmt *) ast->stmts.data + node;
+}
+
+static inline struct abc_decl *abc_ast_decls(const struct abc_ast *ast, struct abc_range range) {
+    return (struct abc_decl *) ast->decls.data + range.start;
+}
+
+static inline abc_node *abc_ast_args(const struct abc_ast *ast, struct abc_range range) {
+    return (abc_node *) ast->args.data + range.start;
+}
+
+static inline long abc_ast_int(const struct abc_ast *ast, const struct abc_lit_expr *lit) {
+    return ((long *) ast->ints.data)[lit->val.integer];
+}
+
 struct abc_fun_decl {
     enum abc_parser_type type;
     struct abc_token name;
     // list of abc_param
     struct abc_arr params;
-    struct abc_block_stmt body;
+    abc_node body; // block statement
+    struct abc_ast ast;
 };
 
 struct abc_program {
     // List of abc_fun_decl
     struct abc_arr fun_decls;
+    // Identifier symbols, owned by the lexer.
+    struct abc_intern *symbols;
 };
 
 // END ROOT
 
 struct abc_parser {
     struct abc_lexer *lexer;
+    // When set tokens are read from the buffer instead of the lexer, pos is the index of the next token.
+    const struct abc_token_buf *tokens;
+    size_t pos;
     bool has_error;
+    FILE *err; // where errors are reported, stderr by default, NULL collects them in err_buf
+    FILE *err_stream;
+    char *err_buf;
+    size_t err_len;
     struct abc_pool *pool;
+    // AST of the function being parsed.
+    struct abc_ast *ast;
+    // Children of unfinished blocks and calls, moved into the AST side arrays once complete so ranges are contiguous.
+    struct abc_arr scratch_decls; // abc_decl
+    struct abc_arr scratch_args; // abc_node
+    // Operator stack of the expression parser.
+    struct abc_arr expr_frames;
 };
 
 // Initialize the parser.
 void abc_parser_init(struct abc_parser *parser, struct abc_lexer *lexer);
 
+// Initialize the parser to read from a pre-lexed token buffer, see abc_lexer_tokenize. The lexer is still used for
+// positions and source text in error messages.
+void abc_parser_init_tokens(struct abc_parser *parser, struct abc_lexer *lexer, const struct abc_token_buf *tokens);
+
 // Destroy the parser, deleting all memory allocated by it (including the parse tree).
 void abc_parser_destroy(struct abc_parser *parser);
 
@@ -223,4 +268,14 @@ void abc_parser_print(struct abc_program *program, FILE *f);
 // also be checked for errors.
 struct abc_program abc_parser_parse(struct abc_parser *parser);
 
+// Like abc_parser_parse, but only the function signatures are parsed on the calling thread. The bodies are parsed
+// concurrently on up to threads threads, each with its own pool, and their errors are reported in source order after
+// the signature errors. Requires a parser set up with abc_parser_init_tokens.
+struct abc_program abc_parser_parse_parallel(struct abc_parser *parser, size_t threads);
+
+// Like abc_parser_parse_parallel, but only the bodies of functions reachable from main through calls are parsed and
+// kept in the program. When check_unreachable is set the other bodies are parsed too, only to report their syntax
+// errors. Without a main function every body is parsed.
+struct abc_program abc_parser_parse_lazy(struct abc_parser *parser, size_t threads, bool check_unreachable);
+
 #endif //ABC_PARSER_H
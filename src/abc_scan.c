@@ -0,0 +1,122 @@
+/**
+ * The SSE2 variant processes full 16 byte chunks and leaves the remaining tail to the scalar loops, so the
+ * input never has to be padded and nothing past end is ever read.
+ */
+
+#include "abc_scan.h"
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ABC_SCAN_X86
+#endif
+
+/* SCALAR */
+
+static inline bool is_whitespace(uint8_t ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+static inline bool is_digit(uint8_t ch) { return (uint8_t) (ch - '0') <= 9; }
+
+static inline bool is_alnum(uint8_t ch) { return (uint8_t) ((ch | 0x20) - 'a') <= 25 || is_digit(ch); }
+
+static const uint8_t *scalar_skip_whitespace(const uint8_t *cur, const uint8_t *end) {
+    while (cur < end && is_whitespace(*cur)) {
+        cur++;
+    }
+    return cur;
+}
+
+static const uint8_t *scalar_skip_alnum(const uint8_t *cur, const uint8_t *end) {
+    while (cur < end && is_alnum(*cur)) {
+        cur++;
+    }
+    return cur;
+}
+
+static const uint8_t *scalar_skip_digits(const uint8_t *cur, const uint8_t *end) {
+    while (cur < end && is_digit(*cur)) {
+        cur++;
+    }
+    return cur;
+}
+
+const struct abc_scan abc_scan_scalar = {
+        .name = "scalar",
+        .skip_whitespace = scalar_skip_whitespace,
+        .skip_alnum = scalar_skip_alnum,
+        .skip_digits = scalar_skip_digits,
+};
+
+#ifdef ABC_SCAN_X86
+
+/* SSE2 */
+
+#define SSE2 __attribute__((target("sse2")))
+
+// unsigned (x - lo) <= range, per byte.
+SSE2 static inline __m128i sse2_in_range(__m128i x, char lo, char range) {
+    __m128i off = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(off, _mm_set1_epi8(range)), off);
+}
+
+SSE2 static const uint8_t *sse2_skip_whitespace(const uint8_t *cur, const uint8_t *end) {
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) cur);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')),
+                                               _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')),
+                                               _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+        unsigned mask = (unsigned) _mm_movemask_epi8(ws);
+        if (mask != 0xFFFF) {
+            return cur + __builtin_ctz(~mask);
+        }
+        cur += 16;
+    }
+    return scalar_skip_whitespace(cur, end);
+}
+
+SSE2 static const uint8_t *sse2_skip_alnum(const uint8_t *cur, const uint8_t *end) {
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) cur);
+        __m128i alpha = sse2_in_range(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 25);
+        __m128i digit = sse2_in_range(chunk, '0', 9);
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_or_si128(alpha, digit));
+        if (mask != 0xFFFF) {
+            return cur + __builtin_ctz(~mask);
+        }
+        cur += 16;
+    }
+    return scalar_skip_alnum(cur, end);
+}
+
+SSE2 static const uint8_t *sse2_skip_digits(const uint8_t *cur, const uint8_t *end) {
+    while (end - cur >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) cur);
+        unsigned mask = (unsigned) _mm_movemask_epi8(sse2_in_range(chunk, '0', 9));
+        if (mask != 0xFFFF) {
+            return cur + __builtin_ctz(~mask);
+        }
+        cur += 16;
+    }
+    return scalar_skip_digits(cur, end);
+}
+
+const struct abc_scan abc_scan_sse2 = {
+        .name = "sse2",
+        .skip_whitespace = sse2_skip_whitespace,
+        .skip_alnum = sse2_skip_alnum,
+        .skip_digits = sse2_skip_digits,
+};
+
+#endif // ABC_SCAN_X86
+
+const struct abc_scan *abc_scan_select(void) {
+#ifdef ABC_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return &abc_scan_sse2;
+    }
+#endif
+    return &abc_scan_scalar;
+}
@@ -0,0 +1,34 @@
+/***
+ * abc_scan.h
+ *
+ * Byte scanning primitives used by the lexer for its hot loops. The SSE2 variant is selected at runtime, with a
+ * scalar fallback for other targets.
+ */
+
+#ifndef ABC_SCAN_H
+#define ABC_SCAN_H
+
+#include <stdint.h>
+
+struct abc_scan {
+    const char *name;
+    // Skip ' ', '\t', '\r' and '\n', returning the first other byte (or end).
+    const uint8_t *(*skip_whitespace)(const uint8_t *cur, const uint8_t *end);
+    // Returns the end of the run of [a-zA-Z0-9] starting at cur.
+    const uint8_t *(*skip_alnum)(const uint8_t *cur, const uint8_t *end);
+    // Returns the end of the run of [0-9] starting at cur.
+    const uint8_t *(*skip_digits)(const uint8_t *cur, const uint8_t *end);
+};
+
+extern const struct abc_scan abc_scan_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct abc_scan abc_scan_sse2;
+#endif
+
+/**
+ * Select the fastest implementation supported by the running CPU, as measured by bench/scan_bench.c.
+ * @return the scan implementation.
+ */
+const struct abc_scan *abc_scan_select(void);
+
+#endif // ABC_SCAN_H
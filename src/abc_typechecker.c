@@ -1,34 +1,66 @@
 /**
- * Lots of improvements possible here, for example a map/environment structure for handling scopes,
- * error messages should be centralized and include line numbers etc.
+ * Lots of improvements possible here, for example error messages should be centralized and include line numbers etc.
  *
  */
 
 #include "abc_typechecker.h"
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "data/abc_map.h"
+#include "data/abc_parallel.h"
+
 struct abc_typechecker {
     struct abc_pool *pool;
+    struct abc_intern *symbols;
+    // AST of the function being checked.
+    struct abc_ast *ast;
     enum abc_parser_type curr_fun_type;
-    // TODO: these should be a map for better efficiency
-    struct abc_arr types;
-    struct abc_arr formals;
+    size_t curr_fun; // index of the function being checked, it may only call itself and earlier functions
+    struct abc_map types; // abc_sym -> type, scoped
+    const struct abc_map *formals; // abc_sym -> formals, shared between workers and only read while checking bodies
+    FILE *err; // where errors are reported, NULL collects them in err_buf
+    FILE *err_stream;
+    char *err_buf;
+    size_t err_len;
+    // explicit stacks of typecheck_expr
+    struct abc_arr expr_frames;
+    struct abc_arr expr_results;
 };
 
 struct type {
-    char *name;
+    abc_sym name;
     enum abc_type type;
-    bool marker;
 };
 
 // function argument types
 struct formals {
-    char *name;
+    abc_sym name;
+    size_t index; // of the function in the program
     struct abc_arr types;
     enum abc_type ret_type;
-    bool marker;
+};
+
+// result of the signature pass for one function
+enum signature_status {
+    SIGNATURE_OK,
+    SIGNATURE_VOID_PARAM,
+    SIGNATURE_REDEFINED,
+};
+
+struct fun_check {
+    enum signature_status status;
+    bool err;
+    char *errors;
+    size_t errors_len;
+};
+
+struct parallel_check {
+    struct abc_typechecker *workers;
+    struct abc_program *program;
+    struct fun_check *checks;
 };
 
 struct typecheck_result {
@@ -36,123 +68,197 @@ struct typecheck_result {
     enum abc_type type;
 };
 
+/*
+ * Expressions are checked in post-order with an explicit stack instead of recursion. A frame is stepped each time one
+ * of its children completes, the results of completed children are kept on tc->expr_results.
+ */
+struct expr_frame {
+    abc_node node;
+    uint32_t next; // number of children visited
+    enum abc_type type; // type of the assignment target
+    const struct type *params; // formals of the callee
+    enum abc_type ret_type;
+};
+
 void abc_typechecker_init(struct abc_typechecker *typechecker) {
     typechecker->pool = abc_pool_create();
-    abc_arr_init(&typechecker->types, sizeof(struct type), typechecker->pool);
-    abc_arr_init(&typechecker->formals, sizeof(struct formals), typechecker->pool);
+    typechecker->formals = NULL;
+    typechecker->err = stderr;
+    typechecker->err_stream = NULL;
+    abc_map_init(&typechecker->types, sizeof(struct type), typechecker->pool);
+    abc_arr_init(&typechecker->expr_frames, sizeof(struct expr_frame), typechecker->pool);
+    abc_arr_init(&typechecker->expr_results, sizeof(struct typecheck_result), typechecker->pool);
 }
 
 void abc_typechecker_destroy(struct abc_typechecker *typechecker) { abc_pool_destroy(typechecker->pool); }
 
-static bool push_formals(struct abc_typechecker *tc, struct formals *formals) {
-    int found_depth = -1;
-    int depth = 0;
-    for (size_t i = 0; i < tc->formals.len; i++) {
-        struct formals f = ((struct formals *) tc->formals.data)[i];
-        if (f.marker) {
-            depth++;
-            continue;
-        }
-        if (strcmp(f.name, formals->name) == 0) {
-            found_depth = (int) depth;
-        }
+static FILE *error_stream(struct abc_typechecker *tc) {
+    if (tc->err != NULL) {
+        return tc->err;
     }
-    if (found_depth == depth) {
-        return false;
+    if (tc->err_stream == NULL && (tc->err_stream = open_memstream(&tc->err_buf, &tc->err_len)) == NULL) {
+        fprintf(stderr, "failed to create error buffer\n");
+        exit(EXIT_FAILURE);
     }
-    abc_arr_push(&tc->formals, formals);
-    return true;
+    return tc->err_stream;
 }
 
-static bool lookup_formals(struct abc_typechecker *tc, const char *name, struct formals *formals) {
-    bool found = false;
-    for (size_t i = 0; i < tc->formals.len; i++) {
-        struct formals f = ((struct formals *) tc->formals.data)[i];
-        if (f.marker) {
-            continue;
-        }
-        if (strcmp(f.name, name) == 0) {
-            found = true;
-            *formals = f;
-        }
+// Hands the errors collected since the last call over to the caller, who must free them.
+static char *take_errors(struct abc_typechecker *tc, size_t *len) {
+    if (tc->err_stream == NULL) {
+        *len = 0;
+        return NULL;
     }
-    return found;
-}
-
-static void push_type_scope(struct abc_typechecker *tc) {
-    struct type type = {.marker = true};
-    abc_arr_push(&tc->types, &type);
+    fclose(tc->err_stream);
+    tc->err_stream = NULL;
+    *len = tc->err_len;
+    return tc->err_buf;
 }
 
-static void pop_type_scope(struct abc_typechecker *tc) {
-    for (size_t i = 0; i < tc->types.len; i++) {
-        struct type type = ((struct type *) tc->types.data)[tc->types.len - (i + 1)];
-        if (type.marker) {
-            tc->types.len = tc->types.len - (i + 1);
-            break;
-        }
+static bool lookup_formals(struct abc_typechecker *tc, abc_sym name, struct formals *formals) {
+    struct formals *f = abc_map_get(tc->formals, name);
+    if (f == NULL || f->index > tc->curr_fun) {
+        return false;
     }
+    *formals = *f;
+    return true;
 }
 
+static void push_type_scope(struct abc_typechecker *tc) { abc_map_push_scope(&tc->types); }
+
+static void pop_type_scope(struct abc_typechecker *tc) { abc_map_pop_scope(&tc->types); }
+
+// Returns false if the name is already declared in the innermost scope.
 static bool push_type(struct abc_typechecker *tc, struct type *type) {
-    int depth = 0;
-    int found_depth = -1;
-    for (size_t i = 0; i < tc->types.len; i++) {
-        struct type t = ((struct type *) tc->types.data)[i];
-        if (t.marker) {
-            depth++;
-            continue;
-        }
-        if (strcmp(t.name, type->name) == 0) {
-            found_depth = (int) depth;
-        }
+    if (abc_map_get_local(&tc->types, type->name) != NULL) {
+        return false;
     }
-    if (found_depth == depth) {
+    abc_map_put(&tc->types, type->name, type);
+    return true;
+}
+
+static bool lookup_type(struct abc_typechecker *tc, abc_sym name, struct type *type) {
+    struct type *t = abc_map_get(&tc->types, name);
+    if (t == NULL) {
         return false;
     }
-    abc_arr_push(&tc->types, type);
+    *type = *t;
     return true;
 }
 
-static bool lookup_type(struct abc_typechecker *tc, const char *name, struct type *type) {
-    bool found = false;
-    for (size_t i = 0; i < tc->types.len; i++) {
-        unsigned long offset = tc->types.len - (i + 1);
-        struct type *t = (struct type *) tc->types.data + offset;
-        if (t->marker) {
+static struct typecheck_result typecheck_fun(struct abc_typechecker *tc, struct abc_fun_decl *fun, size_t index,
+                                             enum signature_status status);
+static struct typecheck_result typecheck_decl(struct abc_typechecker *tc, struct abc_decl *decl);
+static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, abc_node node);
+static struct typecheck_result typecheck_block_stmt(struct abc_typechecker *tc, struct abc_block_stmt *block);
+static struct typecheck_result typecheck_expr(struct abc_typechecker *tc, abc_node node);
+
+/*
+ * Collect the formals of every function, in order. A function with a void parameter is left out and a redefinition
+ * does not replace the first definition, so only the status is recorded here and the error is reported together with
+ * the body errors.
+ */
+static void collect_signatures(struct abc_program *program, struct abc_map *formals_map, struct abc_pool *pool,
+                               struct fun_check *checks) {
+    for (size_t i = 0; i < program->fun_decls.len; i++) {
+        struct abc_fun_decl *fun = (struct abc_fun_decl *) program->fun_decls.data + i;
+        struct formals formals = {.name = fun->name.sym, .index = i, .ret_type = (enum abc_type) fun->type};
+        abc_arr_init_cap(&formals.types, sizeof(struct type), fun->params.len, pool);
+        checks[i].status = SIGNATURE_OK;
+        for (size_t j = 0; j < fun->params.len; j++) {
+            struct abc_param param = ((struct abc_param *) fun->params.data)[j];
+            if (param.type == PARSER_TYPE_VOID) {
+                checks[i].status = SIGNATURE_VOID_PARAM;
+                break;
+            }
+            struct type t = {.name = param.token.sym, .type = (enum abc_type) param.type};
+            abc_arr_push(&formals.types, &t);
+        }
+        if (checks[i].status != SIGNATURE_OK) {
             continue;
         }
-        if (strcmp(t->name, name) == 0) {
-            found = true;
-            *type = *t;
+        if (abc_map_get(formals_map, formals.name) != NULL) {
+            checks[i].status = SIGNATURE_REDEFINED;
+            continue;
         }
+        abc_map_put(formals_map, formals.name, &formals);
     }
+}
 
-    return found;
+static void check_fun_job(void *ctx, size_t worker_id, size_t index) {
+    struct parallel_check *pc = ctx;
+    struct abc_typechecker *tc = &pc->workers[worker_id];
+    struct fun_check *check = &pc->checks[index];
+    struct abc_fun_decl *fun = (struct abc_fun_decl *) pc->program->fun_decls.data + index;
+    check->err = typecheck_fun(tc, fun, index, check->status).err;
+    check->errors = take_errors(tc, &check->errors_len);
 }
 
-static struct typecheck_result typecheck_fun(struct abc_typechecker *tc, struct abc_fun_decl *fun);
-static struct typecheck_result typecheck_decl(struct abc_typechecker *tc, struct abc_decl *decl);
-static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, struct abc_stmt *stmt);
-static struct typecheck_result typecheck_block_stmt(struct abc_typechecker *tc, struct abc_block_stmt *block);
-static struct typecheck_result typecheck_expr(struct abc_typechecker *tc, struct abc_expr *expr);
+bool abc_typechecker_typecheck(struct abc_program *program) { return abc_typechecker_typecheck_parallel(program, 1); }
 
-bool abc_typechecker_typecheck(struct abc_program *program) {
+bool abc_typechecker_typecheck_parallel(struct abc_program *program, size_t threads) {
     bool ok = true;
-    struct abc_typechecker tc;
-    abc_typechecker_init(&tc);
-    for (size_t i = 0; i < program->fun_decls.len; i++) {
-        struct abc_fun_decl fun_decl = ((struct abc_fun_decl *) program->fun_decls.data)[i];
-        if (typecheck_fun(&tc, &fun_decl).err) {
+    size_t count = program->fun_decls.len;
+    struct abc_pool *pool = abc_pool_create();
+    struct fun_check *checks = abc_pool_alloc(pool, sizeof(struct fun_check), count > 0 ? count : 1);
+    struct abc_map formals;
+    abc_map_init(&formals, sizeof(struct formals), pool);
+    collect_signatures(program, &formals, pool, checks);
+
+    // Bodies are checked independently, each worker has its own scopes and pool. With a single worker errors go
+    // straight to stderr, otherwise they are buffered per function and reported in source order.
+    if (threads > count) {
+        threads = count;
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    struct parallel_check pc = {
+            .workers = malloc(sizeof(struct abc_typechecker) * threads),
+            .program = program,
+            .checks = checks,
+    };
+    if (pc.workers == NULL) {
+        fprintf(stderr, "typechecker allocation failed %s\n", __FILE__);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < threads; i++) {
+        abc_typechecker_init(&pc.workers[i]);
+        pc.workers[i].symbols = program->symbols;
+        pc.workers[i].formals = &formals;
+        pc.workers[i].err = threads > 1 ? NULL : stderr;
+    }
+    abc_parallel_for(count, threads, check_fun_job, &pc);
+    for (size_t i = 0; i < count; i++) {
+        if (checks[i].errors_len > 0) {
+            fwrite(checks[i].errors, 1, checks[i].errors_len, stderr);
+        }
+        free(checks[i].errors);
+        if (checks[i].err) {
             ok = false;
         }
     }
+    for (size_t i = 0; i < threads; i++) {
+        abc_typechecker_destroy(&pc.workers[i]);
+    }
+    free(pc.workers);
+
+    if (!abc_typechecker_check_main(program)) {
+        ok = false;
+    }
 
-    // check for valid main
+    abc_pool_destroy(pool);
+    return ok;
+}
+
+bool abc_typechecker_check_main(struct abc_program *program) {
+    bool ok = true;
     bool found = false;
-    for (size_t i = 0; i < program->fun_decls.len; i++) {
+    abc_sym main_sym;
+    bool main_interned = abc_intern_find(program->symbols, "main", sizeof("main") - 1, &main_sym);
+    for (size_t i = 0; main_interned && i < program->fun_decls.len; i++) {
         struct abc_fun_decl fun_decl = ((struct abc_fun_decl *) program->fun_decls.data)[i];
-        if (strcmp(fun_decl.name.lexeme, "main") == 0) {
+        if (fun_decl.name.sym == main_sym) {
             found = true;
             if (fun_decl.type != PARSER_TYPE_VOID) {
                 fprintf(stderr, "main function must be of type void\n");
@@ -169,32 +275,36 @@ bool abc_typechecker_typecheck(struct abc_program *program) {
         fprintf(stderr, "no main function defined\n");
         ok = false;
     }
-
-    abc_typechecker_destroy(&tc);
     return ok;
 }
 
-static struct typecheck_result typecheck_fun(struct abc_typechecker *tc, struct abc_fun_decl *fun) {
-    struct formals formals = {.marker = false, .name = fun->name.lexeme, .ret_type = (enum abc_type) fun->type};
-    abc_arr_init(&formals.types, sizeof(struct type), tc->pool);
+static struct typecheck_result typecheck_fun(struct abc_typechecker *tc, struct abc_fun_decl *fun, size_t index,
+                                             enum signature_status status) {
+    switch (status) {
+        case SIGNATURE_OK:
+            break;
+        case SIGNATURE_VOID_PARAM:
+            fprintf(error_stream(tc), "void cannot be used as a function parameter\n");
+            return (struct typecheck_result) {.err = true};
+        case SIGNATURE_REDEFINED:
+            fprintf(error_stream(tc), "function %s redefined, skipping typecheck\n",
+                    abc_intern_str(tc->symbols, fun->name.sym));
+            return (struct typecheck_result) {.err = true};
+    }
+
+    // parameters get their own scope, outside the one of the body block
+    push_type_scope(tc);
     for (size_t i = 0; i < fun->params.len; i++) {
         struct abc_param param = ((struct abc_param *) fun->params.data)[i];
-        if (param.type == PARSER_TYPE_VOID) {
-            fprintf(stderr, "void cannot be used as a function parameter\n");
-            return (struct typecheck_result) {.err = true};
-        }
-        enum abc_type type = (enum abc_type) param.type;
-        struct type t = {.marker = false, .name = param.token.lexeme, .type = type};
-        abc_arr_push(&formals.types, &t);
+        struct type t = {.name = param.token.sym, .type = (enum abc_type) param.type};
         push_type(tc, &t);
     }
-    if (!push_formals(tc, &formals)) {
-        fprintf(stderr, "function %s redefined, skipping typecheck\n", fun->name.lexeme);
-        return (struct typecheck_result) {.err = true};
-    }
 
+    tc->curr_fun = index;
     tc->curr_fun_type = fun->type;
-    struct typecheck_result result = typecheck_block_stmt(tc, &fun->body);
+    tc->ast = &fun->ast;
+    struct typecheck_result result = typecheck_block_stmt(tc, &abc_ast_stmt(tc->ast, fun->body)->val.block_stmt);
+    pop_type_scope(tc);
     return result;
 }
 
@@ -202,35 +312,36 @@ static struct typecheck_result typecheck_decl(struct abc_typechecker *tc, struct
     struct type type = {0};
     switch (decl->tag) {
         case ABC_DECL_VAR:
-            type.name = decl->val.var.name.lexeme;
-            type.type = (enum abc_type) decl->val.var.type;
+            type.name = decl->val.var.name;
+            type.type = (enum abc_type) decl->type;
             if (type.type == ABC_TYPE_VOID) {
-                fprintf(stderr, "cannot declare variable of type void\n");
+                fprintf(error_stream(tc), "cannot declare variable of type void\n");
                 return (struct typecheck_result) {.err = true};
             }
-            if (decl->val.var.has_init) {
+            if (decl->val.var.init != ABC_NODE_NONE) {
                 struct typecheck_result result = typecheck_expr(tc, decl->val.var.init);
-                if (result.err || result.type != (enum abc_type) decl->val.var.type) {
+                if (result.err || result.type != (enum abc_type) decl->type) {
                     if (!result.err) {
-                        fprintf(stderr, "type mismatch for decl %s\n", decl->val.var.name.lexeme);
+                        fprintf(error_stream(tc), "type mismatch for decl %s\n", abc_intern_str(tc->symbols, decl->val.var.name));
                     }
                     return (struct typecheck_result) {.err = true};
                 }
             }
             if (!push_type(tc, &type)) {
-                fprintf(stderr, "%s defined multiple times\n", decl->val.var.name.lexeme);
+                fprintf(error_stream(tc), "%s defined multiple times\n", abc_intern_str(tc->symbols, decl->val.var.name));
                 return (struct typecheck_result) {.err = true};
             }
             return (struct typecheck_result) {.err = false};
         case ABC_DECL_STMT:
-            return typecheck_stmt(tc, &decl->val.stmt.stmt);
+            return typecheck_stmt(tc, decl->val.stmt.stmt);
     }
     assert(0);
 }
 
-static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, struct abc_stmt *stmt) {
+static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, abc_node node) {
+    struct abc_stmt *stmt = abc_ast_stmt(tc->ast, node);
     struct typecheck_result res;
-    switch (stmt->tag) {
+    switch ((enum abc_stmt_tag) stmt->tag) {
         case ABC_STMT_EXPR:
             return typecheck_expr(tc, stmt->val.expr_stmt.expr);
         case ABC_STMT_IF:
@@ -239,14 +350,14 @@ static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, struct
                 return (struct typecheck_result) {.err = true};
             }
             if (res.type != ABC_TYPE_BOOL) {
-                fprintf(stderr, "expect bool in if condition\n");
+                fprintf(error_stream(tc), "expect bool in if condition\n");
                 return (struct typecheck_result) {.err = true};
             }
             res = typecheck_stmt(tc, stmt->val.if_stmt.then_stmt);
             if (res.err) {
                 return (struct typecheck_result) {.err = true};
             }
-            if (stmt->val.if_stmt.has_else) {
+            if (stmt->val.if_stmt.else_stmt != ABC_NODE_NONE) {
                 res = typecheck_stmt(tc, stmt->val.if_stmt.else_stmt);
                 if (res.err) {
                     return (struct typecheck_result) {.err = true};
@@ -259,7 +370,7 @@ static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, struct
                 return (struct typecheck_result) {.err = true};
             }
             if (res.type != ABC_TYPE_BOOL) {
-                fprintf(stderr, "expect bool in while condition\n");
+                fprintf(error_stream(tc), "expect bool in while condition\n");
                 return (struct typecheck_result) {.err = true};
             }
             return typecheck_stmt(tc, stmt->val.while_stmt.body);
@@ -268,24 +379,24 @@ static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, struct
         case ABC_STMT_PRINT:
             res = typecheck_expr(tc, stmt->val.print_stmt.expr);
             if (res.type == ABC_TYPE_VOID) {
-                fprintf(stderr, "expect non-void expr in print statement\n");
+                fprintf(error_stream(tc), "expect non-void expr in print statement\n");
                 return (struct typecheck_result) {.err = true};
             }
             return (struct typecheck_result) {.err = false};
         case ABC_STMT_RETURN:
-            if (stmt->val.return_stmt.has_expr) {
+            if (stmt->val.return_stmt.expr != ABC_NODE_NONE) {
                 res = typecheck_expr(tc, stmt->val.return_stmt.expr);
                 if (res.err) {
                     return (struct typecheck_result) {.err = true};
                 }
                 if (res.type != (enum abc_type) tc->curr_fun_type) {
-                    fprintf(stderr, "type mismatch for return statement\n");
+                    fprintf(error_stream(tc), "type mismatch for return statement\n");
                     return (struct typecheck_result) {.err = true};
                 }
                 return (struct typecheck_result) {.err = false, .type = res.type};
             } else {
                 if (tc->curr_fun_type != PARSER_TYPE_VOID) {
-                    fprintf(stderr, "type mismatch for return statement\n");
+                    fprintf(error_stream(tc), "type mismatch for return statement\n");
                     return (struct typecheck_result) {.err = true};
                 }
                 return (struct typecheck_result) {.err = false};
@@ -297,9 +408,9 @@ static struct typecheck_result typecheck_stmt(struct abc_typechecker *tc, struct
 static struct typecheck_result typecheck_block_stmt(struct abc_typechecker *tc, struct abc_block_stmt *block) {
     push_type_scope(tc);
     bool ok = true;
+    struct abc_decl *decls = abc_ast_decls(tc->ast, block->decls);
     for (size_t i = 0; i < block->decls.len; i++) {
-        struct abc_decl decl = ((struct abc_decl *) block->decls.data)[i];
-        struct typecheck_result result = typecheck_decl(tc, &decl);
+        struct typecheck_result result = typecheck_decl(tc, &decls[i]);
         if (result.err) {
             ok = false;
         }
@@ -308,138 +419,201 @@ static struct typecheck_result typecheck_block_stmt(struct abc_typechecker *tc,
     return (struct typecheck_result) {.err = !ok};
 }
 
-static struct typecheck_result typecheck_bin_expr(struct abc_typechecker *tc, struct abc_bin_expr *expr);
-static struct typecheck_result typecheck_unary_expr(struct abc_typechecker *tc, struct abc_unary_expr *expr);
-static struct typecheck_result typecheck_call_expr(struct abc_typechecker *tc, struct abc_call_expr *expr);
-static struct typecheck_result typecheck_lit_expr(struct abc_typechecker *tc, struct abc_lit_expr *expr);
-static struct typecheck_result typecheck_assign_expr(struct abc_typechecker *tc, struct abc_assign_expr *expr);
-static struct typecheck_result typecheck_expr(struct abc_typechecker *tc, struct abc_expr *expr) {
-    struct typecheck_result result;
-    switch (expr->tag) {
+static struct typecheck_result pop_result(struct abc_typechecker *tc) {
+    return ((struct typecheck_result *) tc->expr_results.data)[--tc->expr_results.len];
+}
+
+static struct typecheck_result typecheck_bin_expr(struct abc_typechecker *tc, struct abc_expr *expr);
+static struct typecheck_result typecheck_unary_expr(struct abc_typechecker *tc, struct abc_expr *expr);
+static bool typecheck_call_expr(struct abc_typechecker *tc, struct expr_frame *frame, struct abc_call_expr *expr,
+                                abc_node *child, struct typecheck_result *result);
+static struct typecheck_result typecheck_lit_expr(struct abc_typechecker *tc, struct abc_expr *expr);
+static bool typecheck_assign_expr(struct abc_typechecker *tc, struct expr_frame *frame, struct abc_assign_expr *expr,
+                                  abc_node *child, struct typecheck_result *result);
+
+/*
+ * Advance frame, returns true with child set when a child must be checked next, false with result set when the
+ * expression is done.
+ */
+static bool typecheck_expr_step(struct abc_typechecker *tc, struct expr_frame *frame, abc_node *child,
+                                struct typecheck_result *result) {
+    struct abc_expr *expr = abc_ast_expr(tc->ast, frame->node);
+    switch ((enum abc_expr_tag) expr->tag) {
         case ABC_EXPR_BINARY:
-            result = typecheck_bin_expr(tc, &expr->val.bin_expr);
-            break;
+            if (frame->next < 2) {
+                *child = frame->next++ == 0 ? expr->val.bin_expr.left : expr->val.bin_expr.right;
+                return true;
+            }
+            *result = typecheck_bin_expr(tc, expr);
+            return false;
         case ABC_EXPR_UNARY:
-            result = typecheck_unary_expr(tc, &expr->val.unary_expr);
-            break;
+            if (frame->next++ == 0) {
+                *child = expr->val.unary_expr.expr;
+                return true;
+            }
+            *result = typecheck_unary_expr(tc, expr);
+            return false;
         case ABC_EXPR_CALL:
-            result = typecheck_call_expr(tc, &expr->val.call_expr);
-            break;
+            return typecheck_call_expr(tc, frame, &expr->val.call_expr, child, result);
         case ABC_EXPR_LITERAL:
-            result = typecheck_lit_expr(tc, &expr->val.lit_expr);
-            break;
+            *result = typecheck_lit_expr(tc, expr);
+            return false;
         case ABC_EXPR_ASSIGN:
-            result = typecheck_assign_expr(tc, &expr->val.assign_expr);
-            break;
+            return typecheck_assign_expr(tc, frame, &expr->val.assign_expr, child, result);
         case ABC_EXPR_GROUPING:
-            result = typecheck_expr(tc, expr->val.grouping_expr.expr);
-            break;
-        default:
-            assert(0);
+            if (frame->next++ == 0) {
+                *child = expr->val.grouping_expr.expr;
+                return true;
+            }
+            *result = pop_result(tc);
+            return false;
     }
-    if (!result.err) {
-        expr->type = result.type;
+    assert(0);
+    abort();
+}
+
+static struct typecheck_result typecheck_expr(struct abc_typechecker *tc, abc_node node) {
+    size_t base = tc->expr_frames.len;
+    struct expr_frame root = {.node = node};
+    abc_arr_push(&tc->expr_frames, &root);
+    while (tc->expr_frames.len > base) {
+        struct expr_frame *frame = (struct expr_frame *) tc->expr_frames.data + tc->expr_frames.len - 1;
+        abc_node child;
+        struct typecheck_result result;
+        if (typecheck_expr_step(tc, frame, &child, &result)) {
+            struct expr_frame child_frame = {.node = child};
+            abc_arr_push(&tc->expr_frames, &child_frame);
+            continue;
+        }
+        if (!result.err) {
+            abc_ast_expr(tc->ast, frame->node)->type = (uint8_t) result.type;
+        }
+        tc->expr_frames.len--;
+        abc_arr_push(&tc->expr_results, &result);
     }
-    return result;
+    return pop_result(tc);
 }
 
-static struct typecheck_result typecheck_bin_expr(struct abc_typechecker *tc, struct abc_bin_expr *expr) {
-    struct typecheck_result left = typecheck_expr(tc, expr->left);
-    struct typecheck_result right = typecheck_expr(tc, expr->right);
+static struct typecheck_result typecheck_bin_expr(struct abc_typechecker *tc, struct abc_expr *expr) {
+    struct typecheck_result right = pop_result(tc);
+    struct typecheck_result left = pop_result(tc);
 
     if (left.err || right.err) {
         return (struct typecheck_result) {.err = true};
     }
 
-    if (expr->op.type == TOKEN_OR || expr->op.type == TOKEN_AND) {
+    if (expr->op == TOKEN_OR || expr->op == TOKEN_AND) {
         if (left.type != ABC_TYPE_BOOL || right.type != ABC_TYPE_BOOL) {
-            fprintf(stderr, "expect bool as lhs and rhs in logical expression\n");
+            fprintf(error_stream(tc), "expect bool as lhs and rhs in logical expression\n");
             return (struct typecheck_result) {.err = true};
         }
         return (struct typecheck_result) {.err = false, .type = ABC_TYPE_BOOL};
     }
     if (left.type != ABC_TYPE_INT || right.type != ABC_TYPE_INT) {
-        fprintf(stderr, "expect int as lhs and rhs in numerical/relational expression\n");
+        fprintf(error_stream(tc), "expect int as lhs and rhs in numerical/relational expression\n");
         return (struct typecheck_result) {.err = true};
     }
     enum abc_type type = ABC_TYPE_BOOL;
-    if (expr->op.type == TOKEN_PLUS || expr->op.type == TOKEN_MINUS || expr->op.type == TOKEN_STAR ||
-        expr->op.type == TOKEN_SLASH) {
+    if (expr->op == TOKEN_PLUS || expr->op == TOKEN_MINUS || expr->op == TOKEN_STAR ||
+        expr->op == TOKEN_SLASH) {
         type = ABC_TYPE_INT;
     }
     return (struct typecheck_result) {.err = false, .type = type};
 }
 
-static struct typecheck_result typecheck_unary_expr(struct abc_typechecker *tc, struct abc_unary_expr *expr) {
-    struct typecheck_result rhs = typecheck_expr(tc, expr->expr);
+static struct typecheck_result typecheck_unary_expr(struct abc_typechecker *tc, struct abc_expr *expr) {
+    struct typecheck_result rhs = pop_result(tc);
     if (rhs.err) {
         return (struct typecheck_result) {.err = true};
     }
-    if (expr->op.type == TOKEN_BANG) {
+    if (expr->op == TOKEN_BANG) {
         if (rhs.type != ABC_TYPE_BOOL) {
-            fprintf(stderr, "expect bool as rhs of negation\n");
+            fprintf(error_stream(tc), "expect bool as rhs of negation\n");
             return (struct typecheck_result) {.err = true};
         }
         return (struct typecheck_result) {.err = false, .type = ABC_TYPE_BOOL};
     }
     if (rhs.type != ABC_TYPE_INT) {
-        fprintf(stderr, "expect int as rhs of unary '-'\n");
+        fprintf(error_stream(tc), "expect int as rhs of unary '-'\n");
         return (struct typecheck_result) {.err = true};
     }
     return (struct typecheck_result) {.err = false, .type = ABC_TYPE_INT};
 }
 
-static struct typecheck_result typecheck_call_expr(struct abc_typechecker *tc, struct abc_call_expr *expr) {
-    struct formals formals;
-    if (!lookup_formals(tc, expr->callee.val.identifier.lexeme, &formals)) {
-        fprintf(stderr, "unknown function %s\n", expr->callee.val.identifier.lexeme);
-        return (struct typecheck_result) {.err = true};
-    }
-    if (formals.types.len != expr->args.len) {
-        fprintf(stderr, "incorrect parameter count for %s\n", expr->callee.val.identifier.lexeme);
-        return (struct typecheck_result) {.err = true};
-    }
-    for (size_t i = 0; i < formals.types.len; i++) {
-        struct type type = ((struct type *) formals.types.data)[i];
-        struct abc_expr *arg = ((struct abc_expr **) expr->args.data)[i];
-        struct typecheck_result result = typecheck_expr(tc, arg);
-        if (result.err) {
-            return (struct typecheck_result) {.err = true};
+// Arguments are checked one at a time, the first bad argument ends the check.
+static bool typecheck_call_expr(struct abc_typechecker *tc, struct expr_frame *frame, struct abc_call_expr *expr,
+                                abc_node *child, struct typecheck_result *result) {
+    if (frame->next == 0) {
+        struct formals formals;
+        if (!lookup_formals(tc, expr->callee, &formals)) {
+            fprintf(error_stream(tc), "unknown function %s\n", abc_intern_str(tc->symbols, expr->callee));
+            *result = (struct typecheck_result) {.err = true};
+            return false;
         }
-        if (type.type != result.type) {
-            fprintf(stderr, "type mismatch for parameter %lu in call to %s\n", i + 1,
-                    expr->callee.val.identifier.lexeme);
-            return (struct typecheck_result) {.err = true};
+        if (formals.types.len != expr->args.len) {
+            fprintf(error_stream(tc), "incorrect parameter count for %s\n", abc_intern_str(tc->symbols, expr->callee));
+            *result = (struct typecheck_result) {.err = true};
+            return false;
+        }
+        frame->params = formals.types.data;
+        frame->ret_type = formals.ret_type;
+    } else {
+        size_t i = frame->next - 1;
+        struct typecheck_result arg = pop_result(tc);
+        if (arg.err) {
+            *result = (struct typecheck_result) {.err = true};
+            return false;
         }
+        if (frame->params[i].type != arg.type) {
+            fprintf(error_stream(tc), "type mismatch for parameter %lu in call to %s\n", i + 1,
+                    abc_intern_str(tc->symbols, expr->callee));
+            *result = (struct typecheck_result) {.err = true};
+            return false;
+        }
+    }
+    if (frame->next < expr->args.len) {
+        *child = abc_ast_args(tc->ast, expr->args)[frame->next++];
+        return true;
     }
-    return (struct typecheck_result) {.err = false, .type = formals.ret_type};
+    *result = (struct typecheck_result) {.err = false, .type = frame->ret_type};
+    return false;
 }
 
-static struct typecheck_result typecheck_lit_expr(struct abc_typechecker *tc, struct abc_lit_expr *expr) {
-    if (expr->lit.tag == ABC_LITERAL_INT) {
+static struct typecheck_result typecheck_lit_expr(struct abc_typechecker *tc, struct abc_expr *expr) {
+    if (expr->lit_tag == ABC_LITERAL_INT) {
         return (struct typecheck_result) {.err = false, .type = ABC_TYPE_INT};
     }
     struct type t;
-    if (!lookup_type(tc, expr->lit.val.identifier.lexeme, &t)) {
-        fprintf(stderr, "reference to unknown identifier %s\n", expr->lit.val.identifier.lexeme);
+    if (!lookup_type(tc, expr->val.lit_expr.val.identifier, &t)) {
+        fprintf(error_stream(tc), "reference to unknown identifier %s\n", abc_intern_str(tc->symbols, expr->val.lit_expr.val.identifier));
         return (struct typecheck_result) {.err = true};
     }
     return (struct typecheck_result) {.err = false, .type = t.type};
 }
 
-static struct typecheck_result typecheck_assign_expr(struct abc_typechecker *tc, struct abc_assign_expr *expr) {
-    struct type t;
-    if (!lookup_type(tc, expr->lit.val.identifier.lexeme, &t)) {
-        fprintf(stderr, "trying to assign to unknown identifier %s\n", expr->lit.val.identifier.lexeme);
-        return (struct typecheck_result) {.err = true};
+static bool typecheck_assign_expr(struct abc_typechecker *tc, struct expr_frame *frame, struct abc_assign_expr *expr,
+                                  abc_node *child, struct typecheck_result *result) {
+    if (frame->next++ == 0) {
+        struct type t;
+        if (!lookup_type(tc, expr->identifier, &t)) {
+            fprintf(error_stream(tc), "trying to assign to unknown identifier %s\n", abc_intern_str(tc->symbols, expr->identifier));
+            *result = (struct typecheck_result) {.err = true};
+            return false;
+        }
+        frame->type = t.type;
+        *child = expr->expr;
+        return true;
     }
-    struct typecheck_result result = typecheck_expr(tc, expr->expr);
-    if (result.err) {
-        return (struct typecheck_result) {.err = true};
+    struct typecheck_result value = pop_result(tc);
+    if (value.err) {
+        *result = (struct typecheck_result) {.err = true};
+        return false;
     }
-    if (result.type != t.type) {
-        fprintf(stderr, "attempt to assign value to %s of different type\n", expr->lit.val.identifier.lexeme);
-        return (struct typecheck_result) {.err = true};
+    if (value.type != frame->type) {
+        fprintf(error_stream(tc), "attempt to assign value to %s of different type\n", abc_intern_str(tc->symbols, expr->identifier));
+        *result = (struct typecheck_result) {.err = true};
+        return false;
     }
-    return (struct typecheck_result) {.err = false, .type = t.type};
+    *result = (struct typecheck_result) {.err = false, .type = frame->type};
+    return false;
 }
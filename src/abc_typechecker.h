@@ -15,4 +15,12 @@
 // Typecheck the parse tree, returning true on success.
 bool abc_typechecker_typecheck(struct abc_program *program);
 
+// Like abc_typechecker_typecheck, but after a serial pass collecting the signatures the function bodies are checked
+// concurrently on up to threads threads. Errors are reported in the same order as abc_typechecker_typecheck.
+bool abc_typechecker_typecheck_parallel(struct abc_program *program, size_t threads);
+
+// Check that the program has a main function of the right signature, reporting any problem on stderr. Part of
+// abc_typechecker_typecheck, exposed for the fused front end in ir_translate.
+bool abc_typechecker_check_main(struct abc_program *program);
+
 #endif // ABC_TYPECHECKER_H
@@ -5,347 +5,516 @@
 #include "ir.h"
 
 #include <assert.h>
-#include <string.h>
+#include <stdlib.h>
 
-static char *fun_label(struct ir_translator *tr, char *fun_name) {
-    (void) tr;
-    return fun_name;
-}
+#include "../abc_typechecker.h"
+#include "ir_cfg.h"
 
-static char *fun_inner_label(struct ir_translator *tr) {
-    static char *curr_fun = NULL;
-    static int counter = 0;
+// pending node of ir_translate_expr
+struct expr_frame {
+    abc_node node;
+    uint32_t next; // number of children translated
+    bool atomize; // atomize the result for the parent
+    enum abc_type type; // type of the assignment target, when checking
+    const struct abc_fun_decl *callee; // when checking
+};
 
-    if (curr_fun == NULL) {
-        curr_fun = tr->curr_fun->label;
-        counter = 0;
-    } else if (strcmp(curr_fun, tr->curr_fun->label) != 0) {
-        counter = 0;
-        curr_fun = tr->curr_fun->label;
-    }
-    counter++;
-    int len = snprintf(NULL, 0, "%s_lab_%d", curr_fun, counter);
-    char *res = abc_pool_alloc(tr->pool, len + 1, 1);
-    snprintf(res, len + 1, "%s_lab_%d", curr_fun, counter);
-    return res;
+// translated expression, err is only set when checking
+struct expr_result {
+    bool err;
+    struct ir_expr expr;
+};
+
+enum pred_task_tag {
+    PRED_TASK_COND,
+    PRED_TASK_LOGICAL, // check the results of both sides of an and/or, only used when checking
+};
+
+// pending predicate of ir_translate_pred
+struct pred_task {
+    enum pred_task_tag tag;
+    abc_node node;
+    ir_label success;
+    ir_label fail;
+    bool has_start;
+    ir_label start; // block to start before translating
+};
+
+// type of a checked predicate
+struct pred_result {
+    bool err;
+    enum abc_type type;
+};
+
+static char *fun_label(struct ir_translator *tr, abc_sym fun_name) {
+    return (char *) abc_intern_str(tr->symbols, fun_name);
 }
 
-static char *fun_var_label(struct ir_translator *tr) {
-    static char *curr_fun = NULL;
-    static int counter = 0;
+static ir_label new_label(struct ir_translator *tr) { return ir_cfg_new_block(tr->curr_fun, tr->pool); }
 
-    if (curr_fun == NULL) {
-        curr_fun = tr->curr_fun->label;
-        counter = 0;
-    } else if (strcmp(curr_fun, tr->curr_fun->label) != 0) {
-        counter = 0;
-        curr_fun = tr->curr_fun->label;
-    }
-    int len = snprintf(NULL, 0, "%s_var_%d", curr_fun, counter);
-    char *res = abc_pool_alloc(tr->pool, len + 1, 1);
-    snprintf(res, len + 1, "%s_var_%d", curr_fun, counter++);
-    return res;
+static struct ir_block *curr_block(struct ir_translator *tr) { return ir_fun_block(tr->curr_fun, tr->curr_block); }
+
+static void set_tail(struct ir_translator *tr, struct ir_tail tail) {
+    ir_cfg_set_tail(tr->curr_fun, tr->curr_block, tail);
 }
 
-static void insert_ir_var_data(struct ir_translator *tr, struct ir_var_data *data) {
-    abc_arr_push(&tr->ir_vars, data);
+static void set_goto(struct ir_translator *tr, ir_label label) {
+    set_tail(tr, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = label});
 }
 
-static char *lookup_ir_var(struct ir_translator *tr, char *og_name) {
-    for (size_t i = 0; i < tr->ir_vars.len; i++) {
-        struct ir_var_data var_data = ((struct ir_var_data *) tr->ir_vars.data)[tr->ir_vars.len - (i + 1)];
-        if (var_data.marker) {
-            continue;
-        }
-        if (strcmp(og_name, var_data.original_name) == 0) {
-            return var_data.label;
-        }
-    }
-    assert(0);
+static ir_var new_var(struct ir_translator *tr) { return tr->curr_fun->num_vars++; }
+
+static void insert_ir_var(struct ir_translator *tr, abc_sym og_name, ir_var var, enum abc_type type) {
+    struct ir_var_data data = {.var = var, .type = type};
+    abc_map_put(&tr->ir_vars, og_name, &data);
 }
 
-static void push_ir_var_scope(struct ir_translator *tr) {
-    struct ir_var_data data = {.marker = true};
-    abc_arr_push(&tr->ir_vars, &data);
+static struct ir_var_data *find_ir_var(struct ir_translator *tr, abc_sym og_name) {
+    return abc_map_get(&tr->ir_vars, og_name);
 }
 
-static void pop_ir_var_scope(struct ir_translator *tr) {
-    for (size_t i = 0; i < tr->ir_vars.len; i++) {
-        struct ir_var_data data = ((struct ir_var_data *) tr->ir_vars.data)[tr->ir_vars.len - (i + 1)];
-        if (data.marker) {
-            tr->ir_vars.len = tr->ir_vars.len - (i + 1);
-            return;
-        }
-    }
-    assert(0);
+static ir_var lookup_ir_var(struct ir_translator *tr, abc_sym og_name) {
+    struct ir_var_data *data = find_ir_var(tr, og_name);
+    assert(data != NULL);
+    return data->var;
 }
 
-static char *lookup_ir_fun(struct ir_translator *tr, char *og_name) {
-    for (size_t i = 0; i < tr->ir_funs.len; i++) {
-        struct ir_fun_data ir_fun_data = ((struct ir_fun_data *) tr->ir_funs.data)[i];
-        if (strcmp(og_name, ir_fun_data.original_name) == 0) {
-            return ir_fun_data.label;
-        }
+static void push_ir_var_scope(struct ir_translator *tr) { abc_map_push_scope(&tr->ir_vars); }
+
+static void pop_ir_var_scope(struct ir_translator *tr) { abc_map_pop_scope(&tr->ir_vars); }
+
+// NULL if the function is unknown or, when checking, defined after the current one.
+static struct ir_fun_data *find_ir_fun(struct ir_translator *tr, abc_sym og_name) {
+    struct ir_fun_data *data = abc_map_get(&tr->ir_funs, og_name);
+    if (data == NULL || (tr->check && data->index > tr->curr_fun_index)) {
+        return NULL;
     }
-    assert(0);
+    return data;
+}
+
+static char *lookup_ir_fun(struct ir_translator *tr, abc_sym og_name) {
+    struct ir_fun_data *data = find_ir_fun(tr, og_name);
+    assert(data != NULL);
+    return data->label;
 }
 
 void ir_translator_init(struct ir_translator *translator) {
     translator->pool = abc_pool_create();
+    translator->check = false;
     translator->curr_fun = NULL;
-    translator->curr_block = NULL;
+    translator->curr_fun_index = 0;
+    translator->logical_in_expr = false;
+    translator->curr_block = 0;
     translator->has_error = false;
-    abc_arr_init(&translator->ir_funs, sizeof(struct ir_fun_data), translator->pool);
-    abc_arr_init(&translator->ir_vars, sizeof(struct ir_var_data), translator->pool);
+    translator->symbols = NULL;
+    translator->ast = NULL;
+    abc_map_init(&translator->ir_funs, sizeof(struct ir_fun_data), translator->pool);
+    abc_map_init(&translator->ir_vars, sizeof(struct ir_var_data), translator->pool);
+    abc_arr_init(&translator->expr_frames, sizeof(struct expr_frame), translator->pool);
+    abc_arr_init(&translator->expr_results, sizeof(struct expr_result), translator->pool);
+    abc_arr_init(&translator->pred_tasks, sizeof(struct pred_task), translator->pool);
+    abc_arr_init(&translator->pred_results, sizeof(struct pred_result), translator->pool);
 }
 
 void ir_translator_destroy(struct ir_translator *translator) { abc_pool_destroy(translator->pool); }
 
-static struct ir_fun init_ir_fun(struct ir_translator *tr, struct abc_fun_decl *fun_decl) {
-    char *label = fun_label(tr, fun_decl->name.lexeme);
-    struct ir_fun fun = {.label = label, .num_var_labels = 0, .type = (enum abc_type) fun_decl->type};
+static struct ir_fun init_ir_fun(struct ir_translator *tr, const struct abc_fun_decl *fun_decl, size_t index) {
+    char *label = fun_label(tr, fun_decl->name.sym);
+    struct ir_fun fun = {.label = label, .num_vars = 0, .type = (enum abc_type) fun_decl->type};
     abc_arr_init(&fun.args, sizeof(struct ir_param), tr->pool);
     abc_arr_init(&fun.blocks, sizeof(struct ir_block), tr->pool);
-    struct ir_fun_data ir_fun_data = {.label = label, .original_name = fun_decl->name.lexeme};
-    abc_arr_push(&tr->ir_funs, &ir_fun_data);
+    abc_arr_init(&fun.rpo, sizeof(ir_label), tr->pool);
+    if (!tr->check) {
+        // when checking all signatures are registered up front
+        struct ir_fun_data data = {.label = label, .decl = fun_decl, .index = index};
+        abc_map_put(&tr->ir_funs, fun_decl->name.sym, &data);
+    }
 
-    tr->curr_fun = &fun; // hack for fun_var_label to work
+    tr->curr_fun = &fun; // hack for new_var to work
     for (size_t i = 0; i < fun_decl->params.len; i++) {
         struct abc_param param = ((struct abc_param *) fun_decl->params.data)[i];
         struct ir_param ir_param = {.type = (enum abc_type) param.type};
-        char *param_label = fun_var_label(tr);
-        ir_param.label = param_label;
+        ir_param.var = new_var(tr);
         abc_arr_push(&fun.args, &ir_param);
 
-        struct ir_var_data ir_param_data = {.original_name = param.token.lexeme, .label = param_label, .marker = false};
-        insert_ir_var_data(tr, &ir_param_data);
+        // like the typechecker, the first of two parameters with the same name is the one in scope
+        if (!tr->check || abc_map_get_local(&tr->ir_vars, param.token.sym) == NULL) {
+            insert_ir_var(tr, param.token.sym, ir_param.var, ir_param.type);
+        }
     }
 
-    struct ir_block start_block = {.label = fun_inner_label(tr), .has_tail = false};
+    fun.entry = new_label(tr);
+    fun.exit = new_label(tr);
     tr->curr_fun = NULL;
-    abc_arr_init(&start_block.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&fun.blocks, &start_block);
+    tr->curr_block = fun.entry;
 
     return fun;
 }
 
-static void ir_translate_fun(struct ir_translator *tr, struct abc_fun_decl *fun_decl, struct ir_fun *fun);
-static void ir_translate_decl(struct ir_translator *tr, struct abc_decl *decl);
-static void ir_translate_stmt(struct ir_translator *tr, struct abc_stmt *stmt);
-static void ir_translate_block_stmt(struct ir_translator *tr, struct abc_block_stmt *block);
-static void ir_translate_expr_stmt(struct ir_translator *tr, struct abc_expr_stmt *stmt);
-static void ir_translate_if_stmt(struct ir_translator *tr, struct abc_if_stmt *stmt);
-static void ir_translate_while_stmt(struct ir_translator *tr, struct abc_while_stmt *stmt);
-static void ir_translate_print_stmt(struct ir_translator *tr, struct abc_print_stmt *stmt);
-static void ir_translate_return_stmt(struct ir_translator *tr, struct abc_return_stmt *stmt);
-struct ir_expr ir_translate_expr(struct ir_translator *translator, struct abc_expr *expr);
+/*
+ * Blocks still without a tail, like the last one of a function without a final return, return nothing. Every block
+ * then ends in an explicit jump, so the CFG is complete and the blocks can be laid out in any order.
+ */
+static void finish_ir_fun(struct ir_translator *tr, struct ir_fun *fun) {
+    struct ir_tail ret = {.tag = IR_TAIL_RET, .val.ret.has_atom = false};
+    for (ir_label label = 0; label < fun->blocks.len; label++) {
+        if (label != fun->exit && !ir_fun_block(fun, label)->has_tail) {
+            ir_cfg_set_tail(fun, label, ret);
+        }
+    }
+    ir_cfg_simplify(fun, tr->pool);
+}
+
+static bool ir_translate_fun(struct ir_translator *tr, struct abc_fun_decl *fun_decl, struct ir_fun *fun);
+static bool ir_translate_decl(struct ir_translator *tr, struct abc_decl *decl);
+static bool ir_translate_stmt(struct ir_translator *tr, abc_node node);
+static bool ir_translate_block_stmt(struct ir_translator *tr, struct abc_block_stmt *block);
+static bool ir_translate_expr_stmt(struct ir_translator *tr, struct abc_expr_stmt *stmt);
+static bool ir_translate_if_stmt(struct ir_translator *tr, struct abc_if_stmt *stmt);
+static bool ir_translate_while_stmt(struct ir_translator *tr, struct abc_while_stmt *stmt);
+static bool ir_translate_print_stmt(struct ir_translator *tr, struct abc_print_stmt *stmt);
+static bool ir_translate_return_stmt(struct ir_translator *tr, struct abc_return_stmt *stmt);
+static struct expr_result ir_translate_expr(struct ir_translator *translator, abc_node node);
 struct ir_atom ir_atomize_expr(struct ir_translator *translator, struct ir_expr *expr);
 
+/*
+ * Signature pass of the fused front end, mirrors the one of the typechecker. Functions with a void parameter and
+ * redefinitions are not registered, their status decides the error reported in their place.
+ */
+static void register_signatures(struct ir_translator *tr, struct abc_program *program, bool *valid) {
+    for (size_t i = 0; i < program->fun_decls.len; i++) {
+        struct abc_fun_decl *fun_decl = (struct abc_fun_decl *) program->fun_decls.data + i;
+        valid[i] = true;
+        for (size_t j = 0; j < fun_decl->params.len; j++) {
+            if (((struct abc_param *) fun_decl->params.data)[j].type == PARSER_TYPE_VOID) {
+                valid[i] = false;
+            }
+        }
+        if (valid[i] && abc_map_get(&tr->ir_funs, fun_decl->name.sym) == NULL) {
+            struct ir_fun_data data = {.label = fun_label(tr, fun_decl->name.sym), .decl = fun_decl, .index = i};
+            abc_map_put(&tr->ir_funs, fun_decl->name.sym, &data);
+        }
+    }
+}
+
+// Report the error of a function register_signatures rejected, returns false if there is none.
+static bool check_signature(struct ir_translator *tr, struct abc_fun_decl *fun_decl, size_t index, bool valid) {
+    if (!valid) {
+        fprintf(stderr, "void cannot be used as a function parameter\n");
+        return true;
+    }
+    struct ir_fun_data *data = abc_map_get(&tr->ir_funs, fun_decl->name.sym);
+    if (data->index != index) {
+        fprintf(stderr, "function %s redefined, skipping typecheck\n", abc_intern_str(tr->symbols, fun_decl->name.sym));
+        return true;
+    }
+    return false;
+}
+
 struct ir_program ir_translate(struct ir_translator *translator, struct abc_program *program) {
     struct ir_program ir_prog;
     abc_arr_init(&ir_prog.ir_funs, sizeof(struct ir_fun), translator->pool);
+    translator->symbols = program->symbols;
+    bool *valid = NULL;
+    if (translator->check) {
+        valid = abc_pool_alloc(translator->pool, sizeof(bool), program->fun_decls.len + 1);
+        register_signatures(translator, program, valid);
+    }
     for (size_t i = 0; i < program->fun_decls.len; i++) {
-        translator->ir_vars.len = 0; // reset var list
-        struct abc_fun_decl fun_decl = ((struct abc_fun_decl *) program->fun_decls.data)[i];
-        struct ir_fun fun = init_ir_fun(translator, &fun_decl);
+        struct abc_fun_decl *fun_decl = (struct abc_fun_decl *) program->fun_decls.data + i;
+        if (translator->check && check_signature(translator, fun_decl, i, valid[i])) {
+            translator->has_error = true;
+            continue;
+        }
+        abc_map_clear(&translator->ir_vars); // reset var list
+        struct ir_fun fun = init_ir_fun(translator, fun_decl, i);
         translator->curr_fun = &fun;
-        ir_translate_fun(translator, &fun_decl, &fun);
+        translator->curr_fun_index = i;
+        translator->ast = &fun_decl->ast;
+        if (!ir_translate_fun(translator, fun_decl, &fun)) {
+            translator->has_error = true;
+        }
+        finish_ir_fun(translator, &fun);
         abc_arr_push(&ir_prog.ir_funs, &fun);
         translator->curr_fun = NULL;
     }
+    if (translator->check && !abc_typechecker_check_main(program)) {
+        translator->has_error = true;
+    }
+    if (translator->check && translator->logical_in_expr && !translator->has_error) {
+        // only reported for otherwise well typed programs, so the errors stay the same as the typechecker's
+        fprintf(stderr, "and/or can only be used in if and while conditions\n");
+        translator->has_error = true;
+    }
     return ir_prog;
 }
 
-static void ir_translate_fun(struct ir_translator *tr, struct abc_fun_decl *fun_decl, struct ir_fun *fun) {
+/*
+ * The statement functions return false if checking found an error in the statement. They mirror the typechecker,
+ * including which parts of a statement are still checked after an error, so both report the same errors.
+ */
+
+static bool ir_translate_fun(struct ir_translator *tr, struct abc_fun_decl *fun_decl, struct ir_fun *fun) {
     // parameters and return type is handled in init_ir_fun
     (void) fun;
-    ir_translate_block_stmt(tr, &fun_decl->body);
+    return ir_translate_block_stmt(tr, &abc_ast_stmt(tr->ast, fun_decl->body)->val.block_stmt);
 }
 
-static void ir_translate_decl(struct ir_translator *tr, struct abc_decl *decl) {
+static bool ir_translate_decl(struct ir_translator *tr, struct abc_decl *decl) {
     if (decl->tag != ABC_DECL_VAR) {
-        ir_translate_stmt(tr, &decl->val.stmt.stmt);
-        return;
+        return ir_translate_stmt(tr, decl->val.stmt.stmt);
+    }
+    if (tr->check && (enum abc_type) decl->type == ABC_TYPE_VOID) {
+        fprintf(stderr, "cannot declare variable of type void\n");
+        return false;
     }
-    char *label = fun_var_label(tr);
+    ir_var var = new_var(tr);
     struct ir_stmt_decl ir_decl = {
-            .label = label, .type = (enum abc_type) decl->val.var.type, .has_init = decl->val.var.has_init};
+            .var = var, .type = (enum abc_type) decl->type, .has_init = decl->val.var.init != ABC_NODE_NONE};
     if (ir_decl.has_init) {
-        struct ir_expr init = ir_translate_expr(tr, decl->val.var.init);
-        ir_decl.init = init;
+        struct expr_result init = ir_translate_expr(tr, decl->val.var.init);
+        if (init.err || (tr->check && init.expr.type != ir_decl.type)) {
+            if (!init.err) {
+                fprintf(stderr, "type mismatch for decl %s\n", abc_intern_str(tr->symbols, decl->val.var.name));
+            }
+            return false;
+        }
+        ir_decl.init = init.expr;
     }
     struct ir_stmt stmt = {.tag = IR_STMT_DECL, .val = {ir_decl}};
-    abc_arr_push(&tr->curr_block->stmts, &stmt);
-    // TODO: Update num vars for ir_fun
+    abc_arr_push(&curr_block(tr)->stmts, &stmt);
 
     // Update environment
-    struct ir_var_data ir_var_data = {.label = label, .original_name = decl->val.var.name.lexeme, .marker = false};
-    insert_ir_var_data(tr, &ir_var_data);
+    if (tr->check && abc_map_get_local(&tr->ir_vars, decl->val.var.name) != NULL) {
+        fprintf(stderr, "%s defined multiple times\n", abc_intern_str(tr->symbols, decl->val.var.name));
+        return false;
+    }
+    insert_ir_var(tr, decl->val.var.name, var, ir_decl.type);
+    return true;
 }
 
-static void ir_translate_stmt(struct ir_translator *tr, struct abc_stmt *stmt) {
-    switch (stmt->tag) {
+static bool ir_translate_stmt(struct ir_translator *tr, abc_node node) {
+    struct abc_stmt *stmt = abc_ast_stmt(tr->ast, node);
+    switch ((enum abc_stmt_tag) stmt->tag) {
         case ABC_STMT_EXPR:
-            ir_translate_expr_stmt(tr, &stmt->val.expr_stmt);
-            break;
+            return ir_translate_expr_stmt(tr, &stmt->val.expr_stmt);
         case ABC_STMT_IF:
-            ir_translate_if_stmt(tr, &stmt->val.if_stmt);
-            break;
+            return ir_translate_if_stmt(tr, &stmt->val.if_stmt);
         case ABC_STMT_WHILE:
-            ir_translate_while_stmt(tr, &stmt->val.while_stmt);
-            break;
+            return ir_translate_while_stmt(tr, &stmt->val.while_stmt);
         case ABC_STMT_BLOCK:
-            ir_translate_block_stmt(tr, &stmt->val.block_stmt);
-            break;
+            return ir_translate_block_stmt(tr, &stmt->val.block_stmt);
         case ABC_STMT_PRINT:
-            ir_translate_print_stmt(tr, &stmt->val.print_stmt);
-            break;
+            return ir_translate_print_stmt(tr, &stmt->val.print_stmt);
         case ABC_STMT_RETURN:
-            ir_translate_return_stmt(tr, &stmt->val.return_stmt);
-            break;
+            return ir_translate_return_stmt(tr, &stmt->val.return_stmt);
+    }
+    assert(0);
+    abort();
+}
+
+// Continue in the block of label, which new_label already made.
+static void enter_block(struct ir_translator *tr, ir_label label) { tr->curr_block = label; }
+
+static bool check_bin_expr(enum abc_token_type op, enum abc_type left, enum abc_type right, enum abc_type *type);
+
+static struct pred_result pop_pred_result(struct ir_translator *tr) {
+    return ((struct pred_result *) tr->pred_results.data)[--tr->pred_results.len];
+}
+
+/*
+ * Short-circuiting and/or are translated with a stack of pending predicates. The rhs is pushed first together with the
+ * label of the block it starts, so it is translated once the whole lhs is done. When checking, a logical task below
+ * the two sides checks their types after both are done, and the type of the whole predicate is returned.
+ */
+static struct pred_result ir_translate_pred(struct ir_translator *tr, abc_node node, ir_label success, ir_label fail) {
+    size_t base = tr->pred_tasks.len;
+    struct pred_task root = {.tag = PRED_TASK_COND, .node = node, .success = success, .fail = fail, .has_start = false};
+    abc_arr_push(&tr->pred_tasks, &root);
+    while (tr->pred_tasks.len > base) {
+        struct pred_task task = ((struct pred_task *) tr->pred_tasks.data)[--tr->pred_tasks.len];
+        struct abc_expr *pred = abc_ast_expr(tr->ast, task.node);
+        if (task.tag == PRED_TASK_LOGICAL) {
+            struct pred_result right = pop_pred_result(tr);
+            struct pred_result left = pop_pred_result(tr);
+            struct pred_result res = {.err = left.err || right.err};
+            if (!res.err) {
+                res.err = !check_bin_expr(pred->op, left.type, right.type, &res.type);
+            }
+            abc_arr_push(&tr->pred_results, &res);
+            continue;
+        }
+        if (task.has_start) {
+            enter_block(tr, task.start);
+        }
+        // and/or keep short-circuiting inside parentheses
+        while (pred->tag == ABC_EXPR_GROUPING) {
+            task.node = pred->val.grouping_expr.expr;
+            pred = abc_ast_expr(tr->ast, task.node);
+        }
+        if (pred->tag == ABC_EXPR_BINARY && (pred->op == TOKEN_AND || pred->op == TOKEN_OR)) {
+            ir_label label = new_label(tr);
+            struct pred_task right = {PRED_TASK_COND, pred->val.bin_expr.right, task.success, task.fail, true, label};
+            struct pred_task left = {PRED_TASK_COND, pred->val.bin_expr.left, label, task.fail, false, 0};
+            if (pred->op == TOKEN_OR) {
+                left.success = task.success;
+                left.fail = label;
+            }
+            if (tr->check) {
+                struct pred_task logical = {.tag = PRED_TASK_LOGICAL, .node = task.node};
+                abc_arr_push(&tr->pred_tasks, &logical);
+            }
+            abc_arr_push(&tr->pred_tasks, &right);
+            abc_arr_push(&tr->pred_tasks, &left);
+        } else {
+            struct expr_result expr;
+            struct ir_atom atom;
+            struct ir_tail tail;
+            expr = ir_translate_expr(tr, task.node);
+            if (tr->check) {
+                struct pred_result res = {.err = expr.err, .type = expr.expr.type};
+                abc_arr_push(&tr->pred_results, &res);
+            }
+            atom = ir_atomize_expr(tr, &expr.expr);
+            tail.tag = IR_TAIL_IF;
+            tail.val.if_then_else.atom = atom;
+            tail.val.if_then_else.then_label = task.success;
+            tail.val.if_then_else.else_label = task.fail;
+            set_tail(tr, tail);
+        }
     }
+    if (tr->check) {
+        return pop_pred_result(tr);
+    }
+    return (struct pred_result) {.err = false, .type = ABC_TYPE_BOOL};
 }
 
-static void ir_translate_pred(struct ir_translator *tr, struct abc_expr *pred, char *success, char *fail) {
-    if (pred->tag == ABC_EXPR_BINARY && pred->val.bin_expr.op.type == TOKEN_AND) {
-        char *new_success = fun_inner_label(tr);
-        ir_translate_pred(tr, pred->val.bin_expr.left, new_success, fail);
-
-        struct ir_block new_success_block = {.label = new_success, .has_tail = false};
-        abc_arr_init(&new_success_block.stmts, sizeof(struct ir_stmt), tr->pool);
-        tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &new_success_block);
-
-        ir_translate_pred(tr, pred->val.bin_expr.right, success, fail);
-    } else if (pred->tag == ABC_EXPR_BINARY && pred->val.bin_expr.op.type == TOKEN_OR) {
-        char *new_fail = fun_inner_label(tr);
-        ir_translate_pred(tr, pred->val.bin_expr.left, success, new_fail);
-        struct ir_block new_fail_block = {.label = new_fail, .has_tail = false};
-        abc_arr_init(&new_fail_block.stmts, sizeof(struct ir_stmt), tr->pool);
-        tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &new_fail_block);
-        ir_translate_pred(tr, pred->val.bin_expr.right, success, fail);
-    } else {
-        struct ir_expr expr;
-        struct ir_atom atom;
-        struct ir_tail tail;
-        expr = ir_translate_expr(tr, pred);
-        atom = ir_atomize_expr(tr, &expr);
-        tail.tag = IR_TAIL_IF;
-        tail.val.if_then_else.atom = atom;
-        tail.val.if_then_else.then_label = success;
-        tail.val.if_then_else.else_label = fail;
-        tr->curr_block->has_tail = true;
-        tr->curr_block->tail = tail;
-    }
-}
-
-static void ir_translate_if_stmt(struct ir_translator *tr, struct abc_if_stmt *stmt) {
+static bool ir_translate_if_stmt(struct ir_translator *tr, struct abc_if_stmt *stmt) {
     // success -> then block, fail = else/continue block
     // set tail to continuation in whatever the current block is.
-    char *cont_label = fun_inner_label(tr);
-    char *then_label = fun_inner_label(tr);
-    char *else_label = fun_inner_label(tr);
+    ir_label cont_label = new_label(tr);
+    ir_label then_label = new_label(tr);
+    ir_label else_label = new_label(tr);
 
     // cond
-    ir_translate_pred(tr, stmt->cond, then_label, else_label);
+    struct pred_result cond = ir_translate_pred(tr, stmt->cond, then_label, else_label);
+    if (cond.err) {
+        return false;
+    }
+    if (cond.type != ABC_TYPE_BOOL) {
+        fprintf(stderr, "expect bool in if condition\n");
+        return false;
+    }
 
     // then
-    struct ir_block then_block = {.label = then_label, .has_tail = false};
-    abc_arr_init(&then_block.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &then_block);
-    ir_translate_stmt(tr, stmt->then_stmt);
-    if (!tr->curr_block->has_tail) {
+    enter_block(tr, then_label);
+    if (!ir_translate_stmt(tr, stmt->then_stmt)) {
+        return false;
+    }
+    if (!curr_block(tr)->has_tail) {
         // guard against returns
-        tr->curr_block->has_tail = true;
-        tr->curr_block->tail = (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = cont_label};
+        set_goto(tr, cont_label);
     }
 
     // else
-    struct ir_block else_block = {.label = else_label, .has_tail = false};
-    abc_arr_init(&else_block.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &else_block);
-    if (stmt->has_else) {
-        ir_translate_stmt(tr, stmt->else_stmt);
+    enter_block(tr, else_label);
+    if (stmt->else_stmt != ABC_NODE_NONE && !ir_translate_stmt(tr, stmt->else_stmt)) {
+        return false;
     }
-    if (!tr->curr_block->has_tail) {
-        tr->curr_block->has_tail = true;
-        tr->curr_block->tail = (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = cont_label};
+    if (!curr_block(tr)->has_tail) {
+        set_goto(tr, cont_label);
     }
 
     // setup continuation
-    struct ir_block cont = {.label = cont_label, .has_tail = false};
-    abc_arr_init(&cont.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &cont);
+    enter_block(tr, cont_label);
+    return true;
 }
 
-static void ir_translate_while_stmt(struct ir_translator *tr, struct abc_while_stmt *stmt) {
+static bool ir_translate_while_stmt(struct ir_translator *tr, struct abc_while_stmt *stmt) {
     // success -> back to while block, fail = continue block
-    char *loop_start_label = fun_inner_label(tr);
-    char *loop_body_label = fun_inner_label(tr);
-    char *cont_label = fun_inner_label(tr);
-    tr->curr_block->has_tail = true;
-    tr->curr_block->tail.tag = IR_TAIL_GOTO;
-    tr->curr_block->tail.val.go_to.label = loop_start_label;
+    ir_label loop_start_label = new_label(tr);
+    ir_label loop_body_label = new_label(tr);
+    ir_label cont_label = new_label(tr);
+    set_goto(tr, loop_start_label);
 
     // cond
-    struct ir_block loop = {.label = loop_start_label, .has_tail = false};
-    abc_arr_init(&loop.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &loop);
-    ir_translate_pred(tr, stmt->cond, loop_body_label, cont_label);
+    enter_block(tr, loop_start_label);
+    struct pred_result cond = ir_translate_pred(tr, stmt->cond, loop_body_label, cont_label);
+    if (cond.err) {
+        return false;
+    }
+    if (cond.type != ABC_TYPE_BOOL) {
+        fprintf(stderr, "expect bool in while condition\n");
+        return false;
+    }
 
     // body
-    struct ir_block body = {.label = loop_body_label, .has_tail = false};
-    abc_arr_init(&body.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &body);
-    ir_translate_stmt(tr, stmt->body);
-    tr->curr_block->has_tail = true;
-    tr->curr_block->tail.tag = IR_TAIL_GOTO;
-    tr->curr_block->tail.val.go_to.label = loop_start_label;
+    enter_block(tr, loop_body_label);
+    bool ok = ir_translate_stmt(tr, stmt->body);
+    set_goto(tr, loop_start_label);
 
     // cont
-    struct ir_block cont = {.label = cont_label, .has_tail = false};
-    abc_arr_init(&cont.stmts, sizeof(struct ir_stmt), tr->pool);
-    tr->curr_block = abc_arr_push(&tr->curr_fun->blocks, &cont);
+    enter_block(tr, cont_label);
+    return ok;
 }
 
-static void ir_translate_expr_stmt(struct ir_translator *tr, struct abc_expr_stmt *stmt) {
-    struct ir_expr expr = ir_translate_expr(tr, stmt->expr);
-    struct ir_stmt ir_stmt = {.tag = IR_STMT_EXPR, .val.expr = {expr}};
-    abc_arr_push(&tr->curr_block->stmts, &ir_stmt);
+static bool ir_translate_expr_stmt(struct ir_translator *tr, struct abc_expr_stmt *stmt) {
+    struct expr_result expr = ir_translate_expr(tr, stmt->expr);
+    struct ir_stmt ir_stmt = {.tag = IR_STMT_EXPR, .val.expr = {expr.expr}};
+    abc_arr_push(&curr_block(tr)->stmts, &ir_stmt);
+    return !expr.err;
 }
 
-static void ir_translate_print_stmt(struct ir_translator *tr, struct abc_print_stmt *stmt) {
-    struct ir_expr expr = ir_translate_expr(tr, stmt->expr);
-    struct ir_atom atom = ir_atomize_expr(tr, &expr);
+static bool ir_translate_print_stmt(struct ir_translator *tr, struct abc_print_stmt *stmt) {
+    struct expr_result expr = ir_translate_expr(tr, stmt->expr);
+    if (tr->check && expr.expr.type == ABC_TYPE_VOID) {
+        // also reached after an error in expr, as in the typechecker
+        fprintf(stderr, "expect non-void expr in print statement\n");
+        return false;
+    }
+    struct ir_atom atom = ir_atomize_expr(tr, &expr.expr);
     struct ir_stmt_print print = {.atom = atom};
     struct ir_stmt res = {.tag = IR_STMT_PRINT, .val.print = print};
-    abc_arr_push(&tr->curr_block->stmts, &res);
+    abc_arr_push(&curr_block(tr)->stmts, &res);
+    return !expr.err;
 }
 
-static void ir_translate_return_stmt(struct ir_translator *tr, struct abc_return_stmt *stmt) {
-    // TODO: this needs to be considered. Returns within a scope means that no further stmts for that block
-    // can be executed. Maybe make sure that return is the last statement of a block in the typechecker?
-    // could also be handled by creating an insert_ir_stmt function that checks if return has been
-    // encountered, and if that case simply does not append any more statements.
-    struct ir_tail_ret ret = {.has_atom = stmt->has_expr};
+static bool ir_translate_return_stmt(struct ir_translator *tr, struct abc_return_stmt *stmt) {
+    struct ir_tail_ret ret = {.has_atom = stmt->expr != ABC_NODE_NONE};
     struct ir_tail tail = {.tag = IR_TAIL_RET};
+    enum abc_type type = ABC_TYPE_VOID;
     if (ret.has_atom) {
-        struct ir_expr expr = ir_translate_expr(tr, stmt->expr);
-        struct ir_atom atom = ir_atomize_expr(tr, &expr);
+        struct expr_result expr = ir_translate_expr(tr, stmt->expr);
+        if (expr.err) {
+            return false;
+        }
+        struct ir_atom atom = ir_atomize_expr(tr, &expr.expr);
         ret.atom = atom;
+        type = expr.expr.type;
+    }
+    if (tr->check && type != tr->curr_fun->type) {
+        fprintf(stderr, "type mismatch for return statement\n");
+        return false;
     }
 
     tail.val.ret = ret;
-    tr->curr_block->tail = tail;
-    tr->curr_block->has_tail = true;
+    set_tail(tr, tail);
+    // the statements after a return cannot run, they go to a block nothing jumps to instead of after the tail
+    enter_block(tr, new_label(tr));
+    return true;
 }
 
-static void ir_translate_block_stmt(struct ir_translator *tr, struct abc_block_stmt *block) {
+static bool ir_translate_block_stmt(struct ir_translator *tr, struct abc_block_stmt *block) {
     push_ir_var_scope(tr);
+    bool ok = true;
+    struct abc_decl *decls = abc_ast_decls(tr->ast, block->decls);
     for (size_t i = 0; i < block->decls.len; i++) {
-        struct abc_decl decl = ((struct abc_decl *) block->decls.data)[i];
-        ir_translate_decl(tr, &decl);
+        if (!ir_translate_decl(tr, &decls[i])) {
+            ok = false;
+        }
     }
     pop_ir_var_scope(tr);
+    return ok;
 }
 
 static enum ir_bin_op to_ir_bin_op(enum abc_token_type type) {
@@ -382,98 +551,361 @@ static enum ir_cmp to_ir_cmp(enum abc_token_type type) {
     }
 }
 
-static struct ir_atom ir_translate_and_atomize_expr(struct ir_translator *tr, struct abc_expr *expr) {
-    struct ir_expr ir_expr = ir_translate_expr(tr, expr);
-    return ir_atomize_expr(tr, &ir_expr);
+/*
+ * Type of a binary expression from the types of its operands, reporting an error like the typechecker if they do not
+ * fit the operator.
+ */
+static bool check_bin_expr(enum abc_token_type op, enum abc_type left, enum abc_type right, enum abc_type *type) {
+    if (op == TOKEN_OR || op == TOKEN_AND) {
+        if (left != ABC_TYPE_BOOL || right != ABC_TYPE_BOOL) {
+            fprintf(stderr, "expect bool as lhs and rhs in logical expression\n");
+            return false;
+        }
+        *type = ABC_TYPE_BOOL;
+        return true;
+    }
+    if (left != ABC_TYPE_INT || right != ABC_TYPE_INT) {
+        fprintf(stderr, "expect int as lhs and rhs in numerical/relational expression\n");
+        return false;
+    }
+    *type = op == TOKEN_PLUS || op == TOKEN_MINUS || op == TOKEN_STAR || op == TOKEN_SLASH ? ABC_TYPE_INT
+                                                                                         : ABC_TYPE_BOOL;
+    return true;
 }
 
-struct ir_expr ir_translate_expr(struct ir_translator *tr, struct abc_expr *expr) {
+static struct expr_result pop_expr_result(struct ir_translator *tr) {
+    return ((struct expr_result *) tr->expr_results.data)[--tr->expr_results.len];
+}
+
+// Result of an expression with an error, the translation is thrown away so any placeholder will do.
+static struct expr_result error_result(void) {
+    struct ir_expr expr = {.tag = IR_EXPR_ATOM, .type = ABC_TYPE_VOID, .val.atom.atom = {.tag = IR_ATOM_INT_LIT}};
+    return (struct expr_result) {.err = true, .expr = expr};
+}
+
+/*
+ * Advance frame, returns true with child set when a child must be translated next, false with result set when the
+ * expression is done. Operands are atomized as soon as they are translated so the temporaries are declared in the
+ * same order as a depth first walk would. When checking, errors are reported in the same order as the typechecker.
+ */
+static bool ir_translate_expr_step(struct ir_translator *tr, struct expr_frame *frame, abc_node *child,
+                                   bool *atomize, struct expr_result *result) {
+    struct abc_expr *expr = abc_ast_expr(tr->ast, frame->node);
     // Short-circuiting logic for these is handled in translate_pred.
     // Since the only valid place for these is in if stmts/while stmts (typechecker), we only need to worry about
     // them there. This means that ir_translate_expr will never need to create a new basic block.
-    assert(expr->tag != ABC_EXPR_BINARY || expr->val.bin_expr.op.type != TOKEN_AND);
-    assert(expr->tag != ABC_EXPR_BINARY || expr->val.bin_expr.op.type != TOKEN_OR);
+    // When checking they are reported as an error instead, unless the program has type errors.
+    assert(tr->check || expr->tag != ABC_EXPR_BINARY || expr->op != TOKEN_AND);
+    assert(tr->check || expr->tag != ABC_EXPR_BINARY || expr->op != TOKEN_OR);
 
-    struct ir_atom lhs;
-    struct ir_atom rhs;
-    struct ir_expr ir_expr = {.type = expr->type};
+    struct expr_result lhs;
+    struct expr_result rhs;
+    struct ir_expr ir_expr = {.type = (enum abc_type) expr->type};
     struct ir_expr *ir_expr_ptr;
-    struct ir_expr tmp;
-    char *label;
+    struct ir_fun_data *fun;
+    struct ir_var_data *var;
+    abc_node *args;
+    size_t len;
 
-    switch (expr->tag) {
+    switch ((enum abc_expr_tag) expr->tag) {
         case ABC_EXPR_BINARY:
-            lhs = ir_translate_and_atomize_expr(tr, expr->val.bin_expr.left);
-            rhs = ir_translate_and_atomize_expr(tr, expr->val.bin_expr.right);
-            if (expr->val.bin_expr.op.type == TOKEN_PLUS || expr->val.bin_expr.op.type == TOKEN_MINUS ||
-                expr->val.bin_expr.op.type == TOKEN_STAR || expr->val.bin_expr.op.type == TOKEN_SLASH) {
+            if (frame->next < 2) {
+                *child = frame->next++ == 0 ? expr->val.bin_expr.left : expr->val.bin_expr.right;
+                *atomize = true;
+                return true;
+            }
+            rhs = pop_expr_result(tr);
+            lhs = pop_expr_result(tr);
+            if (lhs.err || rhs.err ||
+                (tr->check && !check_bin_expr(expr->op, lhs.expr.type, rhs.expr.type, &ir_expr.type))) {
+                *result = error_result();
+                return false;
+            }
+            if (expr->op == TOKEN_AND || expr->op == TOKEN_OR) {
+                // well typed, so translation goes on with a placeholder to check the rest
+                tr->logical_in_expr = true;
+                *result = error_result();
+                result->err = false;
+                result->expr.type = ir_expr.type;
+                return false;
+            }
+            if (expr->op == TOKEN_PLUS || expr->op == TOKEN_MINUS ||
+                expr->op == TOKEN_STAR || expr->op == TOKEN_SLASH) {
                 ir_expr.tag = IR_EXPR_BIN;
-                ir_expr.val.bin.lhs = lhs;
-                ir_expr.val.bin.rhs = rhs;
-                ir_expr.val.bin.op = to_ir_bin_op(expr->val.bin_expr.op.type);
+                ir_expr.val.bin.lhs = lhs.expr.val.atom.atom;
+                ir_expr.val.bin.rhs = rhs.expr.val.atom.atom;
+                ir_expr.val.bin.op = to_ir_bin_op(expr->op);
             } else {
                 ir_expr.tag = IR_EXPR_CMP;
-                ir_expr.val.cmp.lhs = lhs;
-                ir_expr.val.cmp.rhs = rhs;
-                ir_expr.val.cmp.cmp = to_ir_cmp(expr->val.bin_expr.op.type);
+                ir_expr.val.cmp.lhs = lhs.expr.val.atom.atom;
+                ir_expr.val.cmp.rhs = rhs.expr.val.atom.atom;
+                ir_expr.val.cmp.cmp = to_ir_cmp(expr->op);
             }
             break;
         case ABC_EXPR_UNARY:
+            if (frame->next++ == 0) {
+                *child = expr->val.unary_expr.expr;
+                *atomize = true;
+                return true;
+            }
+            rhs = pop_expr_result(tr);
+            if (rhs.err) {
+                *result = error_result();
+                return false;
+            }
+            if (tr->check) {
+                ir_expr.type = expr->op == TOKEN_BANG ? ABC_TYPE_BOOL : ABC_TYPE_INT;
+                if (rhs.expr.type != ir_expr.type) {
+                    fprintf(stderr, expr->op == TOKEN_BANG ? "expect bool as rhs of negation\n"
+                                                           : "expect int as rhs of unary '-'\n");
+                    *result = error_result();
+                    return false;
+                }
+            }
             ir_expr.tag = IR_EXPR_UNARY;
-            ir_expr.val.unary.op = expr->val.unary_expr.op.type == TOKEN_BANG ? IR_UNARY_BANG : IR_UNARY_MINUS;
-            lhs = ir_translate_and_atomize_expr(tr, expr->val.unary_expr.expr);
-            ir_expr.val.unary.atom = lhs;
+            ir_expr.val.unary.op = expr->op == TOKEN_BANG ? IR_UNARY_BANG : IR_UNARY_MINUS;
+            ir_expr.val.unary.atom = rhs.expr.val.atom.atom;
             break;
         case ABC_EXPR_CALL:
+            // when checking, arguments are checked one at a time and the first bad argument ends the check
+            len = expr->val.call_expr.args.len;
+            if (tr->check && frame->next == 0) {
+                fun = find_ir_fun(tr, expr->val.call_expr.callee);
+                if (fun == NULL) {
+                    fprintf(stderr, "unknown function %s\n", abc_intern_str(tr->symbols, expr->val.call_expr.callee));
+                    *result = error_result();
+                    return false;
+                }
+                if (fun->decl->params.len != len) {
+                    fprintf(stderr, "incorrect parameter count for %s\n",
+                            abc_intern_str(tr->symbols, expr->val.call_expr.callee));
+                    *result = error_result();
+                    return false;
+                }
+                frame->callee = fun->decl;
+            } else if (tr->check) {
+                size_t i = frame->next - 1;
+                struct expr_result *arg = (struct expr_result *) tr->expr_results.data + tr->expr_results.len - 1;
+                struct abc_param param = ((struct abc_param *) frame->callee->params.data)[i];
+                if (arg->err || arg->expr.type != (enum abc_type) param.type) {
+                    if (!arg->err) {
+                        fprintf(stderr, "type mismatch for parameter %lu in call to %s\n", i + 1,
+                                abc_intern_str(tr->symbols, expr->val.call_expr.callee));
+                    }
+                    tr->expr_results.len -= frame->next;
+                    *result = error_result();
+                    return false;
+                }
+            }
+            if (frame->next < len) {
+                args = abc_ast_args(tr->ast, expr->val.call_expr.args);
+                *child = args[frame->next++];
+                *atomize = true;
+                return true;
+            }
             ir_expr.tag = IR_EXPR_CALL;
-            abc_arr_init(&ir_expr.val.call.args, sizeof(struct ir_param), tr->pool);
-            for (size_t i = 0; i < expr->val.call_expr.args.len; i++) {
-                struct abc_expr *arg = ((struct abc_expr **) expr->val.call_expr.args.data)[i];
-                struct ir_atom atom = ir_translate_and_atomize_expr(tr, arg);
-                abc_arr_push(&ir_expr.val.call.args, &atom);
+            abc_arr_init_cap(&ir_expr.val.call.args, sizeof(struct ir_atom), len, tr->pool);
+            tr->expr_results.len -= len;
+            for (size_t i = 0; i < len; i++) {
+                struct expr_result *arg = (struct expr_result *) tr->expr_results.data + tr->expr_results.len + i;
+                abc_arr_push(&ir_expr.val.call.args, &arg->expr.val.atom.atom);
+            }
+            ir_expr.val.call.label = lookup_ir_fun(tr, expr->val.call_expr.callee);
+            if (tr->check) {
+                ir_expr.type = (enum abc_type) frame->callee->type;
             }
-            label = lookup_ir_fun(tr, expr->val.call_expr.callee.val.identifier.lexeme);
-            ir_expr.val.call.label = label;
             break;
         case ABC_EXPR_LITERAL:
             ir_expr.tag = IR_EXPR_ATOM;
-            if (expr->val.lit_expr.lit.tag == ABC_LITERAL_INT) {
+            if (expr->lit_tag == ABC_LITERAL_INT) {
+                ir_expr.type = ABC_TYPE_INT;
                 ir_expr.val.atom.atom.tag = IR_ATOM_INT_LIT;
-                ir_expr.val.atom.atom.val.int_lit = expr->val.lit_expr.lit.val.integer;
+                ir_expr.val.atom.atom.val.int_lit = abc_ast_int(tr->ast, &expr->val.lit_expr);
             } else {
-                label = lookup_ir_var(tr, expr->val.lit_expr.lit.val.identifier.lexeme);
+                var = find_ir_var(tr, expr->val.lit_expr.val.identifier);
+                if (tr->check && var == NULL) {
+                    fprintf(stderr, "reference to unknown identifier %s\n",
+                            abc_intern_str(tr->symbols, expr->val.lit_expr.val.identifier));
+                    *result = error_result();
+                    return false;
+                }
+                assert(var != NULL);
+                ir_expr.type = var->type;
                 ir_expr.val.atom.atom.tag = IR_ATOM_IDENTIFIER;
-                ir_expr.val.atom.atom.val.label = label;
+                ir_expr.val.atom.atom.val.var = var->var;
             }
             break;
         case ABC_EXPR_ASSIGN:
+            if (frame->next++ == 0) {
+                var = find_ir_var(tr, expr->val.assign_expr.identifier);
+                if (tr->check && var == NULL) {
+                    fprintf(stderr, "trying to assign to unknown identifier %s\n",
+                            abc_intern_str(tr->symbols, expr->val.assign_expr.identifier));
+                    *result = error_result();
+                    return false;
+                }
+                assert(var != NULL);
+                frame->type = var->type;
+                *child = expr->val.assign_expr.expr;
+                *atomize = false;
+                return true;
+            }
+            rhs = pop_expr_result(tr);
+            if (rhs.err || (tr->check && rhs.expr.type != frame->type)) {
+                if (!rhs.err) {
+                    fprintf(stderr, "attempt to assign value to %s of different type\n",
+                            abc_intern_str(tr->symbols, expr->val.assign_expr.identifier));
+                }
+                *result = error_result();
+                return false;
+            }
             ir_expr.tag = IR_EXPR_ASSIGN;
-            tmp = ir_translate_expr(tr, expr->val.assign_expr.expr);
+            ir_expr.type = frame->type;
             ir_expr_ptr = abc_pool_alloc(tr->pool, sizeof(struct ir_expr), 1);
-            *ir_expr_ptr = tmp;
+            *ir_expr_ptr = rhs.expr;
             ir_expr.val.assign.value = ir_expr_ptr;
-            label = lookup_ir_var(tr, expr->val.assign_expr.lit.val.identifier.lexeme);
-            ir_expr.val.assign.label = label;
+            ir_expr.val.assign.var = lookup_ir_var(tr, expr->val.assign_expr.identifier);
             break;
         case ABC_EXPR_GROUPING:
-            return ir_translate_expr(tr, expr->val.grouping_expr.expr);
+            // the grouping atomizes on behalf of its parent
+            if (frame->next++ == 0) {
+                *child = expr->val.grouping_expr.expr;
+                *atomize = false;
+                return true;
+            }
+            *result = pop_expr_result(tr);
+            return false;
         default:
             assert(0);
     }
 
-    return ir_expr;
+    *result = (struct expr_result) {.err = false, .expr = ir_expr};
+    return false;
+}
+
+static struct expr_result ir_translate_expr(struct ir_translator *tr, abc_node node) {
+    size_t base = tr->expr_frames.len;
+    struct expr_frame root = {.node = node, .next = 0, .atomize = false};
+    abc_arr_push(&tr->expr_frames, &root);
+    while (tr->expr_frames.len > base) {
+        struct expr_frame *frame = (struct expr_frame *) tr->expr_frames.data + tr->expr_frames.len - 1;
+        abc_node child;
+        bool atomize;
+        struct expr_result result;
+        if (ir_translate_expr_step(tr, frame, &child, &atomize, &result)) {
+            struct expr_frame child_frame = {.node = child, .next = 0, .atomize = atomize};
+            abc_arr_push(&tr->expr_frames, &child_frame);
+            continue;
+        }
+        if (frame->atomize && !result.err) {
+            struct ir_atom atom = ir_atomize_expr(tr, &result.expr);
+            result.expr = (struct ir_expr) {.tag = IR_EXPR_ATOM, .type = result.expr.type, .val.atom.atom = atom};
+        }
+        tr->expr_frames.len--;
+        abc_arr_push(&tr->expr_results, &result);
+    }
+    return pop_expr_result(tr);
 }
 
 struct ir_atom ir_atomize_expr(struct ir_translator *translator, struct ir_expr *expr) {
     if (expr->tag == IR_EXPR_ATOM) {
         return expr->val.atom.atom;
     }
-    char *label = fun_var_label(translator);
-    struct ir_stmt_decl ir_decl = {.has_init = true, .type = expr->type, .init = *expr, .label = label};
+    ir_var var = new_var(translator);
+    struct ir_stmt_decl ir_decl = {.has_init = true, .type = expr->type, .init = *expr, .var = var};
     struct ir_stmt stmt = {.tag = IR_STMT_DECL, .val = {ir_decl}};
-    abc_arr_push(&translator->curr_block->stmts, &stmt);
-    // TODO: Update num vars for ir_fun
-    return (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.label = label};
+    abc_arr_push(&curr_block(translator)->stmts, &stmt);
+    return (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.var = var};
+}
+
+/* TRAVERSAL */
+
+struct ir_expr *ir_expr_value(struct ir_expr *expr) {
+    while (expr->tag == IR_EXPR_ASSIGN) {
+        expr = expr->val.assign.value;
+    }
+    return expr;
+}
+
+void ir_expr_each_atom(struct ir_expr *expr, ir_atom_fn fn, void *ctx) {
+    expr = ir_expr_value(expr);
+    switch (expr->tag) {
+        case IR_EXPR_BIN:
+            fn(ctx, &expr->val.bin.lhs);
+            fn(ctx, &expr->val.bin.rhs);
+            break;
+        case IR_EXPR_UNARY:
+            fn(ctx, &expr->val.unary.atom);
+            break;
+        case IR_EXPR_ATOM:
+            fn(ctx, &expr->val.atom.atom);
+            break;
+        case IR_EXPR_CMP:
+            fn(ctx, &expr->val.cmp.lhs);
+            fn(ctx, &expr->val.cmp.rhs);
+            break;
+        case IR_EXPR_CALL:
+            for (size_t i = 0; i < expr->val.call.args.len; i++) {
+                fn(ctx, (struct ir_atom *) expr->val.call.args.data + i);
+            }
+            break;
+        case IR_EXPR_ASSIGN:
+            assert(0);
+    }
+}
+
+void ir_tail_each_atom(struct ir_tail *tail, ir_atom_fn fn, void *ctx) {
+    if (tail->tag == IR_TAIL_RET && tail->val.ret.has_atom) {
+        fn(ctx, &tail->val.ret.atom);
+    } else if (tail->tag == IR_TAIL_IF) {
+        fn(ctx, &tail->val.if_then_else.atom);
+    }
+}
+
+bool ir_expr_has_effect(struct ir_expr *expr) {
+    expr = ir_expr_value(expr);
+    if (expr->tag == IR_EXPR_CALL) {
+        return true;
+    }
+    if (expr->tag != IR_EXPR_BIN || expr->val.bin.op != IR_BIN_DIV) {
+        return false;
+    }
+    // division by a variable can be by 0 or -1 too
+    struct ir_atom rhs = expr->val.bin.rhs;
+    return rhs.tag != IR_ATOM_INT_LIT || rhs.val.int_lit == 0 || rhs.val.int_lit == -1;
+}
+
+struct ir_expr_call *ir_block_tail_call(const struct ir_fun *fun, ir_label block) {
+    struct ir_block *curr = ir_fun_block(fun, block);
+    if (curr->stmts.len == 0) {
+        return NULL;
+    }
+    struct ir_stmt *last = (struct ir_stmt *) curr->stmts.data + curr->stmts.len - 1;
+    struct ir_expr *call = last->tag == IR_STMT_DECL ? &last->val.decl.init : &last->val.expr.expr;
+    if (last->tag == IR_STMT_PRINT || (last->tag == IR_STMT_DECL && !last->val.decl.has_init) ||
+        call->tag != IR_EXPR_CALL) {
+        return NULL;
+    }
+    // bounded by the number of blocks, a loop of empty blocks never returns
+    for (size_t i = 0; i < fun->blocks.len && curr->has_tail; i++) {
+        if (curr->tail.tag == IR_TAIL_GOTO) {
+            curr = ir_fun_block(fun, curr->tail.val.go_to.label);
+            if (curr->stmts.len != 0 || curr->phis.len != 0) {
+                return NULL;
+            }
+            continue;
+        }
+        if (curr->tail.tag != IR_TAIL_RET) {
+            return NULL;
+        }
+        struct ir_tail_ret ret = curr->tail.val.ret;
+        if (last->tag == IR_STMT_EXPR) {
+            return ret.has_atom ? NULL : &call->val.call;
+        }
+        bool returns_var = ret.has_atom && ret.atom.tag == IR_ATOM_IDENTIFIER && ret.atom.val.var == last->val.decl.var;
+        return returns_var ? &call->val.call : NULL;
+    }
+    return NULL;
 }
 
 /* PRINTING */
@@ -536,43 +968,51 @@ static char *unary_to_str(enum ir_unary_op op) {
     }
 }
 
-static void ir_program_print_atom(struct ir_atom *atom, FILE *out) {
+static void ir_program_print_var(const struct ir_fun *fun, ir_var var, FILE *out) {
+    fprintf(out, "%s_var_%u", fun->label, var);
+}
+
+static void ir_program_print_label(const struct ir_fun *fun, ir_label label, FILE *out) {
+    fprintf(out, "%s_lab_%u", fun->label, label);
+}
+
+static void ir_program_print_atom(const struct ir_fun *fun, struct ir_atom *atom, FILE *out) {
     switch (atom->tag) {
         case IR_ATOM_INT_LIT:
             fprintf(out, "%ld", atom->val.int_lit);
             break;
         case IR_ATOM_IDENTIFIER:
-            fprintf(out, "%s", atom->val.label);
+            ir_program_print_var(fun, atom->val.var, out);
             break;
         default:
             assert(0);
     }
 }
 
-static void ir_program_print_expr(struct ir_expr *expr, FILE *out) {
+static void ir_program_print_expr(const struct ir_fun *fun, struct ir_expr *expr, FILE *out) {
     switch (expr->tag) {
         case IR_EXPR_BIN:
-            ir_program_print_atom(&expr->val.bin.lhs, out);
+            ir_program_print_atom(fun, &expr->val.bin.lhs, out);
             fprintf(out, " %s ", bin_op_to_str(expr->val.bin.op));
-            ir_program_print_atom(&expr->val.bin.rhs, out);
+            ir_program_print_atom(fun, &expr->val.bin.rhs, out);
             break;
         case IR_EXPR_UNARY:
             fprintf(out, "%s", unary_to_str(expr->val.unary.op));
-            ir_program_print_atom(&expr->val.unary.atom, out);
+            ir_program_print_atom(fun, &expr->val.unary.atom, out);
             break;
         case IR_EXPR_ATOM:
-            ir_program_print_atom(&expr->val.atom.atom, out);
+            ir_program_print_atom(fun, &expr->val.atom.atom, out);
             break;
         case IR_EXPR_CMP:
-            ir_program_print_atom(&expr->val.cmp.lhs, out);
+            ir_program_print_atom(fun, &expr->val.cmp.lhs, out);
             fprintf(out, " %s ", cmp_to_str(expr->val.cmp.cmp));
-            ir_program_print_atom(&expr->val.cmp.rhs, out);
+            ir_program_print_atom(fun, &expr->val.cmp.rhs, out);
             break;
         case IR_EXPR_CALL:
             fprintf(out, "%s(", expr->val.call.label);
             for (size_t i = 0; i < expr->val.call.args.len; i++) {
                 struct ir_atom arg = ((struct ir_atom *) expr->val.call.args.data)[i];
-                ir_program_print_atom(&arg, out);
+                ir_program_print_atom(fun, &arg, out);
                 if (i < expr->val.call.args.len - 1) {
                     fprintf(out, ", ");
                 }
@@ -580,59 +1020,87 @@ static void ir_program_print_expr(struct ir_expr *expr, FILE *out) {
             fprintf(out, ")");
             break;
         case IR_EXPR_ASSIGN:
-            fprintf(out, "%s = ", expr->val.assign.label);
-            ir_program_print_expr(expr->val.assign.value, out);
+            while (expr->tag == IR_EXPR_ASSIGN) {
+                ir_program_print_var(fun, expr->val.assign.var, out);
+                fprintf(out, " = ");
+                expr = expr->val.assign.value;
+            }
+            ir_program_print_expr(fun, expr, out);
             break;
     }
 }
 
-static void ir_program_print_stmt(struct ir_stmt *stmt, FILE *out) {
+static void ir_program_print_stmt(const struct ir_fun *fun, struct ir_stmt *stmt, FILE *out) {
     switch (stmt->tag) {
         case IR_STMT_DECL:
-            fprintf(out, "%s %s", type_to_str(stmt->val.decl.type), stmt->val.decl.label);
+            fprintf(out, "%s ", type_to_str(stmt->val.decl.type));
+            ir_program_print_var(fun, stmt->val.decl.var, out);
             if (stmt->val.decl.has_init) {
                 fprintf(out, " = ");
-                ir_program_print_expr(&stmt->val.decl.init, out);
+                ir_program_print_expr(fun, &stmt->val.decl.init, out);
             }
             fprintf(out, "\n");
             break;
         case IR_STMT_EXPR:
-            ir_program_print_expr(&stmt->val.expr.expr, out);
+            ir_program_print_expr(fun, &stmt->val.expr.expr, out);
             fprintf(out, "\n");
             break;
         case IR_STMT_PRINT:
             fprintf(out, "print ");
-            ir_program_print_atom(&stmt->val.print.atom, out);
+            ir_program_print_atom(fun, &stmt->val.print.atom, out);
             fprintf(out, "\n");
             break;
     }
 }
 
-static void ir_program_print_block(struct ir_block *block, FILE *out) {
-    fprintf(out, "%s:\n", block->label);
+static void ir_program_print_block(const struct ir_fun *fun, struct ir_block *block, FILE *out) {
+    ir_program_print_label(fun, block->label, out);
+    fprintf(out, ":\n");
+    for (size_t i = 0; i < block->phis.len; i++) {
+        struct ir_phi *phi = (struct ir_phi *) block->phis.data + i;
+        fprintf(out, "%s ", type_to_str(phi->type));
+        ir_program_print_var(fun, phi->var, out);
+        fprintf(out, " = phi(");
+        for (size_t j = 0; j < phi->args.len; j++) {
+            struct ir_phi_arg *arg = (struct ir_phi_arg *) phi->args.data + j;
+            ir_program_print_label(fun, arg->pred, out);
+            fprintf(out, ": ");
+            ir_program_print_atom(fun, &arg->atom, out);
+            if (j < phi->args.len - 1) {
+                fprintf(out, ", ");
+            }
+        }
+        fprintf(out, ")\n");
+    }
     for (size_t i = 0; i < block->stmts.len; i++) {
         struct ir_stmt stmt = ((struct ir_stmt *)block->stmts.data)[i];
-        ir_program_print_stmt(&stmt, out);
+        ir_program_print_stmt(fun, &stmt, out);
     }
     if (!block->has_tail) {
         return;
     }
     switch (block->tail.tag) {
         case IR_TAIL_GOTO:
-            fprintf(out, "goto %s\n", block->tail.val.go_to.label);
+            fprintf(out, "goto ");
+            ir_program_print_label(fun, block->tail.val.go_to.label, out);
+            fprintf(out, "\n");
             break;
         case IR_TAIL_RET:
             fprintf(out, "return");
             if (block->tail.val.ret.has_atom) {
-                ir_program_print_atom(&block->tail.val.ret.atom, out);
+                fprintf(out, " ");
+                ir_program_print_atom(fun, &block->tail.val.ret.atom, out);
             }
             fprintf(out, "\n");
             break;
         case IR_TAIL_IF:
             fprintf(out, "if ");
-            ir_program_print_atom(&block->tail.val.if_then_else.atom, out);
-            fprintf(out, " goto %s else goto %s\n",
-                block->tail.val.if_then_else.then_label, block->tail.val.if_then_else.else_label);
+            ir_program_print_atom(fun, &block->tail.val.if_then_else.atom, out);
+            fprintf(out, " goto ");
+            ir_program_print_label(fun, block->tail.val.if_then_else.then_label, out);
+            fprintf(out, " else goto ");
+            ir_program_print_label(fun, block->tail.val.if_then_else.else_label, out);
+            fprintf(out, "\n");
             break;
     }
 }
@@ -643,16 +1111,17 @@ void ir_program_print(struct ir_program *program, FILE *out) {
         fprintf(out, "%s (", fun.label);
         for (size_t j = 0; j < fun.args.len; j++) {
             struct ir_param param = ((struct ir_param *)fun.args.data)[j];
-            fprintf(out, "%s %s ", type_to_str(param.type), param.label);
+            fprintf(out, "%s ", type_to_str(param.type));
+            ir_program_print_var(&fun, param.var, out);
+            fprintf(out, " ");
             if (j < fun.args.len - 1) {
                 fprintf(out, ", ");
             }
         }
         fprintf(out, ") -> %s:\n", type_to_str(fun.type));
 
-        for (size_t j = 0; j < fun.blocks.len; j++) {
-            struct ir_block block = ((struct ir_block *)fun.blocks.data)[j];
-            ir_program_print_block(&block, out);
+        for (size_t j = 0; j < fun.rpo.len; j++) {
+            ir_program_print_block(&fun, ir_fun_block(&fun, ((ir_label *) fun.rpo.data)[j]), out);
         }
         fprintf(out, "\n");
     }
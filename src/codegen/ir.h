@@ -2,12 +2,18 @@
 #define IR_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "../data/abc_arr.h"
+#include "../data/abc_map.h"
 #include "../data/abc_pool.h"
 #include "../abc_type.h"
 #include "../abc_parser.h"
 
+// Variables and blocks are numbered densely per function, they only get a name when printed.
+typedef uint32_t ir_var;
+typedef uint32_t ir_label;
+
 enum ir_cmp { IR_CMP_EQ, IR_CMP_NE, IR_CMP_LT, IR_CMP_GT, IR_CMP_LE, IR_CMP_GE };
 
 enum ir_bin_op {
@@ -28,14 +34,14 @@ struct ir_atom {
     enum ir_atom_tag tag;
     union {
         long int_lit;
-        char *label;
+        ir_var var;
     } val;
 };
 
 enum ir_tail_tag { IR_TAIL_GOTO, IR_TAIL_RET, IR_TAIL_IF };
 
 struct ir_tail_goto {
-    char *label;
+    ir_label label;
 };
 
 struct ir_tail_ret {
@@ -45,8 +51,8 @@ struct ir_tail_ret {
 
 struct ir_tail_if {
     struct ir_atom atom;
-    char *then_label;
-    char *else_label;
+    ir_label then_label;
+    ir_label else_label;
 };
 
 struct ir_tail {
@@ -87,7 +93,7 @@ struct ir_expr_call {
 };
 
 struct ir_expr_assign {
-    char *label; // assign to
+    ir_var var; // assign to
     struct ir_expr *value;
 };
 
@@ -107,7 +113,7 @@ struct ir_expr {
 enum ir_stmt_tag { IR_STMT_DECL, IR_STMT_EXPR, IR_STMT_PRINT };
 
 struct ir_stmt_decl {
-    char *label;
+    ir_var var;
     enum abc_type type;
     bool has_init;
     struct ir_expr init;
@@ -130,55 +136,116 @@ struct ir_stmt {
     } val;
 };
 
+#define IR_RPO_NONE UINT32_MAX // rpo of a block not reachable from the entry
+#define IR_LABEL_NONE UINT32_MAX
+
+struct ir_phi_arg {
+    ir_label pred;
+    struct ir_atom atom;
+};
+
+struct ir_phi {
+    ir_var var;
+    enum abc_type type;
+    struct abc_arr args; // ir_phi_arg, one for each predecessor
+};
+
 struct ir_block {
-    char *label;
+    ir_label label;
+    struct abc_arr phis; // ir_phi, only in SSA form
     struct abc_arr stmts; // ir_stmt
     bool has_tail;
     struct ir_tail tail;
+    // control flow edges, kept in sync with the tail by ir_cfg_set_tail
+    struct abc_arr succs; // ir_label
+    struct abc_arr preds; // ir_label
+    uint32_t rpo; // position in ir_fun.rpo
+    // dominator tree, set by ir_cfg_compute_dominators, IR_LABEL_NONE where there is none
+    ir_label idom;
+    ir_label dom_child; // first child
+    ir_label dom_sibling; // next child of idom
 };
 
 struct ir_param {
-    char *label;
+    ir_var var;
     enum abc_type type;
 };
 
 struct ir_fun {
-    int num_var_labels;
+    bool ssa; // every variable is defined once, see ir_ssa.h
+    ir_var num_vars;
     char *label;
     enum abc_type type;
     struct abc_arr args; // ir_param
-    struct abc_arr blocks; // ir_block
+    struct abc_arr blocks; // ir_block, indexed by label
+    ir_label entry;
+    ir_label exit; // target of every return, never holds code
+    struct abc_arr rpo; // ir_label, the blocks reachable from entry in reverse postorder, without exit
 };
 
+static inline struct ir_block *ir_fun_block(const struct ir_fun *fun, ir_label label) {
+    return (struct ir_block *) fun->blocks.data + label;
+}
+
 struct ir_program {
     struct abc_arr ir_funs; // ir_fun
 };
 
+// TRAVERSAL
+
+typedef void (*ir_atom_fn)(void *ctx, struct ir_atom *atom);
+
+// Innermost value of an assignment chain, or expr itself.
+struct ir_expr *ir_expr_value(struct ir_expr *expr);
+
+// Call fn on every atom expr reads, for an assignment chain those of the assigned value.
+void ir_expr_each_atom(struct ir_expr *expr, ir_atom_fn fn, void *ctx);
+
+// Call fn on the atom a return or conditional jump reads.
+void ir_tail_each_atom(struct ir_tail *tail, ir_atom_fn fn, void *ctx);
+
+// Whether evaluating expr can do more than produce a value: calls, and divisions that may trap.
+bool ir_expr_has_effect(struct ir_expr *expr);
+
+// The call the block ends with if the function returns right after it, with its value or without one, or NULL. Jumps
+// through blocks without code are followed to the return.
+struct ir_expr_call *ir_block_tail_call(const struct ir_fun *fun, ir_label block);
+
 // TRANSLATOR
 
-// Used to map variable names to their labels
-// Marker is used to handle scopes during translation
 struct ir_var_data {
-    char *original_name;
-    char *label;
-    bool marker;
+    ir_var var;
+    enum abc_type type;
 };
 
-// Used to map function names to their labels.
 struct ir_fun_data {
-    char *original_name;
     char *label;
+    const struct abc_fun_decl *decl;
+    size_t index; // of the function in the program
 };
 
 struct ir_translator {
+    // Typecheck while translating, so each name is resolved once in a single walk. Errors are reported on stderr and
+    // set has_error, the program must not be used then. Otherwise the program must already be typechecked.
+    bool check;
     bool has_error;
-    struct abc_arr ir_funs; // ir_fun_data
-    struct abc_arr ir_vars; // ir_var_data, new for each function
+    struct abc_map ir_funs; // abc_sym -> ir_fun_data
+    struct abc_map ir_vars; // abc_sym -> ir_var_data, scoped, new for each function
+    size_t curr_fun_index; // when checking only the current and earlier functions can be called
+    bool logical_in_expr; // when checking, an and/or was found outside a condition
     // current function we are in
     struct ir_fun *curr_fun;
-    // current (active) basic block of the function we are in
-    struct ir_block *curr_block;
+    // current (active) basic block of the function we are in, a label since adding blocks moves them
+    ir_label curr_block;
     struct abc_pool *pool;
+    struct abc_intern *symbols;
+    // AST of the function being translated
+    struct abc_ast *ast;
+    // explicit stacks of ir_translate_expr and ir_translate_pred
+    struct abc_arr expr_frames;
+    struct abc_arr expr_results;
+    struct abc_arr pred_tasks;
+    struct abc_arr pred_results;
 };
 
 void ir_translator_init(struct ir_translator *translator);
@@ -0,0 +1,563 @@
+#include "ir_cfg.h"
+
+#include <assert.h>
+
+ir_label ir_cfg_new_block(struct ir_fun *fun, struct abc_pool *pool) {
+    struct ir_block block = {.label = (ir_label) fun->blocks.len,
+                             .has_tail = false,
+                             .rpo = IR_RPO_NONE,
+                             .idom = IR_LABEL_NONE,
+                             .dom_child = IR_LABEL_NONE,
+                             .dom_sibling = IR_LABEL_NONE};
+    abc_arr_init_cap(&block.phis, sizeof(struct ir_phi), 1, pool);
+    abc_arr_init(&block.stmts, sizeof(struct ir_stmt), pool);
+    abc_arr_init_cap(&block.succs, sizeof(ir_label), 2, pool);
+    abc_arr_init_cap(&block.preds, sizeof(ir_label), 2, pool);
+    abc_arr_push(&fun->blocks, &block);
+    return block.label;
+}
+
+static bool contains(struct abc_arr *labels, ir_label label) {
+    for (size_t i = 0; i < labels->len; i++) {
+        if (((ir_label *) labels->data)[i] == label) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void remove_label(struct abc_arr *labels, ir_label label) {
+    ir_label *data = labels->data;
+    for (size_t i = 0; i < labels->len; i++) {
+        if (data[i] == label) {
+            data[i] = data[--labels->len];
+            return;
+        }
+    }
+}
+
+// edges are kept unique, a conditional jump with both targets the same is a single edge
+static void add_edge(struct ir_fun *fun, ir_label from, ir_label to) {
+    struct ir_block *src = ir_fun_block(fun, from);
+    if (contains(&src->succs, to)) {
+        return;
+    }
+    abc_arr_push(&src->succs, &to);
+    abc_arr_push(&ir_fun_block(fun, to)->preds, &from);
+}
+
+void ir_cfg_clear_tail(struct ir_fun *fun, ir_label block) {
+    struct ir_block *b = ir_fun_block(fun, block);
+    for (size_t i = 0; i < b->succs.len; i++) {
+        remove_label(&ir_fun_block(fun, ((ir_label *) b->succs.data)[i])->preds, block);
+    }
+    b->succs.len = 0;
+    b->has_tail = false;
+}
+
+void ir_cfg_set_tail(struct ir_fun *fun, ir_label block, struct ir_tail tail) {
+    ir_cfg_clear_tail(fun, block);
+    struct ir_block *b = ir_fun_block(fun, block);
+    b->tail = tail;
+    b->has_tail = true;
+    switch (tail.tag) {
+        case IR_TAIL_GOTO:
+            add_edge(fun, block, tail.val.go_to.label);
+            break;
+        case IR_TAIL_RET:
+            add_edge(fun, block, fun->exit);
+            break;
+        case IR_TAIL_IF:
+            add_edge(fun, block, tail.val.if_then_else.then_label);
+            add_edge(fun, block, tail.val.if_then_else.else_label);
+            break;
+    }
+}
+
+ir_label ir_cfg_split_edge(struct ir_fun *fun, ir_label from, ir_label to, struct abc_pool *pool) {
+    ir_label mid = ir_cfg_new_block(fun, pool);
+    ir_cfg_set_tail(fun, mid, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = to});
+
+    struct ir_tail tail = ir_fun_block(fun, from)->tail;
+    switch (tail.tag) {
+        case IR_TAIL_GOTO:
+            tail.val.go_to.label = mid;
+            break;
+        case IR_TAIL_IF:
+            if (tail.val.if_then_else.then_label == to) {
+                tail.val.if_then_else.then_label = mid;
+            }
+            if (tail.val.if_then_else.else_label == to) {
+                tail.val.if_then_else.else_label = mid;
+            }
+            break;
+        case IR_TAIL_RET:
+            assert(0);
+    }
+    ir_cfg_set_tail(fun, from, tail);
+    return mid;
+}
+
+// pending block of the depth first search in ir_cfg_compute_rpo
+struct dfs_frame {
+    ir_label block;
+    size_t next; // successors left to visit, they are visited last to first
+};
+
+void ir_cfg_compute_rpo(struct ir_fun *fun, struct abc_pool *pool) {
+    for (size_t i = 0; i < fun->blocks.len; i++) {
+        ((struct ir_block *) fun->blocks.data)[i].rpo = IR_RPO_NONE;
+    }
+
+    // Depth first search collecting the postorder in fun->rpo, the rpo field marks visited blocks until the order is
+    // reversed. Visiting the successors last to first puts the then branch before the else branch.
+    fun->rpo.len = 0;
+    struct abc_arr stack;
+    abc_arr_init(&stack, sizeof(struct dfs_frame), pool);
+    struct dfs_frame root = {.block = fun->entry, .next = ir_fun_block(fun, fun->entry)->succs.len};
+    ir_fun_block(fun, fun->entry)->rpo = 0;
+    abc_arr_push(&stack, &root);
+    while (stack.len > 0) {
+        struct dfs_frame *frame = (struct dfs_frame *) stack.data + stack.len - 1;
+        struct ir_block *block = ir_fun_block(fun, frame->block);
+        if (frame->next == 0) {
+            abc_arr_push(&fun->rpo, &frame->block);
+            stack.len--;
+            continue;
+        }
+        ir_label succ = ((ir_label *) block->succs.data)[--frame->next];
+        struct ir_block *succ_block = ir_fun_block(fun, succ);
+        if (succ == fun->exit || succ_block->rpo != IR_RPO_NONE) {
+            continue;
+        }
+        succ_block->rpo = 0;
+        struct dfs_frame child = {.block = succ, .next = succ_block->succs.len};
+        abc_arr_push(&stack, &child);
+    }
+
+    ir_label *order = fun->rpo.data;
+    for (size_t i = 0; i < fun->rpo.len / 2; i++) {
+        ir_label tmp = order[i];
+        order[i] = order[fun->rpo.len - 1 - i];
+        order[fun->rpo.len - 1 - i] = tmp;
+    }
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_fun_block(fun, order[i])->rpo = (uint32_t) i;
+    }
+}
+
+void ir_cfg_remove_unreachable(struct ir_fun *fun) {
+    for (ir_label label = 0; label < fun->blocks.len; label++) {
+        struct ir_block *block = ir_fun_block(fun, label);
+        if (block->rpo != IR_RPO_NONE || label == fun->exit) {
+            continue;
+        }
+        for (size_t i = 0; i < block->succs.len; i++) {
+            ir_cfg_remove_phi_args(fun, ((ir_label *) block->succs.data)[i], label);
+        }
+        ir_cfg_clear_tail(fun, label);
+        block->phis.len = 0;
+        block->stmts.len = 0;
+    }
+}
+
+void ir_cfg_remove_phi_args(struct ir_fun *fun, ir_label block, ir_label pred) {
+    struct ir_block *b = ir_fun_block(fun, block);
+    for (size_t i = 0; i < b->phis.len; i++) {
+        struct abc_arr *args = &((struct ir_phi *) b->phis.data)[i].args;
+        struct ir_phi_arg *data = args->data;
+        for (size_t j = 0; j < args->len; j++) {
+            if (data[j].pred == pred) {
+                data[j] = data[--args->len];
+                break;
+            }
+        }
+    }
+}
+
+bool ir_cfg_fold_branch(struct ir_fun *fun, ir_label block) {
+    struct ir_block *b = ir_fun_block(fun, block);
+    if (b->tail.tag != IR_TAIL_IF || b->tail.val.if_then_else.atom.tag != IR_ATOM_INT_LIT) {
+        return false;
+    }
+    struct ir_tail_if cond = b->tail.val.if_then_else;
+    ir_label taken = cond.atom.val.int_lit ? cond.then_label : cond.else_label;
+    ir_label dropped = cond.atom.val.int_lit ? cond.else_label : cond.then_label;
+    if (dropped != taken) {
+        ir_cfg_remove_phi_args(fun, dropped, block);
+    }
+    ir_cfg_set_tail(fun, block, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = taken});
+    return true;
+}
+
+// the phis of block get the argument they have for the edge from old_pred for the edge from new_pred too
+static void copy_phi_args(struct ir_fun *fun, ir_label block, ir_label old_pred, ir_label new_pred) {
+    struct ir_block *b = ir_fun_block(fun, block);
+    for (size_t i = 0; i < b->phis.len; i++) {
+        struct abc_arr *args = &((struct ir_phi *) b->phis.data)[i].args;
+        for (size_t j = 0; j < args->len; j++) {
+            struct ir_phi_arg arg = ((struct ir_phi_arg *) args->data)[j];
+            if (arg.pred == old_pred) {
+                arg.pred = new_pred;
+                abc_arr_push(args, &arg);
+                break;
+            }
+        }
+    }
+}
+
+// an empty block that only jumps on
+static bool is_forwarder(struct ir_fun *fun, ir_label label) {
+    struct ir_block *block = ir_fun_block(fun, label);
+    return block->has_tail && block->tail.tag == IR_TAIL_GOTO && block->tail.val.go_to.label != label &&
+           block->phis.len == 0 && block->stmts.len == 0;
+}
+
+/*
+ * Where the jump from block to target can go instead, past the empty blocks that only jump on. The phis at the new
+ * target get an argument for block. A target with phis that block already jumps to is not skipped to, as its phis
+ * could not tell the two edges apart.
+ */
+static ir_label thread_jump(struct ir_fun *fun, ir_label block, ir_label target) {
+    // a cycle of empty blocks never ends, the number of steps is bounded to not go around it forever
+    for (size_t steps = 0; steps < fun->blocks.len && is_forwarder(fun, target); steps++) {
+        ir_label next = ir_fun_block(fun, target)->tail.val.go_to.label;
+        if (ir_fun_block(fun, next)->phis.len > 0) {
+            if (contains(&ir_fun_block(fun, block)->succs, next)) {
+                break;
+            }
+            copy_phi_args(fun, next, target, block);
+        }
+        target = next;
+    }
+    return target;
+}
+
+static bool thread_jumps(struct ir_fun *fun, ir_label label) {
+    struct ir_tail tail = ir_fun_block(fun, label)->tail;
+    bool changed = false;
+    switch (tail.tag) {
+        case IR_TAIL_GOTO: {
+            ir_label target = thread_jump(fun, label, tail.val.go_to.label);
+            changed = target != tail.val.go_to.label;
+            tail.val.go_to.label = target;
+            break;
+        }
+        case IR_TAIL_IF: {
+            // the tail is set after each edge, so the second one sees where the first one goes now
+            ir_label then_label = thread_jump(fun, label, tail.val.if_then_else.then_label);
+            if (then_label != tail.val.if_then_else.then_label) {
+                tail.val.if_then_else.then_label = then_label;
+                ir_cfg_set_tail(fun, label, tail);
+                changed = true;
+            }
+            ir_label else_label = thread_jump(fun, label, tail.val.if_then_else.else_label);
+            if (else_label != tail.val.if_then_else.else_label) {
+                tail.val.if_then_else.else_label = else_label;
+                changed = true;
+            }
+            if (tail.val.if_then_else.then_label == tail.val.if_then_else.else_label) {
+                tail = (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = tail.val.if_then_else.then_label};
+                changed = true;
+            }
+            break;
+        }
+        case IR_TAIL_RET:
+            break;
+    }
+    if (changed) {
+        ir_cfg_set_tail(fun, label, tail);
+    }
+    return changed;
+}
+
+/*
+ * Append the block that label jumps to when label is its only predecessor. Its phis then have a single argument and
+ * become copies.
+ */
+static bool merge_successor(struct ir_fun *fun, ir_label label) {
+    struct ir_block *block = ir_fun_block(fun, label);
+    if (block->tail.tag != IR_TAIL_GOTO) {
+        return false;
+    }
+    ir_label succ = block->tail.val.go_to.label;
+    struct ir_block *succ_block = ir_fun_block(fun, succ);
+    if (succ == label || succ == fun->exit || succ == fun->entry || succ_block->preds.len != 1) {
+        return false;
+    }
+
+    for (size_t i = 0; i < succ_block->phis.len; i++) {
+        struct ir_phi *phi = (struct ir_phi *) succ_block->phis.data + i;
+        assert(phi->args.len == 1);
+        struct ir_stmt copy = {.tag = IR_STMT_DECL};
+        copy.val.decl = (struct ir_stmt_decl) {.var = phi->var, .type = phi->type, .has_init = true};
+        copy.val.decl.init = (struct ir_expr) {.tag = IR_EXPR_ATOM, .type = phi->type};
+        copy.val.decl.init.val.atom.atom = ((struct ir_phi_arg *) phi->args.data)[0].atom;
+        abc_arr_push(&block->stmts, &copy);
+    }
+    for (size_t i = 0; i < succ_block->stmts.len; i++) {
+        abc_arr_push(&block->stmts, (struct ir_stmt *) succ_block->stmts.data + i);
+    }
+
+    // the edges out of succ now leave from label
+    struct ir_tail tail = succ_block->tail;
+    for (size_t i = 0; i < succ_block->succs.len; i++) {
+        struct ir_block *next = ir_fun_block(fun, ((ir_label *) succ_block->succs.data)[i]);
+        for (size_t j = 0; j < next->phis.len; j++) {
+            struct abc_arr *args = &((struct ir_phi *) next->phis.data)[j].args;
+            for (size_t k = 0; k < args->len; k++) {
+                struct ir_phi_arg *arg = (struct ir_phi_arg *) args->data + k;
+                if (arg->pred == succ) {
+                    arg->pred = label;
+                }
+            }
+        }
+    }
+    ir_cfg_clear_tail(fun, succ);
+    succ_block->phis.len = 0;
+    succ_block->stmts.len = 0;
+    ir_cfg_set_tail(fun, label, tail);
+    return true;
+}
+
+void ir_cfg_simplify(struct ir_fun *fun, struct abc_pool *pool) {
+    ir_cfg_compute_rpo(fun, pool);
+    ir_cfg_remove_unreachable(fun);
+
+    // A predecessor comes before its block in the rpo unless the edge closes a loop, so a block is merged into its
+    // predecessor before it is visited itself, and then has no tail anymore.
+    bool changed = false;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        if (!ir_fun_block(fun, label)->has_tail) {
+            continue;
+        }
+        changed |= thread_jumps(fun, label);
+        while (merge_successor(fun, label)) {
+            thread_jumps(fun, label);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        ir_cfg_compute_rpo(fun, pool);
+        ir_cfg_remove_unreachable(fun);
+    }
+}
+
+static ir_label intersect(struct ir_fun *fun, ir_label a, ir_label b) {
+    while (a != b) {
+        while (ir_fun_block(fun, a)->rpo > ir_fun_block(fun, b)->rpo) {
+            a = ir_fun_block(fun, a)->idom;
+        }
+        while (ir_fun_block(fun, b)->rpo > ir_fun_block(fun, a)->rpo) {
+            b = ir_fun_block(fun, b)->idom;
+        }
+    }
+    return a;
+}
+
+/*
+ * Cooper, Harvey and Kennedy's iterative algorithm: the immediate dominator of a block is the common dominator of its
+ * processed predecessors, found by walking both up the tree until they meet. Visiting in reverse postorder makes it
+ * converge in a couple of passes.
+ */
+void ir_cfg_compute_dominators(struct ir_fun *fun) {
+    for (size_t i = 0; i < fun->blocks.len; i++) {
+        struct ir_block *block = (struct ir_block *) fun->blocks.data + i;
+        block->idom = IR_LABEL_NONE;
+        block->dom_child = IR_LABEL_NONE;
+        block->dom_sibling = IR_LABEL_NONE;
+    }
+
+    ir_label *rpo = fun->rpo.data;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < fun->rpo.len; i++) {
+            struct ir_block *block = ir_fun_block(fun, rpo[i]);
+            ir_label idom = IR_LABEL_NONE;
+            for (size_t j = 0; j < block->preds.len; j++) {
+                ir_label pred = ((ir_label *) block->preds.data)[j];
+                struct ir_block *pred_block = ir_fun_block(fun, pred);
+                if (pred_block->rpo == IR_RPO_NONE || (pred != fun->entry && pred_block->idom == IR_LABEL_NONE)) {
+                    continue; // unreachable or not processed yet
+                }
+                idom = idom == IR_LABEL_NONE ? pred : intersect(fun, pred, idom);
+            }
+            if (block->idom != idom) {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+
+    // children are prepended, so walking backwards leaves them in reverse postorder
+    for (size_t i = fun->rpo.len; i-- > 1;) {
+        struct ir_block *block = ir_fun_block(fun, rpo[i]);
+        struct ir_block *parent = ir_fun_block(fun, block->idom);
+        block->dom_sibling = parent->dom_child;
+        parent->dom_child = rpo[i];
+    }
+}
+
+bool ir_cfg_dominates(const struct ir_fun *fun, ir_label a, ir_label b) {
+    const struct ir_block *block_a = ir_fun_block(fun, a);
+    while (b != IR_LABEL_NONE && ir_fun_block(fun, b)->rpo > block_a->rpo) {
+        b = ir_fun_block(fun, b)->idom;
+    }
+    return b == a;
+}
+
+struct abc_arr *ir_cfg_compute_frontiers(struct ir_fun *fun, struct abc_pool *pool) {
+    struct abc_arr *frontiers = abc_pool_alloc(pool, sizeof(struct abc_arr), fun->blocks.len);
+    for (size_t i = 0; i < fun->blocks.len; i++) {
+        abc_arr_init_cap(&frontiers[i], sizeof(ir_label), 1, pool);
+    }
+
+    // a join point is in the frontier of every block from its predecessors up to, but not including, its idom
+    ir_label *rpo = fun->rpo.data;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        struct ir_block *block = ir_fun_block(fun, rpo[i]);
+        if (block->preds.len < 2) {
+            continue;
+        }
+        for (size_t j = 0; j < block->preds.len; j++) {
+            ir_label runner = ((ir_label *) block->preds.data)[j];
+            if (ir_fun_block(fun, runner)->rpo == IR_RPO_NONE) {
+                continue;
+            }
+            while (runner != block->idom) {
+                struct abc_arr *frontier = &frontiers[runner];
+                // the block is added for all its predecessors in a row, so a duplicate can only be the last one
+                if (frontier->len == 0 || ((ir_label *) frontier->data)[frontier->len - 1] != rpo[i]) {
+                    abc_arr_push(frontier, &rpo[i]);
+                }
+                runner = ir_fun_block(fun, runner)->idom;
+            }
+        }
+    }
+    return frontiers;
+}
+
+struct abc_arr ir_cfg_loop_headers(struct ir_fun *fun, struct abc_pool *pool) {
+    struct abc_arr headers;
+    abc_arr_init(&headers, sizeof(ir_label), pool);
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (size_t j = 0; j < block->preds.len; j++) {
+            if (ir_cfg_dominates(fun, label, ((ir_label *) block->preds.data)[j])) {
+                abc_arr_push(&headers, &label);
+                break;
+            }
+        }
+    }
+    return headers;
+}
+
+bool *ir_cfg_loop_blocks(struct ir_fun *fun, ir_label header, struct abc_pool *pool) {
+    // one more for the preheader that might be added
+    bool *in_loop = abc_pool_alloc(pool, sizeof(bool), fun->blocks.len + 1);
+    for (size_t i = 0; i < fun->blocks.len + 1; i++) {
+        in_loop[i] = false;
+    }
+    in_loop[header] = true;
+
+    struct abc_arr work;
+    abc_arr_init(&work, sizeof(ir_label), pool);
+    struct ir_block *block = ir_fun_block(fun, header);
+    for (size_t i = 0; i < block->preds.len; i++) {
+        ir_label pred = ((ir_label *) block->preds.data)[i];
+        if (ir_cfg_dominates(fun, header, pred) && !in_loop[pred]) {
+            in_loop[pred] = true;
+            abc_arr_push(&work, &pred);
+        }
+    }
+    while (work.len > 0) {
+        block = ir_fun_block(fun, ((ir_label *) work.data)[--work.len]);
+        for (size_t i = 0; i < block->preds.len; i++) {
+            ir_label pred = ((ir_label *) block->preds.data)[i];
+            if (!in_loop[pred]) {
+                in_loop[pred] = true;
+                abc_arr_push(&work, &pred);
+            }
+        }
+    }
+    return in_loop;
+}
+
+static bool atom_eq(struct ir_atom a, struct ir_atom b) {
+    if (a.tag != b.tag) {
+        return false;
+    }
+    return a.tag == IR_ATOM_INT_LIT ? a.val.int_lit == b.val.int_lit : a.val.var == b.val.var;
+}
+
+ir_label ir_cfg_make_preheader(struct ir_fun *fun, ir_label header, const bool *in_loop, struct abc_pool *pool) {
+    assert(fun->ssa);
+    struct abc_arr outside;
+    abc_arr_init(&outside, sizeof(ir_label), pool);
+    struct ir_block *block = ir_fun_block(fun, header);
+    for (size_t i = 0; i < block->preds.len; i++) {
+        ir_label pred = ((ir_label *) block->preds.data)[i];
+        if (!in_loop[pred]) {
+            abc_arr_push(&outside, &pred);
+        }
+    }
+    if (outside.len == 0) {
+        return IR_LABEL_NONE;
+    }
+    if (outside.len == 1 && ir_fun_block(fun, *(ir_label *) outside.data)->tail.tag == IR_TAIL_GOTO) {
+        return *(ir_label *) outside.data;
+    }
+
+    ir_label preheader = ir_cfg_new_block(fun, pool);
+    block = ir_fun_block(fun, header);
+    for (size_t i = 0; i < block->phis.len; i++) {
+        struct ir_phi *phi = (struct ir_phi *) block->phis.data + i;
+        struct ir_phi outer = {.type = phi->type};
+        abc_arr_init(&outer.args, sizeof(struct ir_phi_arg), pool);
+        size_t kept = 0;
+        bool same = true;
+        for (size_t j = 0; j < phi->args.len; j++) {
+            struct ir_phi_arg arg = ((struct ir_phi_arg *) phi->args.data)[j];
+            if (in_loop[arg.pred]) {
+                ((struct ir_phi_arg *) phi->args.data)[kept++] = arg;
+                continue;
+            }
+            if (outer.args.len > 0 && !atom_eq(arg.atom, ((struct ir_phi_arg *) outer.args.data)[0].atom)) {
+                same = false;
+            }
+            abc_arr_push(&outer.args, &arg);
+        }
+        phi->args.len = kept;
+
+        struct ir_phi_arg entry = {.pred = preheader, .atom = ((struct ir_phi_arg *) outer.args.data)[0].atom};
+        if (!same) {
+            outer.var = fun->num_vars++;
+            abc_arr_push(&ir_fun_block(fun, preheader)->phis, &outer);
+            entry.atom = (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.var = outer.var};
+        }
+        abc_arr_push(&phi->args, &entry);
+    }
+
+    ir_cfg_set_tail(fun, preheader, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = header});
+    for (size_t i = 0; i < outside.len; i++) {
+        ir_label pred = ((ir_label *) outside.data)[i];
+        struct ir_tail tail = ir_fun_block(fun, pred)->tail;
+        if (tail.tag == IR_TAIL_GOTO) {
+            tail.val.go_to.label = preheader;
+        } else {
+            assert(tail.tag == IR_TAIL_IF);
+            if (tail.val.if_then_else.then_label == header) {
+                tail.val.if_then_else.then_label = preheader;
+            }
+            if (tail.val.if_then_else.else_label == header) {
+                tail.val.if_then_else.else_label = preheader;
+            }
+        }
+        ir_cfg_set_tail(fun, pred, tail);
+    }
+    return preheader;
+}
@@ -0,0 +1,93 @@
+/**
+ * Control flow graph of an IR function.
+ *
+ * Blocks live in ir_fun.blocks indexed by their label. Edges follow from the block tails, a return is an edge to the
+ * exit block, which never holds code. Tails must be set through ir_cfg_set_tail so the successor and predecessor lists
+ * stay in sync with them.
+ */
+
+#ifndef IR_CFG_H
+#define IR_CFG_H
+
+#include "../data/abc_pool.h"
+#include "ir.h"
+
+// Append a new block without statements or tail, returning its label.
+ir_label ir_cfg_new_block(struct ir_fun *fun, struct abc_pool *pool);
+
+// Replace the tail of block, moving its outgoing edges to the targets of the new tail.
+void ir_cfg_set_tail(struct ir_fun *fun, ir_label block, struct ir_tail tail);
+
+// Drop the tail of block together with its outgoing edges.
+void ir_cfg_clear_tail(struct ir_fun *fun, ir_label block);
+
+/*
+ * Number the blocks reachable from the entry in reverse postorder into fun->rpo and ir_block.rpo. The exit block is
+ * left out, unreachable blocks get IR_RPO_NONE. Has to be redone after edges change.
+ */
+void ir_cfg_compute_rpo(struct ir_fun *fun, struct abc_pool *pool);
+
+/*
+ * Empty the blocks outside fun->rpo, except the exit, and drop their edges together with the phi arguments for them.
+ * The rpo must be up to date.
+ */
+void ir_cfg_remove_unreachable(struct ir_fun *fun);
+
+// Drop the arguments of the phis of block for the edge from pred, which is about to go away.
+void ir_cfg_remove_phi_args(struct ir_fun *fun, ir_label block, ir_label pred);
+
+/*
+ * Turn a conditional jump of block on a literal into a goto, dropping the phi arguments for the edge not taken.
+ * Returns whether it did, the rpo has to be recomputed then.
+ */
+bool ir_cfg_fold_branch(struct ir_fun *fun, ir_label block);
+
+/*
+ * Recompute the rpo and remove unreachable blocks, then let jumps to empty blocks that only jump on go to where those
+ * jump, turn conditional jumps with both targets the same into gotos and append blocks to their only predecessor when
+ * it jumps nowhere else. Works both in and out of SSA form, the rpo is up to date afterwards.
+ */
+void ir_cfg_simplify(struct ir_fun *fun, struct abc_pool *pool);
+
+/*
+ * Insert an empty block on the edge from -> to and return it. The jumps of from to to now go through it.
+ */
+ir_label ir_cfg_split_edge(struct ir_fun *fun, ir_label from, ir_label to, struct abc_pool *pool);
+
+/*
+ * Fill idom, dom_child and dom_sibling of the blocks in fun->rpo, which must be up to date.
+ */
+void ir_cfg_compute_dominators(struct ir_fun *fun);
+
+// Whether a dominates b, every block dominates itself. Needs ir_cfg_compute_dominators.
+bool ir_cfg_dominates(const struct ir_fun *fun, ir_label a, ir_label b);
+
+/*
+ * Dominance frontiers of the blocks, an array of abc_arr (ir_label) indexed by label. Blocks outside fun->rpo get an
+ * empty frontier. Needs ir_cfg_compute_dominators.
+ */
+struct abc_arr *ir_cfg_compute_frontiers(struct ir_fun *fun, struct abc_pool *pool);
+
+/*
+ * Headers of the loops in reverse postorder, the blocks that dominate one of their predecessors. An edge to a header
+ * from a block it dominates is a back edge. Needs ir_cfg_compute_dominators.
+ */
+struct abc_arr ir_cfg_loop_headers(struct ir_fun *fun, struct abc_pool *pool);
+
+/*
+ * The blocks of the loop of header, an array of flags indexed by label: the header and the blocks that reach one of
+ * its back edges without going through it. It has room for one block more, the one ir_cfg_make_preheader might add.
+ * Needs ir_cfg_compute_dominators.
+ */
+bool *ir_cfg_loop_blocks(struct ir_fun *fun, ir_label header, struct abc_pool *pool);
+
+/*
+ * Return the preheader of the loop of header, a block that only jumps to the header and that every edge into the loop
+ * from outside goes through. A single predecessor from outside ending in a goto already is one, otherwise a block is
+ * inserted. The arguments of the header phis for the edges from outside move to it, becoming a phi there when they
+ * differ. IR_LABEL_NONE when the loop is only entered by the function starting at its header. The rpo and dominators
+ * have to be recomputed when a block was added. The function must be in SSA form.
+ */
+ir_label ir_cfg_make_preheader(struct ir_fun *fun, ir_label header, const bool *in_loop, struct abc_pool *pool);
+
+#endif // IR_CFG_H
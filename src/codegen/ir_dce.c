@@ -0,0 +1,147 @@
+/**
+ * Mark and sweep over the SSA graph: the statements with an effect and the block tails are live, and so is the
+ * definition of every variable something live reads. In SSA form each variable has a single definition, so following
+ * the reads is a worklist over variables.
+ */
+
+#include "ir_dce.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "ir_cfg.h"
+
+enum def_tag { DEF_NONE, DEF_PHI, DEF_STMT };
+
+// where a variable is defined, parameters have none
+struct def {
+    enum def_tag tag;
+    ir_label block;
+    uint32_t index; // of the phi or statement
+};
+
+struct dce {
+    struct ir_fun *fun;
+    struct def *defs; // by variable
+    bool *live; // by variable
+    struct abc_arr work; // ir_var, live variables whose definition still has to be marked
+};
+
+static void mark(void *ctx, struct ir_atom *atom) {
+    struct dce *d = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER && !d->live[atom->val.var]) {
+        d->live[atom->val.var] = true;
+        abc_arr_push(&d->work, &atom->val.var);
+    }
+}
+
+static void find_defs_and_roots(struct dce *d) {
+    struct ir_fun *fun = d->fun;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (uint32_t j = 0; j < block->phis.len; j++) {
+            d->defs[((struct ir_phi *) block->phis.data)[j].var] = (struct def) {DEF_PHI, label, j};
+        }
+        for (uint32_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + j;
+            switch (stmt->tag) {
+                case IR_STMT_DECL:
+                    assert(stmt->val.decl.has_init);
+                    d->defs[stmt->val.decl.var] = (struct def) {DEF_STMT, label, j};
+                    if (ir_expr_has_effect(&stmt->val.decl.init)) {
+                        ir_expr_each_atom(&stmt->val.decl.init, mark, d);
+                    }
+                    break;
+                case IR_STMT_EXPR:
+                    if (ir_expr_has_effect(&stmt->val.expr.expr)) {
+                        ir_expr_each_atom(&stmt->val.expr.expr, mark, d);
+                    }
+                    break;
+                case IR_STMT_PRINT:
+                    mark(d, &stmt->val.print.atom);
+                    break;
+            }
+        }
+        ir_tail_each_atom(&block->tail, mark, d);
+    }
+}
+
+static void mark_defs(struct dce *d) {
+    while (d->work.len > 0) {
+        ir_var var = ((ir_var *) d->work.data)[--d->work.len];
+        struct def def = d->defs[var];
+        if (def.tag == DEF_NONE) {
+            continue;
+        }
+        struct ir_block *block = ir_fun_block(d->fun, def.block);
+        if (def.tag == DEF_PHI) {
+            struct abc_arr *args = &((struct ir_phi *) block->phis.data)[def.index].args;
+            for (size_t i = 0; i < args->len; i++) {
+                mark(d, &((struct ir_phi_arg *) args->data)[i].atom);
+            }
+        } else {
+            ir_expr_each_atom(&((struct ir_stmt *) block->stmts.data)[def.index].val.decl.init, mark, d);
+        }
+    }
+}
+
+static void sweep_block(struct dce *d, struct ir_block *block) {
+    size_t kept = 0;
+    struct ir_phi *phis = block->phis.data;
+    for (size_t i = 0; i < block->phis.len; i++) {
+        if (d->live[phis[i].var]) {
+            phis[kept++] = phis[i];
+        }
+    }
+    block->phis.len = kept;
+
+    kept = 0;
+    struct ir_stmt *stmts = block->stmts.data;
+    for (size_t i = 0; i < block->stmts.len; i++) {
+        struct ir_stmt stmt = stmts[i];
+        if (stmt.tag == IR_STMT_DECL && !d->live[stmt.val.decl.var]) {
+            if (!ir_expr_has_effect(&stmt.val.decl.init)) {
+                continue;
+            }
+            // the value goes unused, the effect stays
+            struct ir_expr init = stmt.val.decl.init;
+            stmt.tag = IR_STMT_EXPR;
+            stmt.val.expr.expr = init;
+        }
+        if (stmt.tag == IR_STMT_EXPR && !ir_expr_has_effect(&stmt.val.expr.expr)) {
+            continue;
+        }
+        stmts[kept++] = stmt;
+    }
+    block->stmts.len = kept;
+}
+
+static void dce_fun(struct ir_fun *fun) {
+    assert(fun->ssa);
+    struct abc_pool *scratch = abc_pool_create();
+    struct dce d = {.fun = fun};
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    d.defs = abc_pool_alloc(scratch, sizeof(struct def), num_vars);
+    d.live = abc_pool_alloc(scratch, sizeof(bool), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        d.defs[var] = (struct def) {.tag = DEF_NONE};
+        d.live[var] = false;
+    }
+    abc_arr_init(&d.work, sizeof(ir_var), scratch);
+
+    find_defs_and_roots(&d);
+    mark_defs(&d);
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        sweep_block(&d, ir_fun_block(fun, ((ir_label *) fun->rpo.data)[i]));
+    }
+    // blocks left empty are jumped past
+    ir_cfg_simplify(fun, scratch);
+    abc_pool_destroy(scratch);
+}
+
+void ir_dce_program(struct ir_program *program) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        dce_fun((struct ir_fun *) program->ir_funs.data + i);
+    }
+}
@@ -0,0 +1,17 @@
+/**
+ * Dead code elimination on SSA form.
+ */
+
+#ifndef IR_DCE_H
+#define IR_DCE_H
+
+#include "ir.h"
+
+/*
+ * Remove the phis, decls and expression statements whose value is never needed. Prints, calls, divisions that can
+ * trap and the values read by block tails are needed, as is everything they read. A call whose value is not needed
+ * stays as an expression statement. The functions must be in SSA form.
+ */
+void ir_dce_program(struct ir_program *program);
+
+#endif // IR_DCE_H
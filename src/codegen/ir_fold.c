@@ -0,0 +1,283 @@
+/**
+ * Constant folding in one pass over the blocks in reverse postorder. A variable defined once is defined before all of
+ * its uses in that order, both in SSA form and for the temporaries and scoped declarations of the translation, so its
+ * value is known by the time it is read.
+ */
+
+#include "ir_fold.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ir_cfg.h"
+
+/* EVALUATION */
+
+bool ir_fold_bin(enum ir_bin_op op, long lhs, long rhs, long *res) {
+    switch (op) {
+        case IR_BIN_PLUS:
+            *res = (long) ((unsigned long) lhs + (unsigned long) rhs);
+            return true;
+        case IR_BIN_MINUS:
+            *res = (long) ((unsigned long) lhs - (unsigned long) rhs);
+            return true;
+        case IR_BIN_MUL:
+            *res = (long) ((unsigned long) lhs * (unsigned long) rhs);
+            return true;
+        case IR_BIN_DIV:
+            if (rhs == 0 || (lhs == LONG_MIN && rhs == -1)) {
+                return false;
+            }
+            *res = lhs / rhs;
+            return true;
+    }
+    assert(0);
+    abort();
+}
+
+long ir_fold_unary(enum ir_unary_op op, long val) {
+    switch (op) {
+        case IR_UNARY_MINUS:
+            return (long) (0UL - (unsigned long) val);
+        case IR_UNARY_BANG:
+            return val ^ 1;
+    }
+    assert(0);
+    abort();
+}
+
+long ir_fold_cmp(enum ir_cmp cmp, long lhs, long rhs) {
+    switch (cmp) {
+        case IR_CMP_EQ:
+            return lhs == rhs;
+        case IR_CMP_NE:
+            return lhs != rhs;
+        case IR_CMP_LT:
+            return lhs < rhs;
+        case IR_CMP_GT:
+            return lhs > rhs;
+        case IR_CMP_LE:
+            return lhs <= rhs;
+        case IR_CMP_GE:
+            return lhs >= rhs;
+    }
+    assert(0);
+    abort();
+}
+
+static bool is_lit(struct ir_atom atom, long val) { return atom.tag == IR_ATOM_INT_LIT && atom.val.int_lit == val; }
+
+static void set_atom(struct ir_expr *expr, struct ir_atom atom) {
+    expr->tag = IR_EXPR_ATOM;
+    expr->val.atom.atom = atom;
+}
+
+static void set_lit(struct ir_expr *expr, long val) {
+    set_atom(expr, (struct ir_atom) {.tag = IR_ATOM_INT_LIT, .val.int_lit = val});
+}
+
+// x + 0, 0 + x, x - 0, x * 1, 1 * x and x / 1 are x, x * 0 and 0 * x are 0
+static bool fold_identity(struct ir_expr *expr) {
+    struct ir_expr_bin bin = expr->val.bin;
+    switch (bin.op) {
+        case IR_BIN_PLUS:
+            if (is_lit(bin.lhs, 0) || is_lit(bin.rhs, 0)) {
+                set_atom(expr, is_lit(bin.lhs, 0) ? bin.rhs : bin.lhs);
+                return true;
+            }
+            return false;
+        case IR_BIN_MINUS:
+            if (is_lit(bin.rhs, 0)) {
+                set_atom(expr, bin.lhs);
+                return true;
+            }
+            return false;
+        case IR_BIN_MUL:
+            if (is_lit(bin.lhs, 0) || is_lit(bin.rhs, 0)) {
+                set_lit(expr, 0);
+                return true;
+            }
+            if (is_lit(bin.lhs, 1) || is_lit(bin.rhs, 1)) {
+                set_atom(expr, is_lit(bin.lhs, 1) ? bin.rhs : bin.lhs);
+                return true;
+            }
+            return false;
+        case IR_BIN_DIV:
+            if (is_lit(bin.rhs, 1)) {
+                set_atom(expr, bin.lhs);
+                return true;
+            }
+            return false;
+    }
+    assert(0);
+    abort();
+}
+
+bool ir_fold_expr(struct ir_expr *expr) {
+    expr = ir_expr_value(expr);
+    long res;
+    switch (expr->tag) {
+        case IR_EXPR_BIN:
+            if (expr->val.bin.lhs.tag == IR_ATOM_INT_LIT && expr->val.bin.rhs.tag == IR_ATOM_INT_LIT) {
+                if (!ir_fold_bin(expr->val.bin.op, expr->val.bin.lhs.val.int_lit, expr->val.bin.rhs.val.int_lit,
+                                 &res)) {
+                    return false;
+                }
+                set_lit(expr, res);
+                return true;
+            }
+            return fold_identity(expr);
+        case IR_EXPR_UNARY:
+            if (expr->val.unary.atom.tag != IR_ATOM_INT_LIT) {
+                return false;
+            }
+            set_lit(expr, ir_fold_unary(expr->val.unary.op, expr->val.unary.atom.val.int_lit));
+            return true;
+        case IR_EXPR_CMP:
+            if (expr->val.cmp.lhs.tag != IR_ATOM_INT_LIT || expr->val.cmp.rhs.tag != IR_ATOM_INT_LIT) {
+                return false;
+            }
+            res = ir_fold_cmp(expr->val.cmp.cmp, expr->val.cmp.lhs.val.int_lit, expr->val.cmp.rhs.val.int_lit);
+            set_lit(expr, res);
+            return true;
+        case IR_EXPR_ATOM:
+        case IR_EXPR_CALL:
+            return false;
+        case IR_EXPR_ASSIGN:
+            assert(0);
+    }
+    assert(0);
+    abort();
+}
+
+/* PROPAGATION */
+
+struct folder {
+    struct ir_fun *fun;
+    uint32_t *defs; // by variable, number of definitions
+    bool *known; // by variable, whether its value is the literal in value
+    long *value; // by variable
+};
+
+// Only literals x64 can take as an immediate operand are propagated, larger ones stay in their variable.
+static bool fits_imm(long val) { return val >= INT32_MIN && val <= INT32_MAX; }
+
+static void count_def(struct folder *f, ir_var var) { f->defs[var]++; }
+
+static void count_defs(struct folder *f) {
+    struct ir_fun *fun = f->fun;
+    for (size_t i = 0; i < fun->args.len; i++) {
+        count_def(f, ((struct ir_param *) fun->args.data)[i].var);
+    }
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        struct ir_block *block = ir_fun_block(fun, ((ir_label *) fun->rpo.data)[i]);
+        for (size_t j = 0; j < block->phis.len; j++) {
+            count_def(f, ((struct ir_phi *) block->phis.data)[j].var);
+        }
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + j;
+            struct ir_expr *expr = NULL;
+            if (stmt->tag == IR_STMT_DECL) {
+                count_def(f, stmt->val.decl.var);
+                expr = stmt->val.decl.has_init ? &stmt->val.decl.init : NULL;
+            } else if (stmt->tag == IR_STMT_EXPR) {
+                expr = &stmt->val.expr.expr;
+            }
+            for (; expr != NULL && expr->tag == IR_EXPR_ASSIGN; expr = expr->val.assign.value) {
+                count_def(f, expr->val.assign.var);
+            }
+        }
+    }
+}
+
+static void propagate(void *ctx, struct ir_atom *atom) {
+    struct folder *f = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER && f->known[atom->val.var]) {
+        *atom = (struct ir_atom) {.tag = IR_ATOM_INT_LIT, .val.int_lit = f->value[atom->val.var]};
+    }
+}
+
+static void propagate_phis(struct folder *f, struct ir_block *block) {
+    for (size_t i = 0; i < block->phis.len; i++) {
+        struct abc_arr *args = &((struct ir_phi *) block->phis.data)[i].args;
+        for (size_t j = 0; j < args->len; j++) {
+            propagate(f, &((struct ir_phi_arg *) args->data)[j].atom);
+        }
+    }
+}
+
+static void fold_stmt(struct folder *f, struct ir_stmt *stmt) {
+    struct ir_expr *init = &stmt->val.decl.init;
+    switch (stmt->tag) {
+        case IR_STMT_DECL:
+            if (!stmt->val.decl.has_init) {
+                break;
+            }
+            ir_expr_each_atom(init, propagate, f);
+            ir_fold_expr(init);
+            if (f->defs[stmt->val.decl.var] == 1 && init->tag == IR_EXPR_ATOM &&
+                init->val.atom.atom.tag == IR_ATOM_INT_LIT && fits_imm(init->val.atom.atom.val.int_lit)) {
+                f->known[stmt->val.decl.var] = true;
+                f->value[stmt->val.decl.var] = init->val.atom.atom.val.int_lit;
+            }
+            break;
+        case IR_STMT_EXPR:
+            ir_expr_each_atom(&stmt->val.expr.expr, propagate, f);
+            ir_fold_expr(&stmt->val.expr.expr);
+            break;
+        case IR_STMT_PRINT:
+            propagate(f, &stmt->val.print.atom);
+            break;
+    }
+}
+
+// Turn a conditional jump on a literal into a goto, returns whether it did.
+static bool fold_tail(struct folder *f, ir_label label) {
+    struct ir_block *block = ir_fun_block(f->fun, label);
+    ir_tail_each_atom(&block->tail, propagate, f);
+    return ir_cfg_fold_branch(f->fun, label);
+}
+
+static void fold_fun(struct ir_fun *fun) {
+    struct abc_pool *scratch = abc_pool_create();
+    struct folder f = {.fun = fun};
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    f.defs = abc_pool_alloc(scratch, sizeof(uint32_t), num_vars);
+    f.known = abc_pool_alloc(scratch, sizeof(bool), num_vars);
+    f.value = abc_pool_alloc(scratch, sizeof(long), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        f.defs[var] = 0;
+        f.known[var] = false;
+    }
+    count_defs(&f);
+
+    bool cfg_changed = false;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_block *block = ir_fun_block(fun, label);
+        propagate_phis(&f, block);
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            fold_stmt(&f, (struct ir_stmt *) block->stmts.data + j);
+        }
+        if (fold_tail(&f, label)) {
+            cfg_changed = true;
+        }
+    }
+    // arguments coming in over back edges were defined after the phis were visited
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        propagate_phis(&f, ir_fun_block(fun, ((ir_label *) fun->rpo.data)[i]));
+    }
+
+    if (cfg_changed) {
+        ir_cfg_simplify(fun, scratch);
+    }
+    abc_pool_destroy(scratch);
+}
+
+void ir_fold_program(struct ir_program *program) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        fold_fun((struct ir_fun *) program->ir_funs.data + i);
+    }
+}
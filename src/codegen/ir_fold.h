@@ -0,0 +1,34 @@
+/**
+ * Constant folding and propagation on the IR.
+ *
+ * Operations on literals are evaluated at compile time, wrapping around at 64 bits like the generated code does.
+ * Divisions that trap, by zero or of the smallest value by -1, are left for run time.
+ */
+
+#ifndef IR_FOLD_H
+#define IR_FOLD_H
+
+#include "ir.h"
+
+// Value of lhs op rhs, false if it has to trap at run time instead.
+bool ir_fold_bin(enum ir_bin_op op, long lhs, long rhs, long *res);
+
+long ir_fold_unary(enum ir_unary_op op, long val);
+
+// Value of the comparison, 1 or 0 like a bool.
+long ir_fold_cmp(enum ir_cmp cmp, long lhs, long rhs);
+
+/*
+ * Replace an operation on literals, or one that does not change its operand like x + 0, by the atom it evaluates to.
+ * For assignments the assigned value is folded. Returns whether expr changed.
+ */
+bool ir_fold_expr(struct ir_expr *expr);
+
+/*
+ * Fold every function, propagating the value of variables defined once as a literal into their uses, and turn
+ * conditional jumps on a literal into gotos. Blocks that become unreachable are emptied. Works both in and out of
+ * SSA form.
+ */
+void ir_fold_program(struct ir_program *program);
+
+#endif // IR_FOLD_H
@@ -0,0 +1,283 @@
+/**
+ * Dominator based value numbering: the dominator tree is walked depth first with a scoped hash map from expressions to
+ * the variable holding their value, a scope is pushed for each block so a computation is only found again in the
+ * blocks it dominates. The operands of an expression are replaced by their value numbers, the dominating variable or
+ * literal with the same value, before it is looked up.
+ */
+
+#include "ir_gvn.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "../data/abc_map.h"
+#include "ir_cfg.h"
+#include "ir_fold.h"
+
+// An expression with its operands replaced by their value numbers, commutative ones in a fixed order.
+struct value_key {
+    enum ir_expr_tag tag;
+    int op; // ir_bin_op, ir_unary_op or ir_cmp
+    struct ir_atom lhs;
+    struct ir_atom rhs; // literal 0 for unary expressions
+};
+
+// the map is keyed by a hash of the value_key, the key itself tells expressions with the same hash apart
+struct value_entry {
+    struct value_key key;
+    ir_var var;
+};
+
+struct gvn {
+    struct ir_fun *fun;
+    struct ir_atom *number; // by variable, the variable itself until it is found to equal an earlier value
+    struct abc_map values; // value_entry
+};
+
+struct gvn_frame {
+    ir_label block;
+    bool done; // the block and its dominator subtree were numbered, its scope has to be popped
+};
+
+static bool atom_eq(struct ir_atom a, struct ir_atom b) {
+    if (a.tag != b.tag) {
+        return false;
+    }
+    return a.tag == IR_ATOM_INT_LIT ? a.val.int_lit == b.val.int_lit : a.val.var == b.val.var;
+}
+
+// variables before literals, each in increasing order
+static bool atom_less(struct ir_atom a, struct ir_atom b) {
+    if (a.tag != b.tag) {
+        return a.tag == IR_ATOM_IDENTIFIER;
+    }
+    return a.tag == IR_ATOM_INT_LIT ? a.val.int_lit < b.val.int_lit : a.val.var < b.val.var;
+}
+
+// only literals x64 can take as an immediate operand replace a variable
+static bool can_replace(struct ir_atom atom) {
+    return atom.tag == IR_ATOM_IDENTIFIER || (atom.val.int_lit >= INT32_MIN && atom.val.int_lit <= INT32_MAX);
+}
+
+static struct ir_atom value_number(struct gvn *g, struct ir_atom atom) {
+    while (atom.tag == IR_ATOM_IDENTIFIER && !atom_eq(g->number[atom.val.var], atom)) {
+        atom = g->number[atom.val.var];
+    }
+    return atom;
+}
+
+static void replace_by_number(void *ctx, struct ir_atom *atom) { *atom = value_number(ctx, *atom); }
+
+static bool make_key(struct ir_expr *expr, struct value_key *key) {
+    *key = (struct value_key) {.tag = expr->tag, .rhs = {.tag = IR_ATOM_INT_LIT, .val.int_lit = 0}};
+    switch (expr->tag) {
+        case IR_EXPR_BIN:
+            key->op = (int) expr->val.bin.op;
+            key->lhs = expr->val.bin.lhs;
+            key->rhs = expr->val.bin.rhs;
+            if (expr->val.bin.op != IR_BIN_PLUS && expr->val.bin.op != IR_BIN_MUL) {
+                return true;
+            }
+            break;
+        case IR_EXPR_CMP:
+            key->op = (int) expr->val.cmp.cmp;
+            key->lhs = expr->val.cmp.lhs;
+            key->rhs = expr->val.cmp.rhs;
+            // a > b is b < a
+            if (expr->val.cmp.cmp == IR_CMP_GT || expr->val.cmp.cmp == IR_CMP_GE) {
+                key->op = expr->val.cmp.cmp == IR_CMP_GT ? IR_CMP_LT : IR_CMP_LE;
+                key->lhs = expr->val.cmp.rhs;
+                key->rhs = expr->val.cmp.lhs;
+            }
+            if (expr->val.cmp.cmp != IR_CMP_EQ && expr->val.cmp.cmp != IR_CMP_NE) {
+                return true;
+            }
+            break;
+        case IR_EXPR_UNARY:
+            key->op = (int) expr->val.unary.op;
+            key->lhs = expr->val.unary.atom;
+            return true;
+        default:
+            return false;
+    }
+    if (atom_less(key->rhs, key->lhs)) {
+        struct ir_atom tmp = key->lhs;
+        key->lhs = key->rhs;
+        key->rhs = tmp;
+    }
+    return true;
+}
+
+static bool key_eq(const struct value_key *a, const struct value_key *b) {
+    return a->tag == b->tag && a->op == b->op && atom_eq(a->lhs, b->lhs) && atom_eq(a->rhs, b->rhs);
+}
+
+static uint64_t atom_bits(struct ir_atom atom) {
+    return atom.tag == IR_ATOM_INT_LIT ? (uint64_t) atom.val.int_lit : (uint64_t) atom.val.var << 32 | 1;
+}
+
+// FNV-1a over the fields, the map mixes the result again
+static uint64_t hash_key(const struct value_key *key) {
+    uint64_t fields[] = {(uint64_t) key->tag << 8 | (uint64_t) key->op, atom_bits(key->lhs), atom_bits(key->rhs)};
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        hash = (hash ^ fields[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// a phi whose arguments are all the same value, apart from the phi itself on a loop, is that value
+static void number_phi(struct gvn *g, struct ir_phi *phi) {
+    struct ir_atom self = {.tag = IR_ATOM_IDENTIFIER, .val.var = phi->var};
+    bool found = false;
+    struct ir_atom same;
+    for (size_t i = 0; i < phi->args.len; i++) {
+        struct ir_atom arg = value_number(g, ((struct ir_phi_arg *) phi->args.data)[i].atom);
+        if (atom_eq(arg, self)) {
+            continue;
+        }
+        if (found && !atom_eq(arg, same)) {
+            return;
+        }
+        found = true;
+        same = arg;
+    }
+    if (found && can_replace(same)) {
+        g->number[phi->var] = same;
+    }
+}
+
+static void number_decl(struct gvn *g, struct ir_stmt_decl *decl) {
+    assert(decl->has_init);
+    ir_expr_each_atom(&decl->init, replace_by_number, g);
+    ir_fold_expr(&decl->init);
+    if (decl->init.tag == IR_EXPR_ATOM) {
+        if (can_replace(decl->init.val.atom.atom)) {
+            g->number[decl->var] = decl->init.val.atom.atom;
+        }
+        return;
+    }
+
+    struct value_entry entry = {.var = decl->var};
+    if (!make_key(&decl->init, &entry.key)) {
+        return;
+    }
+    uint64_t hash = hash_key(&entry.key);
+    struct value_entry *earlier = abc_map_get(&g->values, hash);
+    if (earlier != NULL && key_eq(&earlier->key, &entry.key)) {
+        g->number[decl->var] = (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.var = earlier->var};
+    } else {
+        abc_map_put(&g->values, hash, &entry);
+    }
+}
+
+static void number_block(struct gvn *g, ir_label label) {
+    struct ir_block *block = ir_fun_block(g->fun, label);
+    for (size_t i = 0; i < block->phis.len; i++) {
+        number_phi(g, (struct ir_phi *) block->phis.data + i);
+    }
+    for (size_t i = 0; i < block->stmts.len; i++) {
+        struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + i;
+        if (stmt->tag == IR_STMT_DECL) {
+            number_decl(g, &stmt->val.decl);
+        }
+    }
+}
+
+static bool is_redundant(struct gvn *g, ir_var var) {
+    return g->number[var].tag != IR_ATOM_IDENTIFIER || g->number[var].val.var != var;
+}
+
+/*
+ * Drop the definitions of the redundant variables and read the value numbers everywhere. Returns whether a conditional
+ * jump became one on a literal and was turned into a goto.
+ */
+static bool rewrite_block(struct gvn *g, ir_label label) {
+    struct ir_block *block = ir_fun_block(g->fun, label);
+    size_t kept = 0;
+    struct ir_phi *phis = block->phis.data;
+    for (size_t i = 0; i < block->phis.len; i++) {
+        if (is_redundant(g, phis[i].var)) {
+            continue;
+        }
+        for (size_t j = 0; j < phis[i].args.len; j++) {
+            replace_by_number(g, &((struct ir_phi_arg *) phis[i].args.data)[j].atom);
+        }
+        phis[kept++] = phis[i];
+    }
+    block->phis.len = kept;
+
+    kept = 0;
+    struct ir_stmt *stmts = block->stmts.data;
+    for (size_t i = 0; i < block->stmts.len; i++) {
+        switch (stmts[i].tag) {
+            case IR_STMT_DECL:
+                if (is_redundant(g, stmts[i].val.decl.var)) {
+                    continue;
+                }
+                ir_expr_each_atom(&stmts[i].val.decl.init, replace_by_number, g);
+                break;
+            case IR_STMT_EXPR:
+                ir_expr_each_atom(&stmts[i].val.expr.expr, replace_by_number, g);
+                break;
+            case IR_STMT_PRINT:
+                replace_by_number(g, &stmts[i].val.print.atom);
+                break;
+        }
+        stmts[kept++] = stmts[i];
+    }
+    block->stmts.len = kept;
+    ir_tail_each_atom(&block->tail, replace_by_number, g);
+    return ir_cfg_fold_branch(g->fun, label);
+}
+
+static void gvn_fun(struct ir_fun *fun) {
+    assert(fun->ssa);
+    ir_cfg_compute_dominators(fun);
+    struct abc_pool *scratch = abc_pool_create();
+    struct gvn g = {.fun = fun};
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    g.number = abc_pool_alloc(scratch, sizeof(struct ir_atom), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        g.number[var] = (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.var = var};
+    }
+    abc_map_init(&g.values, sizeof(struct value_entry), scratch);
+
+    struct abc_arr stack;
+    abc_arr_init(&stack, sizeof(struct gvn_frame), scratch);
+    struct gvn_frame root = {.block = fun->entry, .done = false};
+    abc_arr_push(&stack, &root);
+    while (stack.len > 0) {
+        struct gvn_frame frame = ((struct gvn_frame *) stack.data)[--stack.len];
+        if (frame.done) {
+            abc_map_pop_scope(&g.values);
+            continue;
+        }
+        abc_map_push_scope(&g.values);
+        number_block(&g, frame.block);
+        frame.done = true;
+        abc_arr_push(&stack, &frame);
+        for (ir_label child = ir_fun_block(fun, frame.block)->dom_child; child != IR_LABEL_NONE;
+             child = ir_fun_block(fun, child)->dom_sibling) {
+            struct gvn_frame next = {.block = child, .done = false};
+            abc_arr_push(&stack, &next);
+        }
+    }
+
+    bool cfg_changed = false;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        if (rewrite_block(&g, ((ir_label *) fun->rpo.data)[i])) {
+            cfg_changed = true;
+        }
+    }
+    if (cfg_changed) {
+        ir_cfg_simplify(fun, scratch);
+    }
+    abc_pool_destroy(scratch);
+}
+
+void ir_gvn_program(struct ir_program *program) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        gvn_fun((struct ir_fun *) program->ir_funs.data + i);
+    }
+}
@@ -0,0 +1,22 @@
+/**
+ * Global value numbering on SSA form.
+ *
+ * A computation that the same operation on the same values already made in a dominating block is replaced by the
+ * variable holding that earlier result. As every variable is defined once, a name always stands for the same value,
+ * so a variable that is assigned again in the source is a different name here and its computations are not mixed up.
+ */
+
+#ifndef IR_GVN_H
+#define IR_GVN_H
+
+#include "ir.h"
+
+/*
+ * Replace the variables defined by redundant arithmetic, comparisons and copies by the variable or literal they
+ * equal, removing their decls, and phis whose arguments are all the same value by that value. Commutative operations
+ * match with their operands either way round, conditional jumps that end up on a literal become gotos. The functions
+ * must be in SSA form.
+ */
+void ir_gvn_program(struct ir_program *program);
+
+#endif // IR_GVN_H
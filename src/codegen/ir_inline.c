@@ -0,0 +1,305 @@
+/**
+ * Calls are inlined before SSA construction, where a variable can be assigned more than once: the parameters of the
+ * called function become decls of the arguments in front of the copy of its body, every return assigns the result
+ * variable and jumps to the block holding the rest of the caller, and SSA construction later places the phis. A
+ * function can only call itself and the functions before it, so going through the program in order the called
+ * function already has its own calls inlined and its final size.
+ */
+
+#include "ir_inline.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../data/abc_map.h"
+#include "ir_cfg.h"
+
+#define LITERAL_ARG_BONUS 2
+#define ONLY_CALL_FACTOR 4
+
+struct inliner {
+    struct ir_program *program;
+    struct abc_pool *pool;
+    struct abc_pool *scratch;
+    long threshold;
+    struct abc_map funs; // function label -> size_t index, labels are interned so the pointer identifies the function
+    uint32_t *calls; // by function index, calls to it left in the program
+    uint32_t *size; // by function index, statements and tails of its reachable blocks
+    bool *inlined; // by function index, whether a call to it was inlined
+};
+
+static struct ir_fun *fun_at(struct inliner *in, size_t index) {
+    return (struct ir_fun *) in->program->ir_funs.data + index;
+}
+
+// The index of the function stmt calls, SIZE_MAX when it does not call one.
+static size_t called(struct inliner *in, struct ir_stmt *stmt) {
+    struct ir_expr *expr = NULL;
+    switch (stmt->tag) {
+        case IR_STMT_DECL:
+            if (!stmt->val.decl.has_init) {
+                return SIZE_MAX;
+            }
+            expr = ir_expr_value(&stmt->val.decl.init);
+            break;
+        case IR_STMT_EXPR:
+            expr = ir_expr_value(&stmt->val.expr.expr);
+            break;
+        case IR_STMT_PRINT:
+            return SIZE_MAX;
+    }
+    if (expr->tag != IR_EXPR_CALL) {
+        return SIZE_MAX;
+    }
+    size_t *index = abc_map_get(&in->funs, (uint64_t) (uintptr_t) expr->val.call.label);
+    assert(index != NULL);
+    return *index;
+}
+
+static uint32_t fun_size(struct ir_fun *fun) {
+    uint32_t size = 0;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        size += ir_fun_block(fun, ((ir_label *) fun->rpo.data)[i])->stmts.len + 1;
+    }
+    return size;
+}
+
+static bool is_main(struct ir_fun *fun) {
+    return strcmp(fun->label, "main") == 0;
+}
+
+static bool should_inline(struct inliner *in, size_t callee, struct ir_expr_call *call) {
+    long cost = in->size[callee];
+    for (size_t i = 0; i < call->args.len; i++) {
+        if (((struct ir_atom *) call->args.data)[i].tag == IR_ATOM_INT_LIT) {
+            cost -= LITERAL_ARG_BONUS;
+        }
+    }
+    long limit = in->threshold;
+    if (in->calls[callee] == 1 && !is_main(fun_at(in, callee))) {
+        // the function goes away after this, so inlining does not add code
+        limit *= ONLY_CALL_FACTOR;
+    }
+    return cost <= limit;
+}
+
+static void offset_atom(void *ctx, struct ir_atom *atom) {
+    if (atom->tag == IR_ATOM_IDENTIFIER) {
+        atom->val.var += *(ir_var *) ctx;
+    }
+}
+
+// Deep copy of expr with its variables moved up by base.
+static struct ir_expr copy_expr(struct inliner *in, struct ir_expr *expr, ir_var base) {
+    struct ir_expr copy = *expr;
+    struct ir_expr *to = &copy;
+    for (; expr->tag == IR_EXPR_ASSIGN; expr = expr->val.assign.value) {
+        to->val.assign.var += base;
+        to->val.assign.value = abc_pool_alloc(in->pool, sizeof(struct ir_expr), 1);
+        *to->val.assign.value = *expr->val.assign.value;
+        to = to->val.assign.value;
+    }
+    if (to->tag == IR_EXPR_CALL) {
+        struct abc_arr args = to->val.call.args;
+        abc_arr_init_cap(&to->val.call.args, sizeof(struct ir_atom), args.len, in->pool);
+        for (size_t i = 0; i < args.len; i++) {
+            abc_arr_push(&to->val.call.args, (struct ir_atom *) args.data + i);
+        }
+    }
+    ir_expr_each_atom(&copy, offset_atom, &base);
+    return copy;
+}
+
+static struct ir_stmt copy_stmt(struct inliner *in, struct ir_stmt *stmt, ir_var base) {
+    struct ir_stmt copy = *stmt;
+    switch (stmt->tag) {
+        case IR_STMT_DECL:
+            copy.val.decl.var += base;
+            if (stmt->val.decl.has_init) {
+                copy.val.decl.init = copy_expr(in, &stmt->val.decl.init, base);
+            }
+            break;
+        case IR_STMT_EXPR:
+            copy.val.expr.expr = copy_expr(in, &stmt->val.expr.expr, base);
+            break;
+        case IR_STMT_PRINT:
+            offset_atom(&base, &copy.val.print.atom);
+            break;
+    }
+    size_t callee = called(in, &copy);
+    if (callee != SIZE_MAX) {
+        in->calls[callee]++;
+    }
+    return copy;
+}
+
+/*
+ * Inline the call of the statement at index of block. The statements from the call on move to a new block, which is
+ * returned, with the call replaced by the result variable or dropped when it was only evaluated.
+ */
+static ir_label inline_call(struct inliner *in, struct ir_fun *fun, ir_label label, size_t index, size_t callee) {
+    struct ir_fun *body = fun_at(in, callee);
+    ir_var base = fun->num_vars;
+    fun->num_vars += body->num_vars;
+    ir_var result = fun->num_vars++;
+
+    ir_label *labels = abc_pool_alloc(in->scratch, sizeof(ir_label), body->blocks.len);
+    for (size_t i = 0; i < body->rpo.len; i++) {
+        ir_label from = ((ir_label *) body->rpo.data)[i];
+        labels[from] = ir_cfg_new_block(fun, in->pool);
+    }
+    ir_label after = ir_cfg_new_block(fun, in->pool);
+
+    struct ir_block *block = ir_fun_block(fun, label);
+    struct ir_block *rest = ir_fun_block(fun, after);
+    struct ir_stmt *stmts = block->stmts.data;
+    struct ir_stmt *call_stmt = stmts + index;
+    struct ir_expr *call = ir_expr_value(call_stmt->tag == IR_STMT_DECL ? &call_stmt->val.decl.init
+                                                                         : &call_stmt->val.expr.expr);
+    struct abc_arr args = call->val.call.args;
+    bool only_evaluated = call_stmt->tag == IR_STMT_EXPR && &call_stmt->val.expr.expr == call;
+    *call = (struct ir_expr) {.tag = IR_EXPR_ATOM,
+                              .type = body->type,
+                              .val.atom.atom = {.tag = IR_ATOM_IDENTIFIER, .val.var = result}};
+    for (size_t i = only_evaluated ? index + 1 : index; i < block->stmts.len; i++) {
+        abc_arr_push(&rest->stmts, stmts + i);
+    }
+    block->stmts.len = index;
+    struct ir_tail tail = block->tail;
+    ir_cfg_set_tail(fun, label, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = labels[body->entry]});
+    ir_cfg_set_tail(fun, after, tail);
+
+    // the result is declared before the body, which assigns it at each return
+    if (body->type != ABC_TYPE_VOID) {
+        struct ir_stmt decl = {.tag = IR_STMT_DECL, .val.decl = {.var = result, .type = body->type}};
+        abc_arr_push(&block->stmts, &decl);
+    }
+    for (size_t i = 0; i < body->args.len; i++) {
+        struct ir_param param = ((struct ir_param *) body->args.data)[i];
+        struct ir_stmt decl = {.tag = IR_STMT_DECL,
+                               .val.decl = {.var = base + param.var,
+                                            .type = param.type,
+                                            .has_init = true,
+                                            .init = {.tag = IR_EXPR_ATOM,
+                                                     .type = param.type,
+                                                     .val.atom.atom = ((struct ir_atom *) args.data)[i]}}};
+        abc_arr_push(&block->stmts, &decl);
+    }
+
+    for (size_t i = 0; i < body->rpo.len; i++) {
+        struct ir_block *from = ir_fun_block(body, ((ir_label *) body->rpo.data)[i]);
+        ir_label to_label = labels[from->label];
+        struct ir_block *to = ir_fun_block(fun, to_label);
+        for (size_t j = 0; j < from->stmts.len; j++) {
+            struct ir_stmt copy = copy_stmt(in, (struct ir_stmt *) from->stmts.data + j, base);
+            abc_arr_push(&to->stmts, &copy);
+        }
+
+        tail = from->tail;
+        ir_tail_each_atom(&tail, offset_atom, &base);
+        switch (tail.tag) {
+            case IR_TAIL_GOTO:
+                tail.val.go_to.label = labels[tail.val.go_to.label];
+                break;
+            case IR_TAIL_IF:
+                tail.val.if_then_else.then_label = labels[tail.val.if_then_else.then_label];
+                tail.val.if_then_else.else_label = labels[tail.val.if_then_else.else_label];
+                break;
+            case IR_TAIL_RET:
+                if (tail.val.ret.has_atom) {
+                    struct ir_expr *value = abc_pool_alloc(in->pool, sizeof(struct ir_expr), 1);
+                    *value = (struct ir_expr) {.tag = IR_EXPR_ATOM,
+                                               .type = body->type,
+                                               .val.atom.atom = tail.val.ret.atom};
+                    struct ir_stmt assign = {.tag = IR_STMT_EXPR,
+                                             .val.expr.expr = {.tag = IR_EXPR_ASSIGN,
+                                                               .type = body->type,
+                                                               .val.assign = {.var = result, .value = value}}};
+                    abc_arr_push(&to->stmts, &assign);
+                }
+                tail = (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = after};
+                break;
+        }
+        ir_cfg_set_tail(fun, to_label, tail);
+    }
+
+    in->calls[callee]--;
+    in->inlined[callee] = true;
+    return after;
+}
+
+static void inline_fun(struct inliner *in, size_t index) {
+    struct ir_fun *fun = fun_at(in, index);
+    assert(!fun->ssa);
+    bool changed = false;
+    size_t num_reachable = fun->rpo.len;
+    for (size_t i = 0; i < num_reachable; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        size_t j = 0;
+        while (j < ir_fun_block(fun, label)->stmts.len) {
+            struct ir_stmt *stmt = (struct ir_stmt *) ir_fun_block(fun, label)->stmts.data + j;
+            size_t callee = called(in, stmt);
+            // only the functions before it are done, the others are the function itself
+            if (callee < index) {
+                struct ir_stmt_decl *decl = &stmt->val.decl;
+                struct ir_expr *call = ir_expr_value(stmt->tag == IR_STMT_DECL ? &decl->init : &stmt->val.expr.expr);
+                if (should_inline(in, callee, &call->val.call)) {
+                    // the rest of the block, calls in the inlined body are not looked at again
+                    label = inline_call(in, fun, label, j, callee);
+                    j = 0;
+                    changed = true;
+                    continue;
+                }
+            }
+            j++;
+        }
+    }
+    if (changed) {
+        ir_cfg_simplify(fun, in->pool);
+    }
+}
+
+void ir_inline_program(struct ir_program *program, long threshold, struct abc_pool *pool) {
+    if (threshold == 0) {
+        return;
+    }
+    size_t num_funs = program->ir_funs.len;
+    struct inliner in = {.program = program, .pool = pool, .scratch = abc_pool_create(), .threshold = threshold};
+    abc_map_init(&in.funs, sizeof(size_t), in.scratch);
+    in.calls = abc_pool_alloc(in.scratch, sizeof(uint32_t), num_funs + 1);
+    in.size = abc_pool_alloc(in.scratch, sizeof(uint32_t), num_funs + 1);
+    in.inlined = abc_pool_alloc(in.scratch, sizeof(bool), num_funs + 1);
+    for (size_t i = 0; i < num_funs; i++) {
+        abc_map_put(&in.funs, (uint64_t) (uintptr_t) fun_at(&in, i)->label, &i);
+        in.calls[i] = 0;
+        in.inlined[i] = false;
+    }
+    for (size_t i = 0; i < num_funs; i++) {
+        struct ir_fun *fun = fun_at(&in, i);
+        for (size_t j = 0; j < fun->rpo.len; j++) {
+            struct ir_block *block = ir_fun_block(fun, ((ir_label *) fun->rpo.data)[j]);
+            for (size_t k = 0; k < block->stmts.len; k++) {
+                size_t callee = called(&in, (struct ir_stmt *) block->stmts.data + k);
+                if (callee != SIZE_MAX) {
+                    in.calls[callee]++;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num_funs; i++) {
+        inline_fun(&in, i);
+        in.size[i] = fun_size(fun_at(&in, i));
+    }
+
+    // functions every call of which was inlined are not needed any more
+    size_t kept = 0;
+    for (size_t i = 0; i < num_funs; i++) {
+        if (!in.inlined[i] || in.calls[i] > 0 || is_main(fun_at(&in, i))) {
+            ((struct ir_fun *) program->ir_funs.data)[kept++] = *fun_at(&in, i);
+        }
+    }
+    program->ir_funs.len = kept;
+    abc_pool_destroy(in.scratch);
+}
@@ -0,0 +1,27 @@
+/**
+ * Function inlining on the IR.
+ *
+ * A call is replaced by a copy of the body of the function it calls, with the blocks and variables renumbered into the
+ * caller, so the call sequence, prelude and epilogue go away and the body can be optimized together with the
+ * arguments it gets at that call.
+ */
+
+#ifndef IR_INLINE_H
+#define IR_INLINE_H
+
+#include "../data/abc_pool.h"
+#include "ir.h"
+
+#define IR_INLINE_THRESHOLD 20 // default threshold of ir_inline_program
+
+/*
+ * Inline the calls whose cost is at most threshold. The cost is the size of the called function, in statements and
+ * jumps with its own calls already inlined, less 2 for every literal argument, as folding can specialise the body to
+ * it. A function with a single call left in the program is removed after that call is inlined, so it may be up to four
+ * times as large. Recursive calls are never inlined, and neither is anything when threshold is 0. A function every call
+ * of which was inlined is removed, unless it is main. New blocks, statements and variables are allocated in pool. The
+ * functions must not be in SSA form.
+ */
+void ir_inline_program(struct ir_program *program, long threshold, struct abc_pool *pool);
+
+#endif // IR_INLINE_H
@@ -0,0 +1,576 @@
+/**
+ * Loops are handled inner first like in ir_licm.c, after loop invariant code motion moved the computation of the
+ * factors out of them. A product with each distinct factor gets one new variable: a phi in the header starting at
+ * start * factor, and that phi plus step * factor right after the original variable is stepped, which is what the
+ * back edges pass. A product of the stepped original variable is the stepped new one. The products become copies of
+ * the new variables first, which are then replaced in every use.
+ */
+
+#include "ir_iv.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ir_cfg.h"
+#include "ir_fold.h"
+
+#define NO_STMT UINT32_MAX
+
+// where a variable is defined, parameters are in no block and phis at no statement
+struct def {
+    ir_label block;
+    uint32_t stmt;
+};
+
+struct basic_iv {
+    ir_var var; // the header phi
+    ir_var next; // var + step, what every back edge passes
+    struct ir_atom start; // what the preheader passes
+    struct ir_atom step;
+    uint32_t num_back_edges;
+};
+
+// new induction variable, equal to the basic one times factor
+struct reduced {
+    size_t basic; // index into iv.basics
+    struct ir_atom factor;
+    ir_var var; // basic.var * factor
+    ir_var next; // basic.next * factor
+};
+
+struct iv {
+    struct ir_fun *fun;
+    struct abc_pool *pool;
+    struct abc_pool *scratch;
+    struct def *defs; // by variable
+    bool *in_loop; // by block, for the loop being handled
+    ir_label header;
+    ir_label preheader;
+    struct abc_arr basics; // basic_iv
+    struct abc_arr reduced; // reduced
+    struct abc_arr copies; // ir_var, products that became copies of a new variable
+};
+
+static bool atom_eq(struct ir_atom a, struct ir_atom b) {
+    if (a.tag != b.tag) {
+        return false;
+    }
+    return a.tag == IR_ATOM_INT_LIT ? a.val.int_lit == b.val.int_lit : a.val.var == b.val.var;
+}
+
+static bool is_var(struct ir_atom atom, ir_var var) {
+    return atom.tag == IR_ATOM_IDENTIFIER && atom.val.var == var;
+}
+
+static struct ir_atom var_atom(ir_var var) {
+    return (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.var = var};
+}
+
+// whether a literal can be an operand of an instruction
+static bool fits(struct ir_atom atom) {
+    return atom.tag == IR_ATOM_IDENTIFIER || (atom.val.int_lit >= INT32_MIN && atom.val.int_lit <= INT32_MAX);
+}
+
+static void find_defs(struct iv *v) {
+    struct ir_fun *fun = v->fun;
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    v->defs = abc_pool_alloc(v->scratch, sizeof(struct def), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        v->defs[var] = (struct def) {IR_LABEL_NONE, NO_STMT};
+    }
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (size_t j = 0; j < block->phis.len; j++) {
+            v->defs[((struct ir_phi *) block->phis.data)[j].var] = (struct def) {label, NO_STMT};
+        }
+        for (uint32_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + j;
+            if (stmt->tag == IR_STMT_DECL) {
+                v->defs[stmt->val.decl.var] = (struct def) {label, j};
+            }
+        }
+    }
+}
+
+static bool is_invariant(struct iv *v, struct ir_atom atom) {
+    if (atom.tag == IR_ATOM_INT_LIT) {
+        return true;
+    }
+    ir_label block = v->defs[atom.val.var].block;
+    return block == IR_LABEL_NONE || !v->in_loop[block];
+}
+
+// The decl defining var, NULL for phis and parameters.
+static struct ir_stmt_decl *find_decl(struct iv *v, ir_var var) {
+    struct def def = v->defs[var];
+    if (def.stmt == NO_STMT) {
+        return NULL;
+    }
+    return &((struct ir_stmt *) ir_fun_block(v->fun, def.block)->stmts.data)[def.stmt].val.decl;
+}
+
+static void find_basics(struct iv *v) {
+    abc_arr_init(&v->basics, sizeof(struct basic_iv), v->scratch);
+    struct ir_block *header = ir_fun_block(v->fun, v->header);
+    for (size_t i = 0; i < header->phis.len; i++) {
+        struct ir_phi *phi = (struct ir_phi *) header->phis.data + i;
+        struct basic_iv basic = {.var = phi->var};
+        bool same = true;
+        for (size_t j = 0; j < phi->args.len && same; j++) {
+            struct ir_phi_arg arg = ((struct ir_phi_arg *) phi->args.data)[j];
+            if (arg.pred == v->preheader) {
+                basic.start = arg.atom;
+            } else if (arg.atom.tag != IR_ATOM_IDENTIFIER ||
+                       (basic.num_back_edges > 0 && arg.atom.val.var != basic.next)) {
+                same = false;
+            } else {
+                basic.next = arg.atom.val.var;
+                basic.num_back_edges++;
+            }
+        }
+        if (!same || basic.num_back_edges == 0) {
+            continue;
+        }
+
+        struct ir_stmt_decl *decl = find_decl(v, basic.next);
+        if (decl == NULL || decl->init.tag != IR_EXPR_BIN) {
+            continue;
+        }
+        struct ir_expr_bin bin = decl->init.val.bin;
+        if (bin.op == IR_BIN_PLUS && is_var(bin.rhs, basic.var)) {
+            bin.rhs = bin.lhs;
+            bin.lhs = var_atom(basic.var);
+        }
+        if (!is_var(bin.lhs, basic.var)) {
+            continue;
+        }
+        if (bin.op == IR_BIN_PLUS && is_invariant(v, bin.rhs)) {
+            basic.step = bin.rhs;
+        } else if (bin.op == IR_BIN_MINUS && bin.rhs.tag == IR_ATOM_INT_LIT && bin.rhs.val.int_lit > INT32_MIN) {
+            basic.step = (struct ir_atom) {.tag = IR_ATOM_INT_LIT, .val.int_lit = -bin.rhs.val.int_lit};
+        } else {
+            continue;
+        }
+        abc_arr_push(&v->basics, &basic);
+    }
+}
+
+// Find the basic induction variable atom is, or is the stepped value of.
+static bool find_basic(struct iv *v, struct ir_atom atom, size_t *index, bool *stepped) {
+    for (size_t i = 0; i < v->basics.len; i++) {
+        struct basic_iv *basic = (struct basic_iv *) v->basics.data + i;
+        if (is_var(atom, basic->var) || is_var(atom, basic->next)) {
+            *index = i;
+            *stepped = is_var(atom, basic->next);
+            return true;
+        }
+    }
+    return false;
+}
+
+// An atom holding lhs * rhs at the end of the preheader, a literal when both are and the product fits.
+static struct ir_atom product(struct iv *v, struct ir_atom lhs, struct ir_atom rhs) {
+    struct ir_expr expr = {.tag = IR_EXPR_BIN,
+                           .type = ABC_TYPE_INT,
+                           .val.bin = {.lhs = lhs, .rhs = rhs, .op = IR_BIN_MUL}};
+    struct ir_expr folded = expr;
+    if (ir_fold_expr(&folded) && fits(folded.val.atom.atom)) {
+        return folded.val.atom.atom;
+    }
+    struct ir_stmt stmt = {.tag = IR_STMT_DECL,
+                           .val.decl = {.var = v->fun->num_vars++, .type = ABC_TYPE_INT, .has_init = true,
+                                        .init = expr}};
+    abc_arr_push(&ir_fun_block(v->fun, v->preheader)->stmts, &stmt);
+    return var_atom(stmt.val.decl.var);
+}
+
+// The new induction variable for the basic one at index times factor, made on first use.
+static struct reduced *reduce(struct iv *v, size_t index, struct ir_atom factor) {
+    for (size_t i = 0; i < v->reduced.len; i++) {
+        struct reduced *r = (struct reduced *) v->reduced.data + i;
+        if (r->basic == index && atom_eq(r->factor, factor)) {
+            return r;
+        }
+    }
+
+    struct ir_fun *fun = v->fun;
+    struct basic_iv basic = ((struct basic_iv *) v->basics.data)[index];
+    struct ir_atom start = product(v, basic.start, factor);
+    struct ir_atom step = product(v, basic.step, factor);
+    struct reduced r = {.basic = index, .factor = factor, .var = fun->num_vars++, .next = fun->num_vars++};
+
+    struct ir_phi phi = {.var = r.var, .type = ABC_TYPE_INT};
+    abc_arr_init(&phi.args, sizeof(struct ir_phi_arg), v->pool);
+    struct ir_block *header = ir_fun_block(fun, v->header);
+    for (size_t i = 0; i < header->preds.len; i++) {
+        ir_label pred = ((ir_label *) header->preds.data)[i];
+        struct ir_phi_arg arg = {.pred = pred, .atom = pred == v->preheader ? start : var_atom(r.next)};
+        abc_arr_push(&phi.args, &arg);
+    }
+    abc_arr_push(&header->phis, &phi);
+
+    struct ir_stmt stmt = {.tag = IR_STMT_DECL,
+                           .val.decl = {.var = r.next, .type = ABC_TYPE_INT, .has_init = true,
+                                        .init = {.tag = IR_EXPR_BIN,
+                                                 .type = ABC_TYPE_INT,
+                                                 .val.bin = {.lhs = var_atom(r.var), .rhs = step, .op = IR_BIN_PLUS}}}};
+    ir_fold_expr(&stmt.val.decl.init);
+    struct def def = v->defs[basic.next];
+    struct ir_block *block = ir_fun_block(fun, def.block);
+    abc_arr_insert_after_ptr(&block->stmts, (struct ir_stmt *) block->stmts.data + def.stmt, &stmt);
+    // the statements after it moved, and the new variables have to be known
+    find_defs(v);
+
+    return abc_arr_push(&v->reduced, &r);
+}
+
+static void reduce_products(struct iv *v) {
+    struct ir_fun *fun = v->fun;
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        if (!v->in_loop[label]) {
+            continue;
+        }
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + j;
+            if (stmt->tag != IR_STMT_DECL || stmt->val.decl.init.tag != IR_EXPR_BIN ||
+                stmt->val.decl.init.val.bin.op != IR_BIN_MUL) {
+                continue;
+            }
+            struct ir_expr_bin bin = stmt->val.decl.init.val.bin;
+            size_t index;
+            bool stepped;
+            struct ir_atom factor;
+            if (find_basic(v, bin.lhs, &index, &stepped) && is_invariant(v, bin.rhs)) {
+                factor = bin.rhs;
+            } else if (find_basic(v, bin.rhs, &index, &stepped) && is_invariant(v, bin.lhs)) {
+                factor = bin.lhs;
+            } else {
+                continue;
+            }
+
+            ir_var var = stmt->val.decl.var;
+            struct reduced *r = reduce(v, index, factor);
+            ir_var with = stepped ? r->next : r->var;
+            // the statement moves when the stepping went in before it
+            j = v->defs[var].stmt;
+            struct ir_stmt_decl *decl = find_decl(v, var);
+            decl->init = (struct ir_expr) {.tag = IR_EXPR_ATOM, .type = ABC_TYPE_INT, .val.atom.atom = var_atom(with)};
+            abc_arr_push(&v->copies, &var);
+        }
+    }
+}
+
+// Call fn on every atom read in the reachable blocks.
+static void each_atom(struct ir_fun *fun, ir_atom_fn fn, void *ctx) {
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        struct ir_block *block = ir_fun_block(fun, ((ir_label *) fun->rpo.data)[i]);
+        for (size_t j = 0; j < block->phis.len; j++) {
+            struct ir_phi *phi = (struct ir_phi *) block->phis.data + j;
+            for (size_t k = 0; k < phi->args.len; k++) {
+                fn(ctx, &((struct ir_phi_arg *) phi->args.data)[k].atom);
+            }
+        }
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + j;
+            switch (stmt->tag) {
+                case IR_STMT_DECL:
+                    assert(stmt->val.decl.has_init);
+                    ir_expr_each_atom(&stmt->val.decl.init, fn, ctx);
+                    break;
+                case IR_STMT_EXPR:
+                    ir_expr_each_atom(&stmt->val.expr.expr, fn, ctx);
+                    break;
+                case IR_STMT_PRINT:
+                    fn(ctx, &stmt->val.print.atom);
+                    break;
+            }
+        }
+        ir_tail_each_atom(&block->tail, fn, ctx);
+    }
+}
+
+static void replace_atom(void *ctx, struct ir_atom *atom) {
+    struct ir_atom *with = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER) {
+        *atom = with[atom->val.var];
+    }
+}
+
+static void count_use(void *ctx, struct ir_atom *atom) {
+    uint32_t *uses = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER) {
+        uses[atom->val.var]++;
+    }
+}
+
+// Replace the copies made of the products by the new variables and drop them.
+static void replace_copies(struct iv *v) {
+    struct ir_fun *fun = v->fun;
+    struct ir_atom *with = abc_pool_alloc(v->scratch, sizeof(struct ir_atom), fun->num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        with[var] = var_atom(var);
+    }
+    for (size_t i = 0; i < v->copies.len; i++) {
+        ir_var var = ((ir_var *) v->copies.data)[i];
+        with[var] = find_decl(v, var)->init.val.atom.atom;
+    }
+    each_atom(fun, replace_atom, with);
+
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        struct ir_block *block = ir_fun_block(fun, ((ir_label *) fun->rpo.data)[i]);
+        struct ir_stmt *stmts = block->stmts.data;
+        size_t kept = 0;
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            if (stmts[j].tag == IR_STMT_DECL && !is_var(with[stmts[j].val.decl.var], stmts[j].val.decl.var)) {
+                continue;
+            }
+            stmts[kept++] = stmts[j];
+        }
+        block->stmts.len = kept;
+    }
+    v->copies.len = 0;
+    find_defs(v);
+}
+
+static enum ir_cmp mirror(enum ir_cmp cmp) {
+    switch (cmp) {
+        case IR_CMP_LT:
+            return IR_CMP_GT;
+        case IR_CMP_GT:
+            return IR_CMP_LT;
+        case IR_CMP_LE:
+            return IR_CMP_GE;
+        case IR_CMP_GE:
+            return IR_CMP_LE;
+        case IR_CMP_EQ:
+        case IR_CMP_NE:
+            return cmp;
+    }
+    assert(0);
+    abort();
+}
+
+static enum ir_cmp negate(enum ir_cmp cmp) {
+    switch (cmp) {
+        case IR_CMP_LT:
+            return IR_CMP_GE;
+        case IR_CMP_GE:
+            return IR_CMP_LT;
+        case IR_CMP_GT:
+            return IR_CMP_LE;
+        case IR_CMP_LE:
+            return IR_CMP_GT;
+        case IR_CMP_EQ:
+            return IR_CMP_NE;
+        case IR_CMP_NE:
+            return IR_CMP_EQ;
+    }
+    assert(0);
+    abort();
+}
+
+// Whether cmp compares basic, or its stepped value, against a loop invariant value.
+static bool is_test(struct iv *v, struct ir_expr_cmp *cmp, struct basic_iv *basic, bool *on_rhs, bool *stepped) {
+    for (int side = 0; side < 2; side++) {
+        struct ir_atom atom = side == 0 ? cmp->lhs : cmp->rhs;
+        struct ir_atom other = side == 0 ? cmp->rhs : cmp->lhs;
+        if ((is_var(atom, basic->var) || is_var(atom, basic->next)) && is_invariant(v, other)) {
+            *on_rhs = side == 1;
+            *stepped = is_var(atom, basic->next);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool mul_fits(long a, long b) {
+    long product;
+    return !__builtin_mul_overflow(a, b, &product);
+}
+
+/*
+ * The values basic and its stepped value take in the loop, when it starts and steps by literals and the header leaves
+ * the loop once it passes a literal bound. Every trip goes through the header, so it stays between the start and the
+ * bound, give or take a step.
+ */
+static bool counter_range(struct iv *v, struct basic_iv *basic, long *lo, long *hi) {
+    if (basic->start.tag != IR_ATOM_INT_LIT || basic->step.tag != IR_ATOM_INT_LIT) {
+        return false;
+    }
+    struct ir_block *header = ir_fun_block(v->fun, v->header);
+    if (!header->has_tail || header->tail.tag != IR_TAIL_IF) {
+        return false;
+    }
+    struct ir_tail_if branch = header->tail.val.if_then_else;
+    if (branch.atom.tag != IR_ATOM_IDENTIFIER || v->defs[branch.atom.val.var].block != v->header ||
+        v->in_loop[branch.then_label] == v->in_loop[branch.else_label]) {
+        return false;
+    }
+    struct ir_stmt_decl *decl = find_decl(v, branch.atom.val.var);
+    bool on_rhs;
+    bool stepped;
+    if (decl == NULL || decl->init.tag != IR_EXPR_CMP || !is_test(v, &decl->init.val.cmp, basic, &on_rhs, &stepped) ||
+        stepped) {
+        return false;
+    }
+    struct ir_expr_cmp cmp = decl->init.val.cmp;
+    struct ir_atom bound = on_rhs ? cmp.lhs : cmp.rhs;
+    if (bound.tag != IR_ATOM_INT_LIT) {
+        return false;
+    }
+
+    // the loop goes on while basic op bound
+    enum ir_cmp op = on_rhs ? mirror(cmp.cmp) : cmp.cmp;
+    if (!v->in_loop[branch.then_label]) {
+        op = negate(op);
+    }
+    long start = basic->start.val.int_lit;
+    long step = basic->step.val.int_lit;
+    long end = bound.val.int_lit;
+    bool up = step > 0 && (op == IR_CMP_LT || op == IR_CMP_LE);
+    bool down = step < 0 && (op == IR_CMP_GT || op == IR_CMP_GE);
+    if (!up && !down) {
+        return false;
+    }
+    long step_size = up ? step : -step;
+    *lo = start < end ? start : end;
+    *hi = start < end ? end : start;
+    return !__builtin_sub_overflow(*lo, step_size, lo) && !__builtin_add_overflow(*hi, step_size, hi);
+}
+
+/*
+ * Move the comparisons of a basic induction variable to a new one with a literal factor, when that leaves it only
+ * stepping itself. Comparing the products gives the same result only when none of them wraps around, so the values it
+ * takes and the bounds, all literals, must be known to fit. uses is by variable.
+ */
+static void replace_tests(struct iv *v, const uint32_t *uses) {
+    struct ir_fun *fun = v->fun;
+    for (size_t i = 0; i < v->basics.len; i++) {
+        struct basic_iv *basic = (struct basic_iv *) v->basics.data + i;
+        long lo;
+        long hi;
+        if (!counter_range(v, basic, &lo, &hi)) {
+            continue;
+        }
+        struct reduced *r = NULL;
+        for (size_t j = 0; j < v->reduced.len && r == NULL; j++) {
+            struct reduced *candidate = (struct reduced *) v->reduced.data + j;
+            struct ir_atom factor = candidate->factor;
+            if (candidate->basic == i && factor.tag == IR_ATOM_INT_LIT && factor.val.int_lit != 0 &&
+                mul_fits(lo, factor.val.int_lit) && mul_fits(hi, factor.val.int_lit)) {
+                r = candidate;
+            }
+        }
+        if (r == NULL) {
+            continue;
+        }
+
+        // the tests are counted first and rewritten on the second round
+        for (int rewrite = 0; rewrite < 2; rewrite++) {
+            uint32_t var_tests = 0;
+            uint32_t next_tests = 0;
+            bool fits_all = true;
+            for (size_t j = 0; j < fun->rpo.len; j++) {
+                ir_label label = ((ir_label *) fun->rpo.data)[j];
+                if (!v->in_loop[label]) {
+                    continue;
+                }
+                struct ir_block *block = ir_fun_block(fun, label);
+                for (size_t k = 0; k < block->stmts.len; k++) {
+                    struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + k;
+                    bool on_rhs;
+                    bool stepped;
+                    if (stmt->tag != IR_STMT_DECL || stmt->val.decl.init.tag != IR_EXPR_CMP ||
+                        !is_test(v, &stmt->val.decl.init.val.cmp, basic, &on_rhs, &stepped)) {
+                        continue;
+                    }
+                    if (rewrite == 0) {
+                        struct ir_expr_cmp *cmp = &stmt->val.decl.init.val.cmp;
+                        struct ir_atom bound = on_rhs ? cmp->lhs : cmp->rhs;
+                        if (bound.tag != IR_ATOM_INT_LIT || !mul_fits(bound.val.int_lit, r->factor.val.int_lit)) {
+                            fits_all = false;
+                        }
+                        if (stepped) {
+                            next_tests++;
+                        } else {
+                            var_tests++;
+                        }
+                        continue;
+                    }
+                    struct ir_expr_cmp *cmp = &stmt->val.decl.init.val.cmp;
+                    struct ir_atom bound = on_rhs ? cmp->lhs : cmp->rhs;
+                    enum ir_cmp op = on_rhs ? mirror(cmp->cmp) : cmp->cmp;
+                    cmp->cmp = r->factor.val.int_lit < 0 ? mirror(op) : op;
+                    cmp->lhs = var_atom(stepped ? r->next : r->var);
+                    // appends to the preheader, which is outside the loop
+                    cmp->rhs = product(v, bound, r->factor);
+                }
+            }
+            // the variable itself is read by its step, the stepped value by the back edges
+            if (rewrite == 0 && (var_tests + next_tests == 0 || !fits_all || uses[basic->var] != 1 + var_tests ||
+                                 uses[basic->next] != basic->num_back_edges + next_tests)) {
+                break;
+            }
+        }
+    }
+}
+
+static void iv_loop(struct iv *v) {
+    struct ir_fun *fun = v->fun;
+    find_defs(v);
+    find_basics(v);
+    if (v->basics.len == 0) {
+        return;
+    }
+    abc_arr_init(&v->reduced, sizeof(struct reduced), v->scratch);
+    abc_arr_init(&v->copies, sizeof(ir_var), v->scratch);
+    reduce_products(v);
+    if (v->reduced.len == 0) {
+        return;
+    }
+    replace_copies(v);
+
+    uint32_t *uses = abc_pool_alloc(v->scratch, sizeof(uint32_t), fun->num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        uses[var] = 0;
+    }
+    each_atom(fun, count_use, uses);
+    replace_tests(v, uses);
+}
+
+static void iv_fun(struct ir_fun *fun, struct abc_pool *pool) {
+    assert(fun->ssa);
+    struct iv v = {.fun = fun, .pool = pool, .scratch = abc_pool_create()};
+    ir_cfg_compute_rpo(fun, v.scratch);
+    ir_cfg_compute_dominators(fun);
+
+    struct abc_arr headers = ir_cfg_loop_headers(fun, v.scratch);
+    for (size_t i = headers.len; i-- > 0;) {
+        v.header = ((ir_label *) headers.data)[i];
+        v.in_loop = ir_cfg_loop_blocks(fun, v.header, v.scratch);
+        size_t num_blocks = fun->blocks.len;
+        v.preheader = ir_cfg_make_preheader(fun, v.header, v.in_loop, pool);
+        if (v.preheader == IR_LABEL_NONE) {
+            continue;
+        }
+        if (fun->blocks.len != num_blocks) {
+            ir_cfg_compute_rpo(fun, v.scratch);
+            ir_cfg_compute_dominators(fun);
+        }
+        iv_loop(&v);
+    }
+
+    // preheaders nothing was computed in are jumped past again
+    ir_cfg_simplify(fun, v.scratch);
+    abc_pool_destroy(v.scratch);
+}
+
+void ir_iv_program(struct ir_program *program, struct abc_pool *pool) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        iv_fun((struct ir_fun *) program->ir_funs.data + i, pool);
+    }
+}
@@ -0,0 +1,28 @@
+/**
+ * Induction variables and strength reduction on SSA form.
+ *
+ * A basic induction variable is a phi in a loop header that the back edges pass the phi plus a loop invariant step,
+ * and the preheader some start value. A product of it and a loop invariant factor changes by step * factor each trip,
+ * so it can be kept up to date with an addition instead of being multiplied out every time.
+ */
+
+#ifndef IR_IV_H
+#define IR_IV_H
+
+#include "../data/abc_pool.h"
+#include "ir.h"
+
+/*
+ * Replace products of basic induction variables and loop invariant values in loops by new induction variables
+ * counting in steps of the factor, with the start and the step computed in the preheader. Like the multiplications
+ * they replace, the new variables may wrap around. The comparisons of the original variable are moved to the product
+ * only when its start and step are literals, the loop header leaves the loop once it passes a literal bound, the
+ * factor is a nonzero literal and every other comparison in the loop is against a literal too. The range the counter
+ * takes, one step past the bounds, and each bound multiplied by the factor must fit in 64 bits (mul_fits in
+ * ir_iv.c), and apart from the tests the counter may only be read by its step and the stepped value by the back edges.
+ * Otherwise the original tests stay. New variables, statements and phis are allocated in pool. The functions must be in
+ * SSA form.
+ */
+void ir_iv_program(struct ir_program *program, struct abc_pool *pool);
+
+#endif // IR_IV_H
@@ -0,0 +1,142 @@
+/**
+ * Loops are handled from the last header in reverse postorder to the first, so an inner loop comes before the loops
+ * around it and what moved to its preheader, which belongs to the outer loop, can move on from there. A computation is
+ * invariant when its operands are literals or defined outside the loop, by looking at the blocks in reverse postorder
+ * the computations it reads moved out already.
+ */
+
+#include "ir_licm.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "ir_cfg.h"
+
+struct licm {
+    struct ir_fun *fun;
+    struct abc_pool *pool;
+    struct abc_pool *scratch;
+    ir_label *def_block; // by variable, IR_LABEL_NONE for parameters
+    bool *in_loop; // by block, for the loop being handled
+};
+
+struct invariance {
+    struct licm *l;
+    bool invariant;
+};
+
+static void check_invariant(void *ctx, struct ir_atom *atom) {
+    struct invariance *inv = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER) {
+        ir_label def = inv->l->def_block[atom->val.var];
+        if (def != IR_LABEL_NONE && inv->l->in_loop[def]) {
+            inv->invariant = false;
+        }
+    }
+}
+
+static void find_defs(struct licm *l) {
+    struct ir_fun *fun = l->fun;
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    l->def_block = abc_pool_alloc(l->scratch, sizeof(ir_label), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        l->def_block[var] = IR_LABEL_NONE;
+    }
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (size_t j = 0; j < block->phis.len; j++) {
+            l->def_block[((struct ir_phi *) block->phis.data)[j].var] = label;
+        }
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + j;
+            if (stmt->tag == IR_STMT_DECL) {
+                l->def_block[stmt->val.decl.var] = label;
+            }
+        }
+    }
+}
+
+// may_trap is whether a division that can trap is allowed to move
+static bool can_hoist(struct licm *l, struct ir_stmt *stmt, bool may_trap) {
+    if (stmt->tag != IR_STMT_DECL) {
+        return false;
+    }
+    struct ir_expr *init = &stmt->val.decl.init;
+    if (init->tag == IR_EXPR_CALL || (ir_expr_has_effect(init) && !may_trap)) {
+        return false;
+    }
+    struct invariance inv = {.l = l, .invariant = true};
+    ir_expr_each_atom(init, check_invariant, &inv);
+    return inv.invariant;
+}
+
+static void hoist(struct licm *l, ir_label header, ir_label preheader) {
+    struct ir_fun *fun = l->fun;
+    struct ir_block *pre = ir_fun_block(fun, preheader);
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        if (!l->in_loop[label]) {
+            continue;
+        }
+        struct ir_block *block = ir_fun_block(fun, label);
+        struct ir_stmt *stmts = block->stmts.data;
+        bool effect_before = false;
+        size_t kept = 0;
+        for (size_t j = 0; j < block->stmts.len; j++) {
+            struct ir_stmt stmt = stmts[j];
+            if (can_hoist(l, &stmt, label == header && !effect_before)) {
+                abc_arr_push(&pre->stmts, &stmt);
+                l->def_block[stmt.val.decl.var] = preheader;
+                continue;
+            }
+            switch (stmt.tag) {
+                case IR_STMT_DECL:
+                    effect_before |= ir_expr_has_effect(&stmt.val.decl.init);
+                    break;
+                case IR_STMT_EXPR:
+                    effect_before |= ir_expr_has_effect(&stmt.val.expr.expr);
+                    break;
+                case IR_STMT_PRINT:
+                    effect_before = true;
+                    break;
+            }
+            stmts[kept++] = stmt;
+        }
+        block->stmts.len = kept;
+    }
+}
+
+static void licm_fun(struct ir_fun *fun, struct abc_pool *pool) {
+    assert(fun->ssa);
+    struct licm l = {.fun = fun, .pool = pool, .scratch = abc_pool_create()};
+    ir_cfg_compute_rpo(fun, l.scratch);
+    ir_cfg_compute_dominators(fun);
+
+    struct abc_arr headers = ir_cfg_loop_headers(fun, l.scratch);
+    for (size_t i = headers.len; i-- > 0;) {
+        ir_label header = ((ir_label *) headers.data)[i];
+        l.in_loop = ir_cfg_loop_blocks(fun, header, l.scratch);
+        size_t num_blocks = fun->blocks.len;
+        ir_label preheader = ir_cfg_make_preheader(fun, header, l.in_loop, l.pool);
+        if (preheader == IR_LABEL_NONE) {
+            continue;
+        }
+        if (fun->blocks.len != num_blocks) {
+            ir_cfg_compute_rpo(fun, l.scratch);
+            ir_cfg_compute_dominators(fun);
+        }
+        find_defs(&l);
+        hoist(&l, header, preheader);
+    }
+
+    // preheaders nothing moved to are jumped past again
+    ir_cfg_simplify(fun, l.scratch);
+    abc_pool_destroy(l.scratch);
+}
+
+void ir_licm_program(struct ir_program *program, struct abc_pool *pool) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        licm_fun((struct ir_fun *) program->ir_funs.data + i, pool);
+    }
+}
@@ -0,0 +1,24 @@
+/**
+ * Loop invariant code motion on SSA form.
+ *
+ * A loop is a header together with the blocks that reach one of its back edges, the edges into the header from blocks
+ * it dominates, without going through the header. Computations in a loop whose operands are all defined outside of it
+ * give the same value on every trip, so they are computed once before the loop is entered instead.
+ */
+
+#ifndef IR_LICM_H
+#define IR_LICM_H
+
+#include "../data/abc_pool.h"
+#include "ir.h"
+
+/*
+ * Give every loop a preheader, a block that only jumps to the header and that every edge into the loop from outside
+ * goes through, and move the invariant arithmetic, comparisons and copies there, inner loops first so computations
+ * can move out of several loops. A division that can trap only moves out of the header when nothing with an effect
+ * comes before it there, the header runs right after the preheader so it would have trapped at that point anyway.
+ * New variables and phis are allocated in pool. The functions must be in SSA form.
+ */
+void ir_licm_program(struct ir_program *program, struct abc_pool *pool);
+
+#endif // IR_LICM_H
@@ -0,0 +1,411 @@
+/**
+ * Wegman and Zadeck's algorithm: a worklist of control flow edges marks blocks executable as their first incoming
+ * edge is, a worklist of variables revisits the uses of a variable whose value dropped in the lattice. Phis only meet
+ * the arguments of executable edges, and a conditional jump on a constant only follows one edge.
+ */
+
+#include "ir_sccp.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_cfg.h"
+#include "ir_fold.h"
+
+// No value seen yet, a single constant, or more than one value.
+enum lattice_tag { LATTICE_UNDEF, LATTICE_CONST, LATTICE_OVER };
+
+struct lattice {
+    enum lattice_tag tag;
+    long val;
+};
+
+enum use_tag { USE_PHI, USE_STMT, USE_TAIL };
+
+// where a variable is read
+struct use {
+    enum use_tag tag;
+    ir_label block;
+    uint32_t index; // of the phi or statement
+};
+
+struct edge {
+    ir_label from;
+    ir_label to;
+};
+
+struct sccp {
+    struct ir_fun *fun;
+    struct lattice *values; // by variable
+    bool *executable; // by block
+    bool *edge_executable; // by block, two for every block, in the order of its successors
+    uint32_t *use_start; // by variable, its uses are uses[use_start[var]] up to uses[use_start[var + 1]]
+    struct use *uses;
+    struct abc_arr edge_work; // edge
+    struct abc_arr var_work; // ir_var
+};
+
+static const struct lattice OVER = {.tag = LATTICE_OVER};
+
+// Only literals x64 can take as an immediate operand are propagated, larger values count as unknown.
+static struct lattice lit(long val) {
+    if (val < INT32_MIN || val > INT32_MAX) {
+        return OVER;
+    }
+    return (struct lattice) {.tag = LATTICE_CONST, .val = val};
+}
+
+static struct lattice meet(struct lattice a, struct lattice b) {
+    if (a.tag == LATTICE_UNDEF) {
+        return b;
+    }
+    if (b.tag == LATTICE_UNDEF) {
+        return a;
+    }
+    if (a.tag == LATTICE_CONST && b.tag == LATTICE_CONST && a.val == b.val) {
+        return a;
+    }
+    return OVER;
+}
+
+static struct lattice atom_value(struct sccp *s, struct ir_atom atom) {
+    if (atom.tag == IR_ATOM_INT_LIT) {
+        return lit(atom.val.int_lit);
+    }
+    return s->values[atom.val.var];
+}
+
+/* USES */
+
+typedef void (*use_fn)(struct sccp *s, ir_var var, struct use use);
+
+static void count_use(struct sccp *s, ir_var var, struct use use) {
+    (void) use;
+    s->use_start[var + 1]++;
+}
+
+static void fill_use(struct sccp *s, ir_var var, struct use use) { s->uses[s->use_start[var]++] = use; }
+
+// atom callback state of each_use
+struct use_visit {
+    struct sccp *s;
+    use_fn fn;
+    struct use use;
+};
+
+static void visit_atom(void *ctx, struct ir_atom *atom) {
+    struct use_visit *v = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER) {
+        v->fn(v->s, atom->val.var, v->use);
+    }
+}
+
+static void each_use(struct sccp *s, use_fn fn) {
+    struct ir_fun *fun = s->fun;
+    struct use_visit v = {.s = s, .fn = fn};
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_block *block = ir_fun_block(fun, label);
+        v.use = (struct use) {.tag = USE_PHI, .block = label};
+        for (v.use.index = 0; v.use.index < block->phis.len; v.use.index++) {
+            struct abc_arr *args = &((struct ir_phi *) block->phis.data)[v.use.index].args;
+            for (size_t j = 0; j < args->len; j++) {
+                visit_atom(&v, &((struct ir_phi_arg *) args->data)[j].atom);
+            }
+        }
+        v.use.tag = USE_STMT;
+        for (v.use.index = 0; v.use.index < block->stmts.len; v.use.index++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + v.use.index;
+            if (stmt->tag == IR_STMT_PRINT) {
+                visit_atom(&v, &stmt->val.print.atom);
+            } else if (stmt->tag == IR_STMT_EXPR) {
+                ir_expr_each_atom(&stmt->val.expr.expr, visit_atom, &v);
+            } else if (stmt->val.decl.has_init) {
+                ir_expr_each_atom(&stmt->val.decl.init, visit_atom, &v);
+            }
+        }
+        v.use = (struct use) {.tag = USE_TAIL, .block = label};
+        ir_tail_each_atom(&block->tail, visit_atom, &v);
+    }
+}
+
+// Index the uses by variable, counting them first and then filling in each range from its start.
+static void compute_uses(struct sccp *s, struct abc_pool *scratch) {
+    ir_var num_vars = s->fun->num_vars;
+    s->use_start = abc_pool_alloc(scratch, sizeof(uint32_t), num_vars + 1);
+    memset(s->use_start, 0, sizeof(uint32_t) * (num_vars + 1));
+    each_use(s, count_use);
+    for (ir_var var = 0; var < num_vars; var++) {
+        s->use_start[var + 1] += s->use_start[var];
+    }
+    s->uses = abc_pool_alloc(scratch, sizeof(struct use), s->use_start[num_vars] + 1);
+    each_use(s, fill_use);
+    // filling moved every start to the next one
+    for (ir_var var = num_vars; var > 0; var--) {
+        s->use_start[var] = s->use_start[var - 1];
+    }
+    s->use_start[0] = 0;
+}
+
+/* PROPAGATION */
+
+static void set_value(struct sccp *s, ir_var var, struct lattice val) {
+    struct lattice *curr = &s->values[var];
+    if (curr->tag == val.tag && (val.tag != LATTICE_CONST || curr->val == val.val)) {
+        return;
+    }
+    *curr = val;
+    abc_arr_push(&s->var_work, &var);
+}
+
+static bool *edge_flag(struct sccp *s, ir_label from, ir_label to) {
+    struct ir_block *block = ir_fun_block(s->fun, from);
+    for (size_t i = 0; i < block->succs.len; i++) {
+        if (((ir_label *) block->succs.data)[i] == to) {
+            return &s->edge_executable[2 * from + i];
+        }
+    }
+    assert(0);
+    abort();
+}
+
+static void push_edge(struct sccp *s, ir_label from, ir_label to) {
+    struct edge edge = {.from = from, .to = to};
+    abc_arr_push(&s->edge_work, &edge);
+}
+
+static struct lattice eval_expr(struct sccp *s, struct ir_expr *expr) {
+    struct lattice lhs = OVER, rhs = OVER;
+    long res;
+    switch (expr->tag) {
+        case IR_EXPR_BIN:
+            lhs = atom_value(s, expr->val.bin.lhs);
+            rhs = atom_value(s, expr->val.bin.rhs);
+            if (lhs.tag == LATTICE_CONST && rhs.tag == LATTICE_CONST) {
+                return ir_fold_bin(expr->val.bin.op, lhs.val, rhs.val, &res) ? lit(res) : OVER;
+            }
+            break;
+        case IR_EXPR_UNARY:
+            lhs = atom_value(s, expr->val.unary.atom);
+            if (lhs.tag == LATTICE_CONST) {
+                return lit(ir_fold_unary(expr->val.unary.op, lhs.val));
+            }
+            return lhs;
+        case IR_EXPR_ATOM:
+            return atom_value(s, expr->val.atom.atom);
+        case IR_EXPR_CMP:
+            lhs = atom_value(s, expr->val.cmp.lhs);
+            rhs = atom_value(s, expr->val.cmp.rhs);
+            if (lhs.tag == LATTICE_CONST && rhs.tag == LATTICE_CONST) {
+                return lit(ir_fold_cmp(expr->val.cmp.cmp, lhs.val, rhs.val));
+            }
+            break;
+        case IR_EXPR_CALL:
+            return OVER;
+        case IR_EXPR_ASSIGN:
+            assert(0);
+    }
+    // an operand without a value yet makes the result wait for it
+    if (lhs.tag == LATTICE_UNDEF || rhs.tag == LATTICE_UNDEF) {
+        return (struct lattice) {.tag = LATTICE_UNDEF};
+    }
+    return OVER;
+}
+
+static void visit_phi(struct sccp *s, ir_label label, struct ir_phi *phi) {
+    struct lattice val = {.tag = LATTICE_UNDEF};
+    for (size_t i = 0; i < phi->args.len; i++) {
+        struct ir_phi_arg *arg = (struct ir_phi_arg *) phi->args.data + i;
+        if (*edge_flag(s, arg->pred, label)) {
+            val = meet(val, atom_value(s, arg->atom));
+        }
+    }
+    set_value(s, phi->var, val);
+}
+
+static void visit_stmt(struct sccp *s, struct ir_stmt *stmt) {
+    if (stmt->tag == IR_STMT_DECL && stmt->val.decl.has_init) {
+        set_value(s, stmt->val.decl.var, eval_expr(s, &stmt->val.decl.init));
+    }
+}
+
+static void visit_tail(struct sccp *s, ir_label label) {
+    struct ir_tail *tail = &ir_fun_block(s->fun, label)->tail;
+    struct lattice cond;
+    switch (tail->tag) {
+        case IR_TAIL_GOTO:
+            push_edge(s, label, tail->val.go_to.label);
+            break;
+        case IR_TAIL_RET:
+            break;
+        case IR_TAIL_IF:
+            cond = atom_value(s, tail->val.if_then_else.atom);
+            if (cond.tag == LATTICE_UNDEF) {
+                break;
+            }
+            if (cond.tag == LATTICE_OVER || cond.val) {
+                push_edge(s, label, tail->val.if_then_else.then_label);
+            }
+            if (cond.tag == LATTICE_OVER || !cond.val) {
+                push_edge(s, label, tail->val.if_then_else.else_label);
+            }
+            break;
+    }
+}
+
+static void visit_use(struct sccp *s, struct use use) {
+    struct ir_block *block = ir_fun_block(s->fun, use.block);
+    if (!s->executable[use.block]) {
+        return;
+    }
+    switch (use.tag) {
+        case USE_PHI:
+            visit_phi(s, use.block, (struct ir_phi *) block->phis.data + use.index);
+            break;
+        case USE_STMT:
+            visit_stmt(s, (struct ir_stmt *) block->stmts.data + use.index);
+            break;
+        case USE_TAIL:
+            visit_tail(s, use.block);
+            break;
+    }
+}
+
+static void visit_edge(struct sccp *s, struct edge edge) {
+    struct ir_fun *fun = s->fun;
+    if (edge.from != IR_LABEL_NONE) {
+        bool *flag = edge_flag(s, edge.from, edge.to);
+        if (*flag) {
+            return;
+        }
+        *flag = true;
+    }
+    struct ir_block *block = ir_fun_block(fun, edge.to);
+    for (size_t i = 0; i < block->phis.len; i++) {
+        visit_phi(s, edge.to, (struct ir_phi *) block->phis.data + i);
+    }
+    if (s->executable[edge.to]) {
+        return;
+    }
+    s->executable[edge.to] = true;
+    for (size_t i = 0; i < block->stmts.len; i++) {
+        visit_stmt(s, (struct ir_stmt *) block->stmts.data + i);
+    }
+    if (block->has_tail) {
+        visit_tail(s, edge.to);
+    }
+}
+
+static void propagate(struct sccp *s) {
+    push_edge(s, IR_LABEL_NONE, s->fun->entry);
+    while (s->edge_work.len > 0 || s->var_work.len > 0) {
+        while (s->edge_work.len > 0) {
+            visit_edge(s, ((struct edge *) s->edge_work.data)[--s->edge_work.len]);
+        }
+        while (s->var_work.len > 0 && s->edge_work.len == 0) {
+            ir_var var = ((ir_var *) s->var_work.data)[--s->var_work.len];
+            for (uint32_t i = s->use_start[var]; i < s->use_start[var + 1]; i++) {
+                visit_use(s, s->uses[i]);
+            }
+        }
+    }
+}
+
+/* REWRITING */
+
+static void replace_const(void *ctx, struct ir_atom *atom) {
+    struct sccp *s = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER && s->values[atom->val.var].tag == LATTICE_CONST) {
+        *atom = (struct ir_atom) {.tag = IR_ATOM_INT_LIT, .val.int_lit = s->values[atom->val.var].val};
+    }
+}
+
+/*
+ * Replace the constants in the executable blocks and fold what they feed. Phis of constants go away, their uses have
+ * all been replaced. The decls of constants are left, they are folded to their value.
+ */
+static void rewrite_block(struct sccp *s, ir_label label) {
+    struct ir_block *block = ir_fun_block(s->fun, label);
+    size_t kept = 0;
+    for (size_t i = 0; i < block->phis.len; i++) {
+        struct ir_phi *phi = (struct ir_phi *) block->phis.data + i;
+        if (s->values[phi->var].tag == LATTICE_CONST) {
+            continue;
+        }
+        for (size_t j = 0; j < phi->args.len; j++) {
+            replace_const(s, &((struct ir_phi_arg *) phi->args.data)[j].atom);
+        }
+        ((struct ir_phi *) block->phis.data)[kept++] = *phi;
+    }
+    block->phis.len = kept;
+
+    for (size_t i = 0; i < block->stmts.len; i++) {
+        struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + i;
+        if (stmt->tag == IR_STMT_PRINT) {
+            replace_const(s, &stmt->val.print.atom);
+        } else if (stmt->tag == IR_STMT_EXPR) {
+            ir_expr_each_atom(&stmt->val.expr.expr, replace_const, s);
+            ir_fold_expr(&stmt->val.expr.expr);
+        } else if (stmt->val.decl.has_init) {
+            ir_expr_each_atom(&stmt->val.decl.init, replace_const, s);
+            ir_fold_expr(&stmt->val.decl.init);
+        }
+    }
+
+    ir_tail_each_atom(&block->tail, replace_const, s);
+    if (block->tail.tag != IR_TAIL_IF) {
+        return;
+    }
+    // a constant condition, only one of the edges was found executable
+    struct ir_tail_if cond = block->tail.val.if_then_else;
+    bool then_taken = *edge_flag(s, label, cond.then_label);
+    bool else_taken = *edge_flag(s, label, cond.else_label);
+    if (cond.then_label == cond.else_label || then_taken == else_taken) {
+        return;
+    }
+    ir_label taken = then_taken ? cond.then_label : cond.else_label;
+    ir_label dropped = then_taken ? cond.else_label : cond.then_label;
+    ir_cfg_remove_phi_args(s->fun, dropped, label);
+    ir_cfg_set_tail(s->fun, label, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = taken});
+}
+
+static void sccp_fun(struct ir_fun *fun) {
+    assert(fun->ssa);
+    struct abc_pool *scratch = abc_pool_create();
+    struct sccp s = {.fun = fun};
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    s.values = abc_pool_alloc(scratch, sizeof(struct lattice), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        s.values[var] = (struct lattice) {.tag = LATTICE_UNDEF};
+    }
+    for (size_t i = 0; i < fun->args.len; i++) {
+        s.values[((struct ir_param *) fun->args.data)[i].var] = OVER;
+    }
+    s.executable = abc_pool_alloc(scratch, sizeof(bool), fun->blocks.len);
+    s.edge_executable = abc_pool_alloc(scratch, sizeof(bool), 2 * fun->blocks.len);
+    memset(s.executable, 0, sizeof(bool) * fun->blocks.len);
+    memset(s.edge_executable, 0, sizeof(bool) * 2 * fun->blocks.len);
+    abc_arr_init(&s.edge_work, sizeof(struct edge), scratch);
+    abc_arr_init(&s.var_work, sizeof(ir_var), scratch);
+    compute_uses(&s, scratch);
+
+    propagate(&s);
+
+    // the tails are rewritten in the same walk, which leaves the order of fun->rpo alone
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        if (s.executable[label]) {
+            rewrite_block(&s, label);
+        }
+    }
+    ir_cfg_simplify(fun, scratch);
+    abc_pool_destroy(scratch);
+}
+
+void ir_sccp_program(struct ir_program *program) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        sccp_fun((struct ir_fun *) program->ir_funs.data + i);
+    }
+}
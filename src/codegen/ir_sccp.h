@@ -0,0 +1,20 @@
+/**
+ * Sparse conditional constant propagation on SSA form.
+ *
+ * Values of variables and reachability of blocks are found together, so a branch decided by a constant keeps the
+ * values of the arm that is never taken from reaching the join point after it.
+ */
+
+#ifndef IR_SCCP_H
+#define IR_SCCP_H
+
+#include "ir.h"
+
+/*
+ * Replace every variable that has the same constant value on all executable paths by that value, turn conditional
+ * jumps on constants into gotos and cut off the blocks that can no longer be reached. The functions must be in SSA
+ * form.
+ */
+void ir_sccp_program(struct ir_program *program);
+
+#endif // IR_SCCP_H
@@ -0,0 +1,638 @@
+/**
+ * SSA construction after Cytron et al: phis go on the iterated dominance frontiers of the definitions, pruned by
+ * liveness, and a walk over the dominator tree renames the variables. Destruction turns the phis into parallel copies.
+ */
+
+#include "ir_ssa.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ir_cfg.h"
+
+#define GLOBAL_NONE UINT32_MAX
+#define COPY_NONE UINT32_MAX
+
+/* BIT SETS */
+
+static size_t set_words(size_t bits) { return (bits + 63) / 64; }
+
+static uint64_t *set_alloc(struct abc_pool *pool, size_t words) {
+    uint64_t *set = abc_pool_alloc(pool, sizeof(uint64_t), words > 0 ? words : 1);
+    memset(set, 0, sizeof(uint64_t) * words);
+    return set;
+}
+
+static bool set_has(const uint64_t *set, size_t i) { return (set[i / 64] >> (i % 64)) & 1; }
+
+static void set_add(uint64_t *set, size_t i) { set[i / 64] |= (uint64_t) 1 << (i % 64); }
+
+/* CONSTRUCTION */
+
+// variable restored when leaving a block of the dominator tree
+struct undo_entry {
+    ir_var var;
+    struct ir_atom prev;
+};
+
+// pending block of the dominator tree walk
+struct rename_frame {
+    ir_label block;
+    size_t undo_mark; // undo.len before the block, once it is done
+    bool done;
+};
+
+struct ssa_builder {
+    struct ir_fun *fun;
+    struct abc_pool *pool; // of the program
+    struct abc_pool *scratch;
+    ir_var num_orig; // variables before renaming
+    enum abc_type *types; // by original variable
+    // scanning, the arrays by position are indexed by rpo
+    uint32_t block; // rpo of the block being scanned
+    uint32_t *stamp; // by original variable, rpo + 1 of the last block defining it
+    uint32_t *global; // by original variable, its index among the variables read across blocks or GLOBAL_NONE
+    uint32_t num_globals;
+    struct abc_arr *defs; // by position, ir_var defined in the block, each once
+    struct abc_arr *upward_uses; // by position, global index of the variables read before a definition in the block
+    uint64_t **live_in; // by position, set of globals
+    // renaming
+    struct ir_atom *curr; // by original variable, its current value
+    bool *named; // by original variable, the first definition keeps the original variable
+    struct abc_arr origs; // ir_var, original variable of the variables from num_orig on
+    struct abc_arr undo; // undo_entry
+    struct abc_arr targets; // ir_var, scratch for assignment chains
+};
+
+// value of variables that are not initialized on some path
+static const struct ir_atom UNDEF = {.tag = IR_ATOM_INT_LIT, .val.int_lit = 0};
+
+static struct ir_atom var_atom(ir_var var) { return (struct ir_atom) {.tag = IR_ATOM_IDENTIFIER, .val.var = var}; }
+
+static void scan_use(void *ctx, struct ir_atom *atom) {
+    struct ssa_builder *b = ctx;
+    if (atom->tag != IR_ATOM_IDENTIFIER || b->stamp[atom->val.var] == b->block + 1) {
+        return;
+    }
+    uint32_t *global = &b->global[atom->val.var];
+    if (*global == GLOBAL_NONE) {
+        *global = b->num_globals++;
+    }
+    abc_arr_push(&b->upward_uses[b->block], global);
+}
+
+static void scan_def(struct ssa_builder *b, ir_var var) {
+    if (b->stamp[var] != b->block + 1) {
+        b->stamp[var] = b->block + 1;
+        abc_arr_push(&b->defs[b->block], &var);
+    }
+}
+
+/*
+ * Find the definitions of each block and the variables it reads before defining them. Only the latter, the globals,
+ * can need a phi. Also records the type of every variable.
+ */
+static void scan_blocks(struct ssa_builder *b) {
+    struct ir_fun *fun = b->fun;
+    ir_label *rpo = fun->rpo.data;
+    for (size_t i = 0; i < fun->args.len; i++) {
+        struct ir_param *param = (struct ir_param *) fun->args.data + i;
+        b->types[param->var] = param->type;
+    }
+    for (b->block = 0; b->block < fun->rpo.len; b->block++) {
+        struct ir_block *block = ir_fun_block(fun, rpo[b->block]);
+        abc_arr_init_cap(&b->defs[b->block], sizeof(ir_var), 1, b->scratch);
+        abc_arr_init_cap(&b->upward_uses[b->block], sizeof(uint32_t), 1, b->scratch);
+        if (b->block == 0) {
+            for (size_t i = 0; i < fun->args.len; i++) {
+                scan_def(b, ((struct ir_param *) fun->args.data)[i].var);
+            }
+        }
+        for (size_t i = 0; i < block->stmts.len; i++) {
+            struct ir_stmt *stmt = (struct ir_stmt *) block->stmts.data + i;
+            struct ir_expr *expr = NULL;
+            switch (stmt->tag) {
+                case IR_STMT_DECL:
+                    b->types[stmt->val.decl.var] = stmt->val.decl.type;
+                    if (stmt->val.decl.has_init) {
+                        expr = &stmt->val.decl.init;
+                        ir_expr_each_atom(expr, scan_use, b);
+                    }
+                    scan_def(b, stmt->val.decl.var);
+                    break;
+                case IR_STMT_EXPR:
+                    expr = &stmt->val.expr.expr;
+                    ir_expr_each_atom(expr, scan_use, b);
+                    break;
+                case IR_STMT_PRINT:
+                    scan_use(b, &stmt->val.print.atom);
+                    break;
+            }
+            for (; expr != NULL && expr->tag == IR_EXPR_ASSIGN; expr = expr->val.assign.value) {
+                scan_def(b, expr->val.assign.var);
+            }
+        }
+        ir_tail_each_atom(&block->tail, scan_use, b);
+    }
+}
+
+/*
+ * Backward dataflow of the globals live on entry to each block, iterated to a fixpoint in postorder.
+ */
+static void compute_liveness(struct ssa_builder *b) {
+    struct ir_fun *fun = b->fun;
+    ir_label *rpo = fun->rpo.data;
+    size_t words = set_words(b->num_globals);
+    uint64_t **defined = abc_pool_alloc(b->scratch, sizeof(uint64_t *), fun->rpo.len);
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        b->live_in[i] = set_alloc(b->scratch, words);
+        defined[i] = set_alloc(b->scratch, words);
+        for (size_t j = 0; j < b->upward_uses[i].len; j++) {
+            set_add(b->live_in[i], ((uint32_t *) b->upward_uses[i].data)[j]);
+        }
+        for (size_t j = 0; j < b->defs[i].len; j++) {
+            uint32_t global = b->global[((ir_var *) b->defs[i].data)[j]];
+            if (global != GLOBAL_NONE) {
+                set_add(defined[i], global);
+            }
+        }
+    }
+
+    uint64_t *out = set_alloc(b->scratch, words);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = fun->rpo.len; i-- > 0;) {
+            struct ir_block *block = ir_fun_block(fun, rpo[i]);
+            memset(out, 0, sizeof(uint64_t) * words);
+            for (size_t j = 0; j < block->succs.len; j++) {
+                uint32_t succ = ir_fun_block(fun, ((ir_label *) block->succs.data)[j])->rpo;
+                if (succ == IR_RPO_NONE) {
+                    continue; // the exit
+                }
+                for (size_t w = 0; w < words; w++) {
+                    out[w] |= b->live_in[succ][w];
+                }
+            }
+            for (size_t w = 0; w < words; w++) {
+                uint64_t in = b->live_in[i][w] | (out[w] & ~defined[i][w]);
+                if (in != b->live_in[i][w]) {
+                    b->live_in[i][w] = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Place the phis of every global on the iterated dominance frontier of its definitions, where it is live. A phi is a
+ * definition too, so its block joins the worklist. The phis hold the original variable until renaming.
+ */
+static void place_phis(struct ssa_builder *b) {
+    struct ir_fun *fun = b->fun;
+    struct abc_arr *frontiers = ir_cfg_compute_frontiers(fun, b->scratch);
+
+    // definition sites of every variable, in one array
+    size_t *def_start = abc_pool_alloc(b->scratch, sizeof(size_t), b->num_orig + 1);
+    memset(def_start, 0, sizeof(size_t) * (b->num_orig + 1));
+    for (size_t i = 0; i < fun->rpo.len; i++) {
+        for (size_t j = 0; j < b->defs[i].len; j++) {
+            def_start[((ir_var *) b->defs[i].data)[j] + 1]++;
+        }
+    }
+    for (ir_var var = 0; var < b->num_orig; var++) {
+        def_start[var + 1] += def_start[var];
+    }
+    uint32_t *def_sites = abc_pool_alloc(b->scratch, sizeof(uint32_t), def_start[b->num_orig] + 1);
+    size_t *def_fill = abc_pool_alloc(b->scratch, sizeof(size_t), b->num_orig + 1);
+    memcpy(def_fill, def_start, sizeof(size_t) * (b->num_orig + 1));
+    for (uint32_t i = 0; i < fun->rpo.len; i++) {
+        for (size_t j = 0; j < b->defs[i].len; j++) {
+            def_sites[def_fill[((ir_var *) b->defs[i].data)[j]]++] = i;
+        }
+    }
+
+    // per block the variable + 1 last given a phi there and last added to the worklist
+    uint32_t *has_phi = abc_pool_alloc(b->scratch, sizeof(uint32_t), fun->rpo.len);
+    uint32_t *in_work = abc_pool_alloc(b->scratch, sizeof(uint32_t), fun->rpo.len);
+    memset(has_phi, 0, sizeof(uint32_t) * fun->rpo.len);
+    memset(in_work, 0, sizeof(uint32_t) * fun->rpo.len);
+    struct abc_arr work;
+    abc_arr_init(&work, sizeof(uint32_t), b->scratch);
+    for (ir_var var = 0; var < b->num_orig; var++) {
+        uint32_t global = b->global[var];
+        if (global == GLOBAL_NONE) {
+            continue;
+        }
+        for (size_t i = def_start[var]; i < def_start[var + 1]; i++) {
+            in_work[def_sites[i]] = var + 1;
+            abc_arr_push(&work, &def_sites[i]);
+        }
+        while (work.len > 0) {
+            uint32_t pos = ((uint32_t *) work.data)[--work.len];
+            struct abc_arr *frontier = &frontiers[((ir_label *) fun->rpo.data)[pos]];
+            for (size_t i = 0; i < frontier->len; i++) {
+                struct ir_block *join = ir_fun_block(fun, ((ir_label *) frontier->data)[i]);
+                if (has_phi[join->rpo] == var + 1) {
+                    continue;
+                }
+                has_phi[join->rpo] = var + 1;
+                if (!set_has(b->live_in[join->rpo], global)) {
+                    continue;
+                }
+                struct ir_phi phi = {.var = var, .type = b->types[var]};
+                abc_arr_init_cap(&phi.args, sizeof(struct ir_phi_arg), join->preds.len, b->pool);
+                abc_arr_push(&join->phis, &phi);
+                if (in_work[join->rpo] != var + 1) {
+                    in_work[join->rpo] = var + 1;
+                    abc_arr_push(&work, &join->rpo);
+                }
+            }
+        }
+    }
+}
+
+static ir_var orig_var(struct ssa_builder *b, ir_var var) {
+    return var < b->num_orig ? var : ((ir_var *) b->origs.data)[var - b->num_orig];
+}
+
+static void set_curr(struct ssa_builder *b, ir_var var, struct ir_atom value) {
+    struct undo_entry entry = {.var = var, .prev = b->curr[var]};
+    abc_arr_push(&b->undo, &entry);
+    b->curr[var] = value;
+}
+
+// Name a new definition of the original variable var and make it current.
+static ir_var new_def(struct ssa_builder *b, ir_var var) {
+    ir_var def = var;
+    if (b->named[var]) {
+        def = b->fun->num_vars++;
+        abc_arr_push(&b->origs, &var);
+    }
+    b->named[var] = true;
+    set_curr(b, var, var_atom(def));
+    return def;
+}
+
+static void rename_use(void *ctx, struct ir_atom *atom) {
+    struct ssa_builder *b = ctx;
+    if (atom->tag == IR_ATOM_IDENTIFIER) {
+        *atom = b->curr[atom->val.var];
+    }
+}
+
+/*
+ * Define the targets of an assignment chain, the innermost first. It gets the value, the others a copy of it. Pushes
+ * one decl for each target onto stmts.
+ */
+static void define_targets(struct ssa_builder *b, struct abc_arr *stmts, struct ir_expr *value) {
+    ir_expr_each_atom(value, rename_use, b);
+    struct ir_expr init = *ir_expr_value(value);
+    ir_var *targets = b->targets.data;
+    for (size_t i = b->targets.len; i-- > 0;) {
+        ir_var var = targets[i];
+        struct ir_stmt stmt = {.tag = IR_STMT_DECL};
+        stmt.val.decl = (struct ir_stmt_decl) {.var = new_def(b, var), .type = b->types[var], .has_init = true};
+        stmt.val.decl.init = init;
+        abc_arr_push(stmts, &stmt);
+        init = (struct ir_expr) {.tag = IR_EXPR_ATOM, .type = b->types[var]};
+        init.val.atom.atom = var_atom(stmt.val.decl.var);
+    }
+}
+
+static void push_targets(struct ssa_builder *b, struct ir_expr *expr) {
+    for (; expr->tag == IR_EXPR_ASSIGN; expr = expr->val.assign.value) {
+        abc_arr_push(&b->targets, &expr->val.assign.var);
+    }
+}
+
+static void rename_block(struct ssa_builder *b, ir_label label) {
+    struct ir_fun *fun = b->fun;
+    struct ir_block *block = ir_fun_block(fun, label);
+    for (size_t i = 0; i < block->phis.len; i++) {
+        struct ir_phi *phi = (struct ir_phi *) block->phis.data + i;
+        phi->var = new_def(b, phi->var);
+    }
+
+    struct abc_arr stmts = block->stmts;
+    abc_arr_init_cap(&block->stmts, sizeof(struct ir_stmt), stmts.len, b->pool);
+    for (size_t i = 0; i < stmts.len; i++) {
+        struct ir_stmt stmt = ((struct ir_stmt *) stmts.data)[i];
+        b->targets.len = 0;
+        switch (stmt.tag) {
+            case IR_STMT_DECL:
+                if (!stmt.val.decl.has_init) {
+                    set_curr(b, stmt.val.decl.var, UNDEF);
+                    continue;
+                }
+                abc_arr_push(&b->targets, &stmt.val.decl.var);
+                push_targets(b, &stmt.val.decl.init);
+                define_targets(b, &block->stmts, &stmt.val.decl.init);
+                continue;
+            case IR_STMT_EXPR:
+                if (stmt.val.expr.expr.tag == IR_EXPR_ASSIGN) {
+                    push_targets(b, &stmt.val.expr.expr);
+                    define_targets(b, &block->stmts, &stmt.val.expr.expr);
+                    continue;
+                }
+                ir_expr_each_atom(&stmt.val.expr.expr, rename_use, b);
+                break;
+            case IR_STMT_PRINT:
+                rename_use(b, &stmt.val.print.atom);
+                break;
+        }
+        abc_arr_push(&block->stmts, &stmt);
+    }
+    ir_tail_each_atom(&block->tail, rename_use, b);
+
+    for (size_t i = 0; i < block->succs.len; i++) {
+        struct ir_block *succ = ir_fun_block(fun, ((ir_label *) block->succs.data)[i]);
+        for (size_t j = 0; j < succ->phis.len; j++) {
+            struct ir_phi *phi = (struct ir_phi *) succ->phis.data + j;
+            struct ir_phi_arg arg = {.pred = label, .atom = b->curr[orig_var(b, phi->var)]};
+            abc_arr_push(&phi->args, &arg);
+        }
+    }
+}
+
+static void rename_vars(struct ssa_builder *b) {
+    struct ir_fun *fun = b->fun;
+    for (ir_var var = 0; var < b->num_orig; var++) {
+        b->curr[var] = UNDEF;
+        b->named[var] = false;
+    }
+    for (size_t i = 0; i < fun->args.len; i++) {
+        ir_var var = ((struct ir_param *) fun->args.data)[i].var;
+        b->curr[var] = var_atom(var);
+        b->named[var] = true;
+    }
+
+    struct abc_arr stack;
+    abc_arr_init(&stack, sizeof(struct rename_frame), b->scratch);
+    struct rename_frame root = {.block = fun->entry, .done = false};
+    abc_arr_push(&stack, &root);
+    while (stack.len > 0) {
+        struct rename_frame frame = ((struct rename_frame *) stack.data)[--stack.len];
+        if (frame.done) {
+            while (b->undo.len > frame.undo_mark) {
+                struct undo_entry *entry = (struct undo_entry *) b->undo.data + --b->undo.len;
+                b->curr[entry->var] = entry->prev;
+            }
+            continue;
+        }
+        frame.undo_mark = b->undo.len;
+        frame.done = true;
+        rename_block(b, frame.block);
+        abc_arr_push(&stack, &frame);
+        for (ir_label child = ir_fun_block(fun, frame.block)->dom_child; child != IR_LABEL_NONE;
+             child = ir_fun_block(fun, child)->dom_sibling) {
+            struct rename_frame next = {.block = child, .done = false};
+            abc_arr_push(&stack, &next);
+        }
+    }
+}
+
+static void construct_fun(struct ir_fun *fun, struct abc_pool *pool) {
+    assert(!fun->ssa);
+    // cut off unreachable blocks, so every predecessor of a block with phis gets renamed
+    ir_cfg_remove_unreachable(fun);
+    ir_cfg_compute_dominators(fun);
+
+    struct ssa_builder b = {.fun = fun, .pool = pool, .scratch = abc_pool_create(), .num_orig = fun->num_vars};
+    size_t num_vars = b.num_orig > 0 ? b.num_orig : 1;
+    b.types = abc_pool_alloc(b.scratch, sizeof(enum abc_type), num_vars);
+    b.stamp = abc_pool_alloc(b.scratch, sizeof(uint32_t), num_vars);
+    b.global = abc_pool_alloc(b.scratch, sizeof(uint32_t), num_vars);
+    b.curr = abc_pool_alloc(b.scratch, sizeof(struct ir_atom), num_vars);
+    b.named = abc_pool_alloc(b.scratch, sizeof(bool), num_vars);
+    for (ir_var var = 0; var < b.num_orig; var++) {
+        b.types[var] = ABC_TYPE_INT;
+        b.stamp[var] = 0;
+        b.global[var] = GLOBAL_NONE;
+    }
+    b.defs = abc_pool_alloc(b.scratch, sizeof(struct abc_arr), fun->rpo.len);
+    b.upward_uses = abc_pool_alloc(b.scratch, sizeof(struct abc_arr), fun->rpo.len);
+    b.live_in = abc_pool_alloc(b.scratch, sizeof(uint64_t *), fun->rpo.len);
+    abc_arr_init(&b.origs, sizeof(ir_var), b.scratch);
+    abc_arr_init(&b.undo, sizeof(struct undo_entry), b.scratch);
+    abc_arr_init(&b.targets, sizeof(ir_var), b.scratch);
+
+    scan_blocks(&b);
+    compute_liveness(&b);
+    place_phis(&b);
+    rename_vars(&b);
+    fun->ssa = true;
+    abc_pool_destroy(b.scratch);
+}
+
+void ir_ssa_construct(struct ir_program *program, struct abc_pool *pool) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        construct_fun((struct ir_fun *) program->ir_funs.data + i, pool);
+    }
+}
+
+/* DESTRUCTION */
+
+struct copy {
+    ir_var dest;
+    enum abc_type type;
+    struct ir_atom src;
+};
+
+struct ssa_destructor {
+    struct ir_fun *fun;
+    struct abc_pool *pool; // of the program
+    // by variable, for the variables before destruction
+    uint32_t *reads; // pending copies reading it
+    uint32_t *writer; // index of the pending copy writing it, or COPY_NONE
+    ir_var *loc; // where its value is found now
+    // scratch for one predecessor
+    struct abc_arr copies; // copy
+    struct abc_arr ready; // size_t, copies whose destination is no longer read
+    struct abc_arr done; // bool, by copy
+    struct abc_arr queued; // bool, by copy, pushed onto ready
+};
+
+static struct ir_expr atom_expr(struct ir_atom atom, enum abc_type type) {
+    struct ir_expr expr = {.tag = IR_EXPR_ATOM, .type = type};
+    expr.val.atom.atom = atom;
+    return expr;
+}
+
+static void push_copy_stmt(struct ssa_destructor *d, struct ir_block *block, ir_var dest, enum abc_type type,
+                           struct ir_atom src) {
+    struct ir_expr *value = abc_pool_alloc(d->pool, sizeof(struct ir_expr), 1);
+    *value = atom_expr(src, type);
+    struct ir_stmt stmt = {.tag = IR_STMT_EXPR};
+    stmt.val.expr.expr = (struct ir_expr) {.tag = IR_EXPR_ASSIGN, .type = type};
+    stmt.val.expr.expr.val.assign.var = dest;
+    stmt.val.expr.expr.val.assign.value = value;
+    abc_arr_push(&block->stmts, &stmt);
+}
+
+static void mark_ready(struct ssa_destructor *d, size_t i) {
+    bool *queued = d->queued.data;
+    if (!queued[i]) {
+        queued[i] = true;
+        abc_arr_push(&d->ready, &i);
+    }
+}
+
+/*
+ * Sequentialize the parallel copies of d->copies at the end of block. A copy is emitted once nothing reads its
+ * destination anymore. When only cycles are left one destination is saved in a temporary first, after which the
+ * copies reading it take it from there. Copies of constants read nothing and come last.
+ */
+static void sequentialize(struct ssa_destructor *d, struct ir_block *block) {
+    struct copy *copies = d->copies.data;
+    size_t n = d->copies.len;
+    d->done.len = 0;
+    d->queued.len = 0;
+    for (size_t i = 0; i < n; i++) {
+        bool done = copies[i].src.tag != IR_ATOM_IDENTIFIER || copies[i].src.val.var == copies[i].dest;
+        bool queued = false;
+        abc_arr_push(&d->done, &done);
+        abc_arr_push(&d->queued, &queued);
+    }
+    bool *done = d->done.data;
+    size_t left = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!done[i]) {
+            d->writer[copies[i].dest] = (uint32_t) i;
+            d->reads[copies[i].src.val.var]++;
+            left++;
+        }
+    }
+    d->ready.len = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!done[i] && d->reads[copies[i].dest] == 0) {
+            mark_ready(d, i);
+        }
+    }
+
+    size_t cursor = 0;
+    while (left > 0) {
+        while (d->ready.len > 0) {
+            size_t i = ((size_t *) d->ready.data)[--d->ready.len];
+            ir_var src = copies[i].src.val.var;
+            push_copy_stmt(d, block, copies[i].dest, copies[i].type, var_atom(d->loc[src]));
+            done[i] = true;
+            left--;
+            d->writer[copies[i].dest] = COPY_NONE;
+            if (--d->reads[src] == 0 && d->writer[src] != COPY_NONE) {
+                mark_ready(d, d->writer[src]);
+            }
+        }
+        if (left == 0) {
+            break;
+        }
+        // only cycles are left, break one open
+        while (done[cursor]) {
+            cursor++;
+        }
+        ir_var dest = copies[cursor].dest;
+        ir_var tmp = d->fun->num_vars++;
+        struct ir_stmt stmt = {.tag = IR_STMT_DECL};
+        stmt.val.decl = (struct ir_stmt_decl) {.var = tmp, .type = copies[cursor].type, .has_init = true};
+        stmt.val.decl.init = atom_expr(var_atom(dest), copies[cursor].type);
+        abc_arr_push(&block->stmts, &stmt);
+        d->loc[dest] = tmp;
+        mark_ready(d, cursor);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (copies[i].src.tag == IR_ATOM_INT_LIT) {
+            push_copy_stmt(d, block, copies[i].dest, copies[i].type, copies[i].src);
+        } else {
+            d->reads[copies[i].src.val.var] = 0;
+            d->loc[copies[i].src.val.var] = copies[i].src.val.var;
+            d->loc[copies[i].dest] = copies[i].dest;
+        }
+    }
+}
+
+static void destruct_fun(struct ir_fun *fun, struct abc_pool *pool) {
+    assert(fun->ssa);
+    struct abc_pool *scratch = abc_pool_create();
+    struct abc_arr preds;
+    abc_arr_init(&preds, sizeof(ir_label), scratch);
+
+    // Copies go at the end of the predecessors, which must not have another successor the copies could be wrong for.
+    // Edges out of conditional jumps get a block of their own, which also keeps the condition from being overwritten.
+    size_t num_blocks = fun->blocks.len;
+    for (ir_label label = 0; label < num_blocks; label++) {
+        if (ir_fun_block(fun, label)->phis.len == 0) {
+            continue;
+        }
+        preds.len = 0;
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (size_t i = 0; i < block->preds.len; i++) {
+            abc_arr_push(&preds, (ir_label *) block->preds.data + i);
+        }
+        for (size_t i = 0; i < preds.len; i++) {
+            ir_label pred = ((ir_label *) preds.data)[i];
+            if (ir_fun_block(fun, pred)->tail.tag == IR_TAIL_GOTO) {
+                continue;
+            }
+            ir_label mid = ir_cfg_split_edge(fun, pred, label, pool);
+            block = ir_fun_block(fun, label);
+            for (size_t j = 0; j < block->phis.len; j++) {
+                struct ir_phi *phi = (struct ir_phi *) block->phis.data + j;
+                for (size_t k = 0; k < phi->args.len; k++) {
+                    struct ir_phi_arg *arg = (struct ir_phi_arg *) phi->args.data + k;
+                    if (arg->pred == pred) {
+                        arg->pred = mid;
+                    }
+                }
+            }
+        }
+    }
+
+    struct ssa_destructor d = {.fun = fun, .pool = pool};
+    size_t num_vars = fun->num_vars > 0 ? fun->num_vars : 1;
+    d.reads = abc_pool_alloc(scratch, sizeof(uint32_t), num_vars);
+    d.writer = abc_pool_alloc(scratch, sizeof(uint32_t), num_vars);
+    d.loc = abc_pool_alloc(scratch, sizeof(ir_var), num_vars);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        d.reads[var] = 0;
+        d.writer[var] = COPY_NONE;
+        d.loc[var] = var;
+    }
+    abc_arr_init(&d.copies, sizeof(struct copy), scratch);
+    abc_arr_init(&d.ready, sizeof(size_t), scratch);
+    abc_arr_init(&d.done, sizeof(bool), scratch);
+    abc_arr_init(&d.queued, sizeof(bool), scratch);
+    for (ir_label label = 0; label < fun->blocks.len; label++) {
+        struct ir_block *block = ir_fun_block(fun, label);
+        for (size_t i = 0; i < block->preds.len && block->phis.len > 0; i++) {
+            ir_label pred = ((ir_label *) block->preds.data)[i];
+            d.copies.len = 0;
+            for (size_t j = 0; j < block->phis.len; j++) {
+                struct ir_phi *phi = (struct ir_phi *) block->phis.data + j;
+                for (size_t k = 0; k < phi->args.len; k++) {
+                    struct ir_phi_arg *arg = (struct ir_phi_arg *) phi->args.data + k;
+                    if (arg->pred == pred) {
+                        struct copy copy = {.dest = phi->var, .type = phi->type, .src = arg->atom};
+                        abc_arr_push(&d.copies, &copy);
+                        break;
+                    }
+                }
+            }
+            sequentialize(&d, ir_fun_block(fun, pred));
+        }
+        block->phis.len = 0;
+    }
+
+    // the blocks of split edges that got no copies are jumped past again
+    ir_cfg_simplify(fun, scratch);
+    fun->ssa = false;
+    abc_pool_destroy(scratch);
+}
+
+void ir_ssa_destruct(struct ir_program *program, struct abc_pool *pool) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        destruct_fun((struct ir_fun *) program->ir_funs.data + i, pool);
+    }
+}
@@ -0,0 +1,28 @@
+/**
+ * Static single assignment form of the IR.
+ *
+ * In SSA form every variable is a parameter or is defined by exactly one decl with an initializer or phi, and
+ * assignments do not occur. Phis sit at the start of join points and pick the value of the edge that was taken, reading
+ * variables that go uninitialized on some path as 0. The form has to be left again before translating to x64.
+ */
+
+#ifndef IR_SSA_H
+#define IR_SSA_H
+
+#include "../data/abc_pool.h"
+#include "ir.h"
+
+/*
+ * Rewrite every function into pruned SSA form: phis are only placed where the variable is live. Blocks that cannot be
+ * reached are emptied and cut off. New variables and phis are allocated in pool.
+ */
+void ir_ssa_construct(struct ir_program *program, struct abc_pool *pool);
+
+/*
+ * Replace the phis by copies at the end of the predecessors, splitting edges out of conditional jumps. The copies of
+ * a predecessor happen in parallel, so they are ordered such that no value is overwritten before it is read, going
+ * through a temporary variable where they form a cycle.
+ */
+void ir_ssa_destruct(struct ir_program *program, struct abc_pool *pool);
+
+#endif // IR_SSA_H
@@ -0,0 +1,78 @@
+/**
+ * The arguments are evaluated into new variables before any parameter is assigned, as they can read the parameters.
+ * Copies that turn out unnecessary, like a parameter passed on unchanged, are cleaned up by the optimizations on SSA
+ * form.
+ */
+
+#include "ir_tailcall.h"
+
+#include <assert.h>
+
+#include "ir_cfg.h"
+
+static void tailcall_fun(struct ir_fun *fun, struct abc_pool *pool) {
+    assert(!fun->ssa);
+    ir_label start = IR_LABEL_NONE;
+    size_t num_reachable = fun->rpo.len;
+    for (size_t i = 0; i < num_reachable; i++) {
+        ir_label label = ((ir_label *) fun->rpo.data)[i];
+        struct ir_expr_call *call = ir_block_tail_call(fun, label);
+        if (call == NULL || call->label != fun->label) {
+            continue;
+        }
+
+        if (start == IR_LABEL_NONE) {
+            // the code of the entry moves to a new block, parameters are assigned on the edges back to it
+            start = ir_cfg_new_block(fun, pool);
+            struct ir_block *entry = ir_fun_block(fun, fun->entry);
+            struct ir_block *moved = ir_fun_block(fun, start);
+            struct abc_arr stmts = moved->stmts;
+            moved->stmts = entry->stmts;
+            entry->stmts = stmts;
+            struct ir_tail tail = entry->tail;
+            ir_cfg_set_tail(fun, fun->entry, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = start});
+            ir_cfg_set_tail(fun, start, tail);
+        }
+        if (label == fun->entry) {
+            label = start;
+        }
+
+        struct ir_block *block = ir_fun_block(fun, label);
+        struct abc_arr args = call->args;
+        block->stmts.len--;
+        ir_var first_tmp = fun->num_vars;
+        for (size_t j = 0; j < args.len; j++) {
+            struct ir_param param = ((struct ir_param *) fun->args.data)[j];
+            struct ir_stmt decl = {.tag = IR_STMT_DECL,
+                                   .val.decl = {.var = fun->num_vars++,
+                                                .type = param.type,
+                                                .has_init = true,
+                                                .init = {.tag = IR_EXPR_ATOM,
+                                                         .type = param.type,
+                                                         .val.atom.atom = ((struct ir_atom *) args.data)[j]}}};
+            abc_arr_push(&block->stmts, &decl);
+        }
+        for (size_t j = 0; j < args.len; j++) {
+            struct ir_param param = ((struct ir_param *) fun->args.data)[j];
+            struct ir_expr *value = abc_pool_alloc(pool, sizeof(struct ir_expr), 1);
+            *value = (struct ir_expr) {.tag = IR_EXPR_ATOM,
+                                       .type = param.type,
+                                       .val.atom.atom = {.tag = IR_ATOM_IDENTIFIER, .val.var = first_tmp + j}};
+            struct ir_stmt assign = {.tag = IR_STMT_EXPR,
+                                     .val.expr.expr = {.tag = IR_EXPR_ASSIGN,
+                                                       .type = param.type,
+                                                       .val.assign = {.var = param.var, .value = value}}};
+            abc_arr_push(&block->stmts, &assign);
+        }
+        ir_cfg_set_tail(fun, label, (struct ir_tail) {.tag = IR_TAIL_GOTO, .val.go_to.label = start});
+    }
+    if (start != IR_LABEL_NONE) {
+        ir_cfg_simplify(fun, pool);
+    }
+}
+
+void ir_tailcall_program(struct ir_program *program, struct abc_pool *pool) {
+    for (size_t i = 0; i < program->ir_funs.len; i++) {
+        tailcall_fun((struct ir_fun *) program->ir_funs.data + i, pool);
+    }
+}
@@ -0,0 +1,23 @@
+/**
+ * Tail recursion elimination on the IR.
+ *
+ * A function that returns the result of calling itself does not need its own frame any more at that point, so the
+ * call becomes a jump back to the start of the function with the parameters set to the arguments. Recursion in tail
+ * position then runs as a loop, in constant stack space.
+ */
+
+#ifndef IR_TAILCALL_H
+#define IR_TAILCALL_H
+
+#include "../data/abc_pool.h"
+#include "ir.h"
+
+/*
+ * Turn the calls of every function to itself whose value is returned right away, or that a void function makes right
+ * before returning, into assignments of the arguments to the parameters and a jump to the block the entry used to
+ * be. The entry itself only jumps there afterwards, so it stays without predecessors. New blocks, statements and
+ * variables are allocated in pool. The functions must not be in SSA form.
+ */
+void ir_tailcall_program(struct ir_program *program, struct abc_pool *pool);
+
+#endif // IR_TAILCALL_H
@@ -7,7 +7,7 @@
 #include "x64_regalloc.h"
 
 #include <assert.h>
-#include <string.h>
+#include <stdlib.h>
 
 void x64_translator_init(struct x64_translator *t) {
     t->pool = abc_pool_create();
@@ -38,10 +38,7 @@ struct x64_program x64_translate(struct x64_translator *t, struct ir_program *pr
 /* FUNCTIONS */
 
 static void create_init_block(struct x64_translator *t, struct ir_fun *ir_fun) {
-    int len = snprintf(NULL, 0, "%s_init", ir_fun->label);
-    char *label = abc_pool_alloc(t->pool, len + 1, 1);
-    snprintf(label, len + 1, "%s_init", ir_fun->label);
-    struct x64_block block = {.label = label};
+    struct x64_block block = {.label.tag = X64_LABEL_INIT};
     abc_arr_init(&block.x64_instrs, sizeof(struct x64_instr), t->pool);
     t->curr_block = abc_arr_push(&t->curr_fun->x64_blocks, &block);
 
@@ -50,23 +47,23 @@ static void create_init_block(struct x64_translator *t, struct ir_fun *ir_fun) {
         if (i < 4) {
             // rdi to rcx
             struct x64_instr mov = {.tag = X64_INSTR_BIN, .val.bin.tag = X64_BIN_MOVQ};
-            mov.val.bin.right.tag = X64_ARG_STR;
-            mov.val.bin.right.val.str.str = arg->label;
+            mov.val.bin.right.tag = X64_ARG_VAR;
+            mov.val.bin.right.val.var.var = arg->var;
             mov.val.bin.left = X64_REGS[X64_REG_RDI - i];
             abc_arr_push(&t->curr_block->x64_instrs, &mov);
         } else if (i < 6) {
             // r8 to r9
             struct x64_instr mov = {.tag = X64_INSTR_BIN, .val.bin.tag = X64_BIN_MOVQ};
-            mov.val.bin.right.tag = X64_ARG_STR;
-            mov.val.bin.right.val.str.str = arg->label;
+            mov.val.bin.right.tag = X64_ARG_VAR;
+            mov.val.bin.right.val.var.var = arg->var;
             mov.val.bin.left = X64_REGS[X64_REG_R8 + (i - 4)];
             abc_arr_push(&t->curr_block->x64_instrs, &mov);
         } else {
             int num_spilled = (int) ir_fun->args.len - 6;
             int offset = X64_STACK_PARAM_OFFSET + (num_spilled - (i - 6 + 1)) * X64_VAR_SIZE;
             struct x64_instr mov = {.tag = X64_INSTR_BIN, .val.bin.tag = X64_BIN_MOVQ};
-            mov.val.bin.right.tag = X64_ARG_STR;
-            mov.val.bin.right.val.str.str = arg->label;
+            mov.val.bin.right.tag = X64_ARG_VAR;
+            mov.val.bin.right.val.var.var = arg->var;
             mov.val.bin.left.tag = X64_ARG_DEREF;
             mov.val.bin.left.val.deref.offset = offset;
             mov.val.bin.left.val.deref.reg = X64_REG_RBP;
@@ -75,16 +72,8 @@ static void create_init_block(struct x64_translator *t, struct ir_fun *ir_fun) {
     }
 }
 
-static char *create_prelude_label(struct x64_translator *t, char *fun_name) {
-    int len = snprintf(NULL, 0, "%s_prelude", fun_name);
-    char *prelude = abc_pool_alloc(t->pool, len + 1, 1);
-    snprintf(prelude, len + 1, "%s_prelude", fun_name);
-    return prelude;
-}
-
-static void create_prelude(struct x64_translator *t, struct ir_fun *ir_fun, struct x64_regalloc *regalloc) {
-    char *label = create_prelude_label(t, ir_fun->label);
-    struct x64_block block = {.label = label};
+static void create_prelude(struct x64_translator *t, struct x64_regalloc *regalloc) {
+    struct x64_block block = {.label.tag = X64_LABEL_PRELUDE};
     abc_arr_init(&block.x64_instrs, sizeof(struct x64_instr), t->pool);
     // insert block at start
     t->curr_block = abc_arr_insert_before_ptr(&t->curr_fun->x64_blocks, t->curr_fun->x64_blocks.data, &block);
@@ -117,35 +106,15 @@ static void create_prelude(struct x64_translator *t, struct ir_fun *ir_fun, stru
     }
 }
 
-static char *create_epilogue_label(struct x64_translator *t, char *fun_name) {
-    static char *curr_fun_name = NULL;
-    static char *cached = NULL;
-    if (curr_fun_name == NULL || strcmp(curr_fun_name, fun_name) != 0) {
-        curr_fun_name = fun_name;
-    } else {
-        return cached;
-    }
-    int len = snprintf(NULL, 0, "%s_epilogue", fun_name);
-    char *epilogue = abc_pool_alloc(t->pool, len + 1, 1);
-    snprintf(epilogue, len + 1, "%s_epilogue", fun_name);
-    cached = epilogue;
-    return epilogue;
-}
-
-static void create_epilogue(struct x64_translator *t, char *fun_name, struct x64_regalloc *regalloc) {
-    char *label = create_epilogue_label(t, fun_name);
-    struct x64_block block = {.label = label};
-    abc_arr_init(&block.x64_instrs, sizeof(struct x64_instr), t->pool);
-    // insert at end
-    t->curr_block = abc_arr_push(&t->curr_fun->x64_blocks, &block);
-
+// Undo the prelude, leaving the return address on top of the stack.
+static void push_teardown(struct x64_regalloc *regalloc, struct abc_arr *instrs) {
     // restore callee saved, in reverse order
     for (size_t i = 0; i < regalloc->callee_saved_allocs.len; i++) {
         struct x64_arg *saved =
                 (struct x64_arg *) regalloc->callee_saved_allocs.data + (regalloc->callee_saved_allocs.len - (i + 1));
         struct x64_instr instr = {.tag = X64_INSTR_STACK, .val.stack.tag = X64_STACK_POPQ};
         instr.val.stack.arg = *saved;
-        abc_arr_push(&t->curr_block->x64_instrs, &instr);
+        abc_arr_push(instrs, &instr);
     }
 
     // space for spilled variables (and alignment)
@@ -159,23 +128,48 @@ static void create_epilogue(struct x64_translator *t, char *fun_name, struct x64
     restore_instr.val.bin.right = X64_RSP;
     restore_instr.val.bin.left.tag = X64_ARG_IMM;
     restore_instr.val.bin.left.val.imm.imm = offset;
-    abc_arr_push(&t->curr_block->x64_instrs, &restore_instr);
+    abc_arr_push(instrs, &restore_instr);
 
-    // restore base pointer and return
+    // restore base pointer
     struct x64_instr instr = {.tag = X64_INSTR_STACK, .val.stack.tag = X64_STACK_POPQ};
     instr.val.stack.arg = X64_RBP;
-    abc_arr_push(&t->curr_block->x64_instrs, &instr);
-    instr.tag = X64_INSTR_NOARG;
-    instr.val.noarg.tag = X64_NOARG_RETQ;
+    abc_arr_push(instrs, &instr);
+}
+
+static void create_epilogue(struct x64_translator *t, struct x64_regalloc *regalloc) {
+    struct x64_block block = {.label.tag = X64_LABEL_EPILOGUE};
+    abc_arr_init(&block.x64_instrs, sizeof(struct x64_instr), t->pool);
+    // insert at end
+    t->curr_block = abc_arr_push(&t->curr_fun->x64_blocks, &block);
+
+    push_teardown(regalloc, &t->curr_block->x64_instrs);
+    struct x64_instr instr = {.tag = X64_INSTR_NOARG, .val.noarg.tag = X64_NOARG_RETQ};
     abc_arr_push(&t->curr_block->x64_instrs, &instr);
 }
 
+// A tail call ends its block, the frame is torn down right before it like for a return.
+static void expand_tail_calls(struct x64_translator *t, struct x64_regalloc *regalloc) {
+    for (size_t i = 0; i < t->curr_fun->x64_blocks.len; i++) {
+        struct x64_block *block = (struct x64_block *) t->curr_fun->x64_blocks.data + i;
+        if (block->x64_instrs.len == 0) {
+            continue;
+        }
+        struct x64_instr call = ((struct x64_instr *) block->x64_instrs.data)[block->x64_instrs.len - 1];
+        if (call.tag != X64_INSTR_TAILCALL) {
+            continue;
+        }
+        block->x64_instrs.len--;
+        push_teardown(regalloc, &block->x64_instrs);
+        abc_arr_push(&block->x64_instrs, &call);
+    }
+}
+
 /* REGISTER ALLOCATION */
 
 static void x64_assign_homes_arg(struct x64_translator *t, struct x64_regalloc *regalloc, struct x64_arg *arg) {
     (void) t;
-    if (arg->tag == X64_ARG_STR) {
-        struct x64_arg *new_arg = x64_regalloc_get_arg(regalloc, arg->val.str.str);
+    if (arg->tag == X64_ARG_VAR) {
+        struct x64_arg *new_arg = x64_regalloc_get_arg(regalloc, arg->val.var.var);
         assert(new_arg != NULL);
         *arg = *new_arg;
     }
@@ -203,6 +197,7 @@ static void x64_assign_homes_instr(struct x64_translator *t, struct x64_regalloc
         case X64_INSTR_MOVZBQ:
         case X64_INSTR_LEAQ:
         case X64_INSTR_CALLQ:
+        case X64_INSTR_TAILCALL:
             break;
     }
 }
@@ -244,20 +239,25 @@ static void x64_program_patch_fun(struct x64_translator *t, struct x64_fun *fun)
     }
 }
 
-static void x64_program_translate_block(struct x64_translator *t, struct ir_block *ir_block);
+static void x64_program_translate_block(struct x64_translator *t, struct ir_fun *ir_fun, struct ir_block *ir_block,
+                                        ir_label next);
 static void x64_program_translate_fun(struct x64_translator *t, struct ir_fun *ir_fun) {
     // init
+    assert(!ir_fun->ssa);
     t->curr_fun->label = ir_fun->label;
+    t->curr_fun->num_vars = ir_fun->num_vars;
     abc_arr_init(&t->curr_fun->x64_blocks, sizeof(struct x64_block), t->pool);
     create_init_block(t, ir_fun);
 
-    // fun translation
-    for (size_t i = 0; i < ir_fun->blocks.len; i++) {
-        struct ir_block *ir_block = ((struct ir_block *) ir_fun->blocks.data) + i;
-        struct x64_block block = {.label = ir_block->label};
+    // fun translation, blocks are laid out in reverse postorder, the epilogue follows the last one
+    ir_label *rpo = ir_fun->rpo.data;
+    for (size_t i = 0; i < ir_fun->rpo.len; i++) {
+        struct ir_block *ir_block = ir_fun_block(ir_fun, rpo[i]);
+        struct x64_block block = {.label = {.tag = X64_LABEL_BLOCK, .block = ir_block->label}};
         abc_arr_init(&block.x64_instrs, sizeof(struct x64_instr), t->pool);
         t->curr_block = abc_arr_push(&t->curr_fun->x64_blocks, &block);
-        x64_program_translate_block(t, ir_block);
+        ir_label next = i + 1 < ir_fun->rpo.len ? rpo[i + 1] : ir_fun->exit;
+        x64_program_translate_block(t, ir_fun, ir_block, next);
     }
 
     // register allocation
@@ -269,8 +269,9 @@ static void x64_program_translate_fun(struct x64_translator *t, struct ir_fun *i
     x64_program_patch_fun(t, t->curr_fun);
 
     // end
-    create_prelude(t, ir_fun, &regalloc);
-    create_epilogue(t, ir_fun->label, &regalloc);
+    create_prelude(t, &regalloc);
+    create_epilogue(t, &regalloc);
+    expand_tail_calls(t, &regalloc);
     abc_pool_destroy(allocator);
 }
 
@@ -278,13 +279,75 @@ static void x64_program_translate_fun(struct x64_translator *t, struct ir_fun *i
 
 static void x64_program_translate_stmt(struct x64_translator *t, struct ir_stmt *ir_stmt);
 static void x64_program_translate_tail(struct x64_translator *t, struct ir_tail *ir_tail);
-static void x64_program_translate_block(struct x64_translator *t, struct ir_block *ir_block) {
-    for (size_t i = 0; i < ir_block->stmts.len; i++) {
+static void x64_program_translate_tail_call(struct x64_translator *t, struct ir_fun *ir_fun,
+                                            struct ir_expr_call *expr);
+
+static bool x64_label_eq(struct x64_label a, struct x64_label b) {
+    return a.tag == b.tag && (a.tag != X64_LABEL_BLOCK || a.block == b.block);
+}
+
+static enum x64_cc x64_cc_negate(enum x64_cc code) {
+    switch (code) {
+        case X64_CC_E:
+            return X64_CC_NE;
+        case X64_CC_NE:
+            return X64_CC_E;
+        case X64_CC_L:
+            return X64_CC_GE;
+        case X64_CC_LE:
+            return X64_CC_G;
+        case X64_CC_G:
+            return X64_CC_LE;
+        case X64_CC_GE:
+            return X64_CC_L;
+    }
+    assert(0);
+    abort();
+}
+
+/*
+ * next is the block emitted after this one, or the exit when the epilogue follows. A final jump to it is left out.
+ * Ending in a conditional jump to it and a jump elsewhere, the condition is inverted instead. A block ending in a call
+ * whose value is returned jumps to the function instead, when its stack arguments fit in the caller's.
+ */
+static void x64_program_translate_block(struct x64_translator *t, struct ir_fun *ir_fun, struct ir_block *ir_block,
+                                        ir_label next) {
+    struct ir_expr_call *tail_call = ir_block_tail_call(ir_fun, ir_block->label);
+    if (tail_call != NULL && tail_call->args.len > 6 && tail_call->args.len != ir_fun->args.len) {
+        tail_call = NULL;
+    }
+    size_t num_stmts = ir_block->stmts.len - (tail_call != NULL ? 1 : 0);
+    for (size_t i = 0; i < num_stmts; i++) {
         struct ir_stmt *stmt = ((struct ir_stmt *) ir_block->stmts.data) + i;
         x64_program_translate_stmt(t, stmt);
     }
-    if (ir_block->has_tail) {
-        x64_program_translate_tail(t, &ir_block->tail);
+    if (tail_call != NULL) {
+        x64_program_translate_tail_call(t, ir_fun, tail_call);
+        return;
+    }
+    x64_program_translate_tail(t, &ir_block->tail);
+
+    struct x64_instr *last = (struct x64_instr *) t->curr_block->x64_instrs.data + t->curr_block->x64_instrs.len - 1;
+    struct x64_label fall_through = {.tag = X64_LABEL_BLOCK, .block = next};
+    if (next == ir_fun->exit) {
+        fall_through = (struct x64_label) {.tag = X64_LABEL_EPILOGUE};
+    }
+    if (last->tag != X64_INSTR_JMP) {
+        return;
+    }
+    if (x64_label_eq(last->val.jmp.label, fall_through)) {
+        t->curr_block->x64_instrs.len--;
+        return;
+    }
+    // a conditional jump to the next block followed by a jump elsewhere becomes the opposite conditional jump
+    if (t->curr_block->x64_instrs.len < 2) {
+        return;
+    }
+    struct x64_instr *cond = last - 1;
+    if (cond->tag == X64_INSTR_JMPCC && x64_label_eq(cond->val.jmpcc.label, fall_through)) {
+        cond->val.jmpcc.code = x64_cc_negate(cond->val.jmpcc.code);
+        cond->val.jmpcc.label = last->val.jmp.label;
+        t->curr_block->x64_instrs.len--;
     }
 }
 
@@ -298,8 +361,8 @@ static void x64_program_translate_stmt(struct x64_translator *t, struct ir_stmt
             if (ir_stmt->val.decl.has_init) {
                 x64_program_translate_expr(t, &ir_stmt->val.decl.init);
                 instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
-                instr.val.bin.right.tag = X64_ARG_STR;
-                instr.val.bin.right.val.str.str = ir_stmt->val.decl.label;
+                instr.val.bin.right.tag = X64_ARG_VAR;
+                instr.val.bin.right.val.var.var = ir_stmt->val.decl.var;
                 instr.val.bin.left.tag = X64_ARG_REG;
                 instr.val.bin.left.val.reg.reg = X64_REG_RAX;
                 abc_arr_push(&t->curr_block->x64_instrs, &instr);
@@ -350,7 +413,7 @@ static void x64_program_translate_tail(struct x64_translator *t, struct ir_tail
     switch (ir_tail->tag) {
         case IR_TAIL_GOTO:
             instr.tag = X64_INSTR_JMP;
-            instr.val.jmp.label = ir_tail->val.go_to.label;
+            instr.val.jmp.label = (struct x64_label) {.tag = X64_LABEL_BLOCK, .block = ir_tail->val.go_to.label};
             abc_arr_push(&t->curr_block->x64_instrs, &instr);
             break;
         case IR_TAIL_RET:
@@ -362,7 +425,7 @@ static void x64_program_translate_tail(struct x64_translator *t, struct ir_tail
                 abc_arr_push(&t->curr_block->x64_instrs, &instr);
             }
             instr.tag = X64_INSTR_JMP;
-            instr.val.jmp.label = create_epilogue_label(t, t->curr_fun->label);
+            instr.val.jmp.label = (struct x64_label) {.tag = X64_LABEL_EPILOGUE};
             abc_arr_push(&t->curr_block->x64_instrs, &instr);
             break;
         case IR_TAIL_IF:
@@ -373,10 +436,12 @@ static void x64_program_translate_tail(struct x64_translator *t, struct ir_tail
             abc_arr_push(&t->curr_block->x64_instrs, &instr);
             instr.tag = X64_INSTR_JMPCC;
             instr.val.jmpcc.code = X64_CC_E;
-            instr.val.jmpcc.label = ir_tail->val.if_then_else.then_label;
+            instr.val.jmpcc.label =
+                    (struct x64_label) {.tag = X64_LABEL_BLOCK, .block = ir_tail->val.if_then_else.then_label};
             abc_arr_push(&t->curr_block->x64_instrs, &instr);
             instr.tag = X64_INSTR_JMP;
-            instr.val.jmp.label = ir_tail->val.if_then_else.else_label;
+            instr.val.jmp.label =
+                    (struct x64_label) {.tag = X64_LABEL_BLOCK, .block = ir_tail->val.if_then_else.else_label};
             abc_arr_push(&t->curr_block->x64_instrs, &instr);
             break;
         default:
@@ -394,6 +459,7 @@ static void x64_program_translate_call_expr(struct x64_translator *t, struct ir_
 static void x64_program_translate_expr(struct x64_translator *t, struct ir_expr *expr) {
     struct x64_instr instr;
     struct x64_arg lhs;
+    struct abc_arr vars;
     switch (expr->tag) {
         case IR_EXPR_BIN:
             x64_program_translate_bin_expr(t, &expr->val.bin);
@@ -415,11 +481,20 @@ static void x64_program_translate_expr(struct x64_translator *t, struct ir_expr
             x64_program_translate_call_expr(t, &expr->val.call);
             break;
         case IR_EXPR_ASSIGN:
-            x64_program_translate_expr(t, expr->val.assign.value);
-            instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
-            instr.val.bin.right.tag = X64_ARG_STR, instr.val.bin.right.val.str.str = expr->val.assign.label;
-            instr.val.bin.left = X64_RAX;
-            abc_arr_push(&t->curr_block->x64_instrs, &instr);
+            // chained assignments (a = b = ...) are unrolled, the stores go from the innermost out
+            abc_arr_init(&vars, sizeof(ir_var), t->pool);
+            while (expr->tag == IR_EXPR_ASSIGN) {
+                abc_arr_push(&vars, &expr->val.assign.var);
+                expr = expr->val.assign.value;
+            }
+            x64_program_translate_expr(t, expr);
+            for (size_t i = vars.len; i-- > 0;) {
+                instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
+                instr.val.bin.right.tag = X64_ARG_VAR;
+                instr.val.bin.right.val.var.var = ((ir_var *) vars.data)[i];
+                instr.val.bin.left = X64_RAX;
+                abc_arr_push(&t->curr_block->x64_instrs, &instr);
+            }
             break;
     }
 }
@@ -443,11 +518,13 @@ static void x64_program_translate_bin_expr(struct x64_translator *t, struct ir_e
     }
 
     // rdx:rax [* / /] arg
-    instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
-    instr.val.bin.left.tag = X64_ARG_IMM;
-    instr.val.bin.left.val.imm.imm = 0;
-    instr.val.bin.right = X64_RDX;
-    abc_arr_push(&t->curr_block->x64_instrs, &instr);
+    if (expr->op == IR_BIN_MUL) {
+        instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
+        instr.val.bin.left.tag = X64_ARG_IMM;
+        instr.val.bin.left.val.imm.imm = 0;
+        instr.val.bin.right = X64_RDX;
+        abc_arr_push(&t->curr_block->x64_instrs, &instr);
+    }
 
     instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
     instr.val.bin.left = lhs;
@@ -458,6 +535,11 @@ static void x64_program_translate_bin_expr(struct x64_translator *t, struct ir_e
     instr.val.bin.left = rhs;
     instr.val.bin.right = X64_R15;
     abc_arr_push(&t->curr_block->x64_instrs, &instr);
+    if (expr->op == IR_BIN_DIV) {
+        // idivq divides rdx:rax, rdx has to hold the sign of rax or a negative dividend reads as a huge one
+        instr.tag = X64_INSTR_NOARG, instr.val.noarg.tag = X64_NOARG_CQTO;
+        abc_arr_push(&t->curr_block->x64_instrs, &instr);
+    }
     instr.tag = X64_INSTR_FAC, instr.val.fac.tag = expr->op == IR_BIN_MUL ? X64_FAC_IMULQ : X64_FAC_IDIVQ;
     instr.val.fac.right = X64_R15;
     abc_arr_push(&t->curr_block->x64_instrs, &instr);
@@ -564,7 +646,7 @@ static void x64_program_translate_call_expr(struct x64_translator *t, struct ir_
     abc_arr_push(&t->curr_block->x64_instrs, &instr);
 
     // restore stack
-    int num_pushed = ((int) expr->args.len - 6 > 0) ? (int) expr->args.len - 6 : 0 + (need_align ? 1 : 0);
+    int num_pushed = ((int) expr->args.len - 6 > 0 ? (int) expr->args.len - 6 : 0) + (need_align ? 1 : 0);
     if (num_pushed > 0) {
         instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_ADDQ;
         instr.val.bin.left.tag = X64_ARG_IMM;
@@ -574,6 +656,36 @@ static void x64_program_translate_call_expr(struct x64_translator *t, struct ir_
     }
 }
 
+/*
+ * The arguments go where the call would pass them, those on the stack into the slots the caller got its own in, which
+ * hold the same number of arguments. The parameters were moved out of them in the init block.
+ */
+static void x64_program_translate_tail_call(struct x64_translator *t, struct ir_fun *ir_fun,
+                                            struct ir_expr_call *expr) {
+    struct x64_instr instr;
+    for (size_t i = 0; i < expr->args.len; i++) {
+        struct x64_arg src = x64_program_translate_atom(t, (struct ir_atom *) expr->args.data + i);
+        struct x64_arg dest;
+        if (i < 4) {
+            dest = X64_REGS[X64_REG_RDI - i];
+        } else if (i < 6) {
+            dest = X64_REGS[X64_REG_R8 + (i - 4)];
+        } else {
+            int num_spilled = (int) ir_fun->args.len - 6;
+            dest.tag = X64_ARG_DEREF;
+            dest.val.deref.offset = X64_STACK_PARAM_OFFSET + (num_spilled - ((int) i - 6 + 1)) * X64_VAR_SIZE;
+            dest.val.deref.reg = X64_REG_RBP;
+        }
+        instr.tag = X64_INSTR_BIN, instr.val.bin.tag = X64_BIN_MOVQ;
+        instr.val.bin.left = src;
+        instr.val.bin.right = dest;
+        abc_arr_push(&t->curr_block->x64_instrs, &instr);
+    }
+
+    instr.tag = X64_INSTR_TAILCALL, instr.val.callq.label = expr->label, instr.val.callq.arity = (int) expr->args.len;
+    abc_arr_push(&t->curr_block->x64_instrs, &instr);
+}
+
 static struct x64_arg x64_program_translate_atom(struct x64_translator *t, struct ir_atom *atom) {
     (void) t;
     struct x64_arg arg = {0};
@@ -583,8 +695,8 @@ static struct x64_arg x64_program_translate_atom(struct x64_translator *t, struc
             arg.val.imm.imm = atom->val.int_lit;
             break;
         case IR_ATOM_IDENTIFIER:
-            arg.tag = X64_ARG_STR;
-            arg.val.str.str = atom->val.label;
+            arg.tag = X64_ARG_VAR;
+            arg.val.var.var = atom->val.var;
             break;
         default:
             assert(0);
@@ -604,6 +716,24 @@ static void x64_program_print_label(FILE *f, char *label) {
 #endif
 }
 
+static void x64_program_print_block_label(FILE *f, struct x64_fun *fun, struct x64_label label) {
+    x64_program_print_label(f, fun->label);
+    switch (label.tag) {
+        case X64_LABEL_BLOCK:
+            fprintf(f, "_lab_%u", label.block);
+            break;
+        case X64_LABEL_INIT:
+            fprintf(f, "_init");
+            break;
+        case X64_LABEL_PRELUDE:
+            fprintf(f, "_prelude");
+            break;
+        case X64_LABEL_EPILOGUE:
+            fprintf(f, "_epilogue");
+            break;
+    }
+}
+
 static void x64_program_print_reg(enum x64_reg reg, FILE *f) {
     switch (reg) {
         case X64_REG_RAX:
@@ -683,8 +813,8 @@ static void x64_program_print_cc(enum x64_cc cc, FILE *f) {
 static void x64_program_print_arg(struct x64_arg *arg, FILE *f) {
     struct x64_arg tmp;
     switch (arg->tag) {
-        case X64_ARG_STR:
-            fprintf(f, "%s", arg->val.str.str);
+        case X64_ARG_VAR:
+            fprintf(f, "var_%u", arg->val.var.var);
             break;
         case X64_ARG_REG:
             fprintf(f, "%%");
@@ -703,7 +833,7 @@ static void x64_program_print_arg(struct x64_arg *arg, FILE *f) {
     }
 }
 
-static void x64_program_print_instr(struct x64_instr *instr, FILE *f) {
+static void x64_program_print_instr(struct x64_fun *fun, struct x64_instr *instr, FILE *f) {
 
     switch (instr->tag) {
         case X64_INSTR_BIN:
@@ -737,7 +867,17 @@ static void x64_program_print_instr(struct x64_instr *instr, FILE *f) {
             x64_program_print_arg(&instr->val.stack.arg, f);
             break;
         case X64_INSTR_NOARG:
-            fprintf(f, "%s", instr->val.noarg.tag == X64_NOARG_RETQ ? "retq" : "leaveq");
+            switch (instr->val.noarg.tag) {
+                case X64_NOARG_LEAVEQ:
+                    fprintf(f, "leaveq");
+                    break;
+                case X64_NOARG_RETQ:
+                    fprintf(f, "retq");
+                    break;
+                case X64_NOARG_CQTO:
+                    fprintf(f, "cqto");
+                    break;
+            }
             break;
         case X64_INSTR_MOVZBQ:
             fprintf(f, "movzbq %%al, ");
@@ -759,28 +899,32 @@ static void x64_program_print_instr(struct x64_instr *instr, FILE *f) {
             break;
         case X64_INSTR_JMP:
             fprintf(f, "jmp ");
-            x64_program_print_label(f, instr->val.jmp.label);
+            x64_program_print_block_label(f, fun, instr->val.jmp.label);
             break;
         case X64_INSTR_JMPCC:
             fprintf(f, "j");
             x64_program_print_cc(instr->val.jmpcc.code, f);
             fprintf(f, " ");
-            x64_program_print_label(f, instr->val.jmpcc.label);
+            x64_program_print_block_label(f, fun, instr->val.jmpcc.label);
             break;
         case X64_INSTR_CALLQ:
             fprintf(f, "callq ");
             x64_program_print_label(f, instr->val.callq.label);
             break;
+        case X64_INSTR_TAILCALL:
+            fprintf(f, "jmp ");
+            x64_program_print_label(f, instr->val.callq.label);
+            break;
     }
 }
 
-static void x64_program_print_block(struct x64_block *block, FILE *f) {
-    x64_program_print_label(f, block->label);
+static void x64_program_print_block(struct x64_fun *fun, struct x64_block *block, FILE *f) {
+    x64_program_print_block_label(f, fun, block->label);
     fprintf(f, ":\n");
     for (size_t i = 0; i < block->x64_instrs.len; i++) {
         x64_program_print_indent(f);
         struct x64_instr *instr = ((struct x64_instr *) block->x64_instrs.data) + i;
-        x64_program_print_instr(instr, f);
+        x64_program_print_instr(fun, instr, f);
         fprintf(f, "\n");
     }
 }
@@ -796,7 +940,7 @@ void x64_program_print(struct x64_program *prog, FILE *f) {
         fprintf(f, ":\n");
         for (size_t j = 0; j < fun->x64_blocks.len; j++) {
             struct x64_block *block = ((struct x64_block *) fun->x64_blocks.data) + j;
-            x64_program_print_block(block, f);
+            x64_program_print_block(fun, block, f);
         }
         fprintf(f, "\n");
     }
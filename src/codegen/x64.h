@@ -28,6 +28,8 @@ enum x64_reg {
     X64_REG_R15, // callee saved
 };
 
+#define X64_NUM_REGS (X64_REG_R15 + 1)
+
 enum x64_cc {
     X64_CC_E,
     X64_CC_NE,
@@ -38,14 +40,15 @@ enum x64_cc {
 };
 
 enum x64_arg_tag {
-    X64_ARG_STR, // used as intermediate
+    X64_ARG_VAR, // used as intermediate
     X64_ARG_REG,
     X64_ARG_IMM,
     X64_ARG_DEREF,
 };
 
-struct x64_arg_str {
-    char *str;
+// IR variable, replaced by its home during register allocation.
+struct x64_arg_var {
+    ir_var var;
 };
 
 struct x64_arg_reg {
@@ -64,7 +67,7 @@ struct x64_arg_deref {
 struct x64_arg {
     enum x64_arg_tag tag;
     union {
-        struct x64_arg_str str;
+        struct x64_arg_var var;
         struct x64_arg_reg reg;
         struct x64_arg_imm imm;
         struct x64_arg_deref deref;
@@ -90,6 +93,19 @@ extern const struct x64_arg X64_R15;
 
 extern const struct x64_arg X64_REGS[];
 
+enum x64_label_tag {
+    X64_LABEL_BLOCK, // an IR block
+    X64_LABEL_INIT,
+    X64_LABEL_PRELUDE,
+    X64_LABEL_EPILOGUE,
+};
+
+// Block labels are local to their function, which prefixes them when printed.
+struct x64_label {
+    enum x64_label_tag tag;
+    ir_label block; // for X64_LABEL_BLOCK
+};
+
 enum x64_instr_tag {
     X64_INSTR_BIN,
     X64_INSTR_FAC,
@@ -103,6 +119,7 @@ enum x64_instr_tag {
     X64_INSTR_JMP,
     X64_INSTR_JMPCC,
     X64_INSTR_CALLQ,
+    X64_INSTR_TAILCALL, // jmp to a function in place of calling it and returning
 };
 
 enum x64_bin_instr_tag {
@@ -159,11 +176,11 @@ struct x64_instr_setcc {
 };
 
 struct x64_instr_jmp {
-    char *label;
+    struct x64_label label;
 };
 
 struct x64_instr_jmpcc {
-    char *label;
+    struct x64_label label;
     enum x64_cc code;
 };
 
@@ -174,7 +191,8 @@ struct x64_instr_callq {
 
 enum x64_noarg_instr_tag {
     X64_NOARG_LEAVEQ,
-    X64_NOARG_RETQ
+    X64_NOARG_RETQ,
+    X64_NOARG_CQTO, // sign extends rax into rdx
 };
 
 struct x64_noarg_instr {
@@ -195,18 +213,19 @@ struct x64_instr {
         struct x64_instr_jmp jmp;
         struct x64_instr_jmpcc jmpcc;
 
-        struct x64_instr_callq callq;
+        struct x64_instr_callq callq; // also for X64_INSTR_TAILCALL
         struct x64_noarg_instr noarg;
     } val;
 };
 
 struct x64_block {
-    char *label;
+    struct x64_label label;
     struct abc_arr x64_instrs; // x64_instr
 };
 
 struct x64_fun {
     char *label;
+    ir_var num_vars;
     struct abc_arr x64_blocks; // x64_block
 };
 
@@ -218,7 +237,7 @@ struct x64_program {
 
 // used for variables and parameters to a function
 struct x64_var_spec {
-    char *label;
+    ir_var var;
     int offset; // rbp offset, positive indicates that it is an argument passed through the stack
 };
 
@@ -11,7 +11,7 @@
 #include "x64.h"
 
 #include <assert.h>
-#include <string.h>
+#include <stdint.h>
 
 struct live_range {
     const struct x64_arg *arg;
@@ -46,78 +46,76 @@ static void init_reg_pool(struct abc_arr *reg_pool) {
     }
 }
 
-static bool arg_eq(const struct x64_arg *arg, const struct x64_arg *arg2) {
-    if (arg->tag != arg2->tag) {
-        return false;
-    }
-    switch (arg->tag) {
-        case X64_ARG_STR:
-            return strcmp(arg->val.str.str, arg2->val.str.str) == 0;
-        case X64_ARG_REG:
-            return arg->val.reg.reg == arg2->val.reg.reg;
-        default:
-            assert(0);
-    }
-}
-
 int live_range_cmp_start(const void *l, const void *r) {
     const struct live_range *l1 = l;
     const struct live_range *r1 = r;
     return l1->start - r1->start;
 }
 
-static void live_range_used(struct abc_arr *arr, const struct x64_arg *arg, int block) {
+// Registers come first in the range index, followed by the variables.
+static size_t live_range_key(const struct x64_arg *arg) {
+    return arg->tag == X64_ARG_REG ? (size_t) arg->val.reg.reg : X64_NUM_REGS + (size_t) arg->val.var.var;
+}
+
+static void live_range_used(struct abc_arr *arr, size_t *index, const struct x64_arg *arg, int pos) {
     if (arg->tag == X64_ARG_IMM || arg->tag == X64_ARG_DEREF) {
         return;
     }
 
     // search and update
-    for (size_t i = 0; i < arr->len; i++) {
-        struct live_range *r = (struct live_range *) arr->data + i;
-        if (arg_eq(arg, r->arg)) {
-            if (r->end < block) {
-                r->end = block;
-            }
-            if (r->start > block) {
-                r->start = block;
-            }
-            return;
+    size_t *i = &index[live_range_key(arg)];
+    if (*i != SIZE_MAX) {
+        struct live_range *r = (struct live_range *) arr->data + *i;
+        if (r->end < pos) {
+            r->end = pos;
         }
+        if (r->start > pos) {
+            r->start = pos;
+        }
+        return;
     }
 
     // we need to insert a new live range
-    struct live_range r = {.start = block, .end = block, .arg = arg};
+    struct live_range r = {.start = pos, .end = pos, .arg = arg};
+    *i = arr->len;
     abc_arr_push(arr, &r);
 }
 
-static void calculate_live_range(struct abc_arr *arr, struct x64_instr *instr, int block) {
+static void calculate_live_range(struct abc_arr *arr, size_t *index, struct x64_instr *instr, int pos) {
     switch (instr->tag) {
         case X64_INSTR_BIN:
-            live_range_used(arr, &instr->val.bin.left, block);
-            live_range_used(arr, &instr->val.bin.right, block);
+            live_range_used(arr, index, &instr->val.bin.left, pos);
+            live_range_used(arr, index, &instr->val.bin.right, pos);
             break;
         case X64_INSTR_FAC:
-            live_range_used(arr, &instr->val.fac.right, block);
+            // imulq and idivq write rdx
+            live_range_used(arr, index, &instr->val.fac.right, pos);
+            live_range_used(arr, index, &X64_REGS[X64_REG_RDX], pos);
             break;
         case X64_INSTR_STACK:
-            live_range_used(arr, &instr->val.stack.arg, block);
+            live_range_used(arr, index, &instr->val.stack.arg, pos);
             break;
         case X64_INSTR_LEAQ:
-            live_range_used(arr, &instr->val.leaq.dest, block);
+            live_range_used(arr, index, &instr->val.leaq.dest, pos);
             break;
         case X64_INSTR_NEGQ:
-            live_range_used(arr, &instr->val.neg.dest, block);
+            live_range_used(arr, index, &instr->val.neg.dest, pos);
             break;
         case X64_INSTR_CALLQ:
+        case X64_INSTR_TAILCALL:
             for (size_t i = 0; i < X64_REG_R15; i++) {
                 if (i < 6 || (i > 7 && i < 12)) {
-                    live_range_used(arr, &X64_REGS[i], block);
+                    live_range_used(arr, index, &X64_REGS[i], pos);
                 }
             }
-
+            break;
+        case X64_INSTR_NOARG:
+            if (instr->val.noarg.tag == X64_NOARG_CQTO) {
+                live_range_used(arr, index, &X64_REGS[X64_REG_RDX], pos);
+            }
+            break;
         case X64_INSTR_SETCC:
         case X64_INSTR_MOVZBQ:
-        case X64_INSTR_NOARG:
         case X64_INSTR_JMP:
         case X64_INSTR_JMPCC:
             break;
@@ -136,11 +134,71 @@ static void move_reg_constraints(struct abc_arr *ranges, struct abc_arr *dest) {
     }
 }
 
+/*
+ * Ranges are computed on the blocks as laid out, so a variable read in a loop seems dead after its last read even
+ * though the next iteration reads it again. Ranges entering a loop from before its start are stretched to the jump
+ * back, repeated until nested loops settle.
+ */
+static void extend_over_loops(struct x64_fun *fun, struct abc_arr *ranges, struct abc_pool *allocator) {
+    ir_label num_labels = 0;
+    for (size_t i = 0; i < fun->x64_blocks.len; i++) {
+        struct x64_block *block = (struct x64_block *) fun->x64_blocks.data + i;
+        if (block->label.tag == X64_LABEL_BLOCK && block->label.block >= num_labels) {
+            num_labels = block->label.block + 1;
+        }
+    }
+    int *block_start = abc_pool_alloc(allocator, sizeof(int), num_labels > 0 ? num_labels : 1);
+    int pos = 0;
+    for (size_t i = 0; i < fun->x64_blocks.len; i++) {
+        struct x64_block *block = (struct x64_block *) fun->x64_blocks.data + i;
+        if (block->label.tag == X64_LABEL_BLOCK) {
+            block_start[block->label.block] = pos;
+        }
+        pos += (int) block->x64_instrs.len;
+    }
+
+    // a back edge jumps from its end to a loop start at or before it
+    struct abc_arr loops;
+    abc_arr_init(&loops, sizeof(struct live_range), allocator);
+    pos = 0;
+    for (size_t i = 0; i < fun->x64_blocks.len; i++) {
+        struct x64_block *block = (struct x64_block *) fun->x64_blocks.data + i;
+        for (size_t j = 0; j < block->x64_instrs.len; j++, pos++) {
+            struct x64_instr *instr = (struct x64_instr *) block->x64_instrs.data + j;
+            const struct x64_label *label = NULL;
+            if (instr->tag == X64_INSTR_JMP) {
+                label = &instr->val.jmp.label;
+            } else if (instr->tag == X64_INSTR_JMPCC) {
+                label = &instr->val.jmpcc.label;
+            }
+            if (label != NULL && label->tag == X64_LABEL_BLOCK && block_start[label->block] <= pos) {
+                struct live_range loop = {.start = block_start[label->block], .end = pos};
+                abc_arr_push(&loops, &loop);
+            }
+        }
+    }
+
+    bool changed = loops.len > 0;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < loops.len; i++) {
+            struct live_range *loop = (struct live_range *) loops.data + i;
+            for (size_t j = 0; j < ranges->len; j++) {
+                struct live_range *r = (struct live_range *) ranges->data + j;
+                if (r->start < loop->start && r->end >= loop->start && r->end < loop->end) {
+                    r->end = loop->end;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
 static void remove_expired_ranges(struct abc_arr *active, struct live_range *current, struct abc_arr *regs) {
     for (size_t i = 0; i < active->len; i++) {
         struct live_range *r = (struct live_range *) active->data + i;
-        if (r->end <= current->end) {
-            for (size_t j = 0; i < regs->len; i++) {
+        if (r->end < current->start) {
+            for (size_t j = 0; j < regs->len; j++) {
                 struct reg_pool *r_entry = (struct reg_pool *) regs->data + j;
                 if (r->reg == r_entry->reg) {
                     r_entry->in_use = false;
@@ -163,6 +221,10 @@ static void insert_callee_saved(struct abc_arr *saved, enum x64_reg reg_tag) {
     abc_arr_push(saved, &arg);
 }
 
+static void set_home(struct x64_regalloc *regalloc, ir_var var, struct x64_arg home) {
+    ((struct x64_arg *) regalloc->homes.data)[var] = home;
+}
+
 static void alloc_reg(struct x64_regalloc *regalloc, struct abc_arr *active, struct live_range *r,
                       struct abc_arr *constraints, struct abc_arr *regs) {
     for (size_t i = 0; i < regs->len; i++) {
@@ -187,41 +249,54 @@ static void alloc_reg(struct x64_regalloc *regalloc, struct abc_arr *active, str
         }
         // we can allocate this register!
         struct x64_arg arg = {.tag = X64_ARG_REG, .val.reg.reg = r_entry->reg};
-        struct x64_alloc entry = {.label = r->arg->val.str.str, .arg = arg};
-        abc_arr_push(&regalloc->allocs, &entry);
+        set_home(regalloc, r->arg->val.var.var, arg);
         if (r_entry->saved) {
             insert_callee_saved(&regalloc->callee_saved_allocs, r_entry->reg);
         }
         r_entry->in_use = true;
-        r->reg = entry.arg.val.reg.reg;
+        r->reg = r_entry->reg;
         abc_arr_push(active, r);
         return;
     }
     // no register found, we have to spill...
     int offset = (regalloc->num_spilled++) * X64_VAR_SIZE + X64_VAR_SIZE;
     struct x64_arg res = {.tag = X64_ARG_DEREF, .val.deref.reg = X64_REG_RBP, .val.deref.offset = -offset};
-    struct x64_alloc alloc = {.label = r->arg->val.str.str, .arg = res};
-    abc_arr_push(&regalloc->allocs, &alloc);
+    set_home(regalloc, r->arg->val.var.var, res);
 }
 
 struct x64_regalloc x64_regalloc(struct x64_fun *fun, struct abc_pool *allocator, int num_params) {
     // init
-    (void) num_params;
     struct x64_regalloc regalloc;
-    abc_arr_init(&regalloc.allocs, sizeof(struct x64_alloc), allocator);
+    abc_arr_init_cap(&regalloc.homes, sizeof(struct x64_arg), fun->num_vars, allocator);
+    for (ir_var var = 0; var < fun->num_vars; var++) {
+        struct x64_arg arg = {.tag = X64_ARG_VAR, .val.var.var = var};
+        abc_arr_push(&regalloc.homes, &arg);
+    }
     abc_arr_init(&regalloc.callee_saved_allocs, sizeof(struct x64_arg), allocator);
     regalloc.num_spilled = 0;
 
     // calculate live ranges
     struct abc_arr ranges;
     abc_arr_init(&ranges, sizeof(struct live_range), allocator);
+    size_t num_keys = X64_NUM_REGS + fun->num_vars;
+    size_t *range_index = abc_pool_alloc(allocator, sizeof(size_t), num_keys); // live_range_key -> index into ranges
+    for (size_t i = 0; i < num_keys; i++) {
+        range_index[i] = SIZE_MAX;
+    }
+    // the registers holding the parameters are live from the start, until their move in the first block
+    for (int i = 0; i < num_params && i < 6; i++) {
+        const struct x64_arg *reg = i < 4 ? &X64_REGS[X64_REG_RDI - i] : &X64_REGS[X64_REG_R8 + (i - 4)];
+        live_range_used(&ranges, range_index, reg, 0);
+    }
+    int pos = 0;
     for (size_t i = 0; i < fun->x64_blocks.len; i++) {
         struct x64_block *block = (struct x64_block *) fun->x64_blocks.data + i;
         for (size_t j = 0; j < block->x64_instrs.len; j++) {
             struct x64_instr *instr = (struct x64_instr *) block->x64_instrs.data + j;
-            calculate_live_range(&ranges, instr, (int) i);
+            calculate_live_range(&ranges, range_index, instr, pos++);
         }
     }
+    extend_over_loops(fun, &ranges, allocator);
     qsort(ranges.data, ranges.len, sizeof(struct live_range), live_range_cmp_start);
     struct abc_arr reg_constraints; // list of register live ranges
     abc_arr_init(&reg_constraints, sizeof(struct live_range), allocator);
@@ -240,17 +315,15 @@ struct x64_regalloc x64_regalloc(struct x64_fun *fun, struct abc_pool *allocator
     }
 
     // TODO: patch spills that are arguments passed through the stack to just refer to the stack location they
-    // were passed in
+    // were passed in, unless a tail call passes its own arguments there
 
     return regalloc;
 }
 
-struct x64_arg *x64_regalloc_get_arg(struct x64_regalloc *regalloc, char *label) {
-    for (size_t i = 0; i < regalloc->allocs.len; i++) {
-        struct x64_alloc *alloc = (struct x64_alloc *) regalloc->allocs.data + i;
-        if (strcmp(label, alloc->label) == 0) {
-            return &alloc->arg;
-        }
+struct x64_arg *x64_regalloc_get_arg(struct x64_regalloc *regalloc, ir_var var) {
+    struct x64_arg *home = (struct x64_arg *) regalloc->homes.data + var;
+    if (var >= regalloc->homes.len || home->tag == X64_ARG_VAR) {
+        return NULL;
     }
-    return NULL;
+    return home;
 }
@@ -5,13 +5,8 @@
 #include "../data/abc_pool.h"
 #include "x64.h"
 
-struct x64_alloc {
-    char *label;
-    struct x64_arg arg;
-};
-
 struct x64_regalloc {
-    struct abc_arr allocs; // x64_alloc
+    struct abc_arr homes; // x64_arg indexed by variable, left as the variable itself if it is never used
     struct abc_arr callee_saved_allocs; // x64_arg (registers)
     int num_spilled; // does not include spilled arguments passed through stack
 };
@@ -22,6 +17,6 @@ struct x64_regalloc {
 // are assigned to names in the first block. With n params, the first n instructions are moves for these.
 struct x64_regalloc x64_regalloc(struct x64_fun *program, struct abc_pool *allocator, int num_params);
 
-struct x64_arg *x64_regalloc_get_arg(struct x64_regalloc *regalloc, char *label);
+struct x64_arg *x64_regalloc_get_arg(struct x64_regalloc *regalloc, ir_var var);
 
 #endif //X64_REGALLOC_H
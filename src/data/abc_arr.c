@@ -16,6 +16,14 @@ void abc_arr_init(struct abc_arr *arr, size_t elem_size, struct abc_pool *pool)
     arr->data = abc_pool_alloc(arr->pool, elem_size, arr->cap);
 }
 
+void abc_arr_init_cap(struct abc_arr *arr, size_t elem_size, size_t cap, struct abc_pool *pool) {
+    arr->len = 0;
+    arr->cap = cap > 0 ? cap : ABC_ARR_INIT_CAP;
+    arr->elem_size = elem_size;
+    arr->pool = pool;
+    arr->data = abc_pool_alloc(arr->pool, elem_size, arr->cap);
+}
+
 void *abc_arr_push(struct abc_arr *arr, void *data) {
     if (arr->len == arr->cap) {
         // Grow
@@ -36,8 +44,9 @@ static unsigned long get_ptr_index(struct abc_arr *arr, void *ptr) {
 }
 
 void *abc_arr_insert_before_ptr(struct abc_arr *arr, void *where, void *data) {
-    abc_arr_push(arr, data);
+    // the push may move the data, so where is only valid before it
     unsigned long index = get_ptr_index(arr, where);
+    abc_arr_push(arr, data);
     unsigned long n = arr->len - 1 - index;
     memmove((char *) arr->data + (index + 1) * arr->elem_size, (char *) arr->data + index * arr->elem_size, n * arr->elem_size);
     memmove((char *) arr->data + index * arr->elem_size, data, arr->elem_size);
@@ -45,10 +54,10 @@ void *abc_arr_insert_before_ptr(struct abc_arr *arr, void *where, void *data) {
 }
 
 void *abc_arr_insert_after_ptr(struct abc_arr *arr, void *where, void *data) {
-    abc_arr_push(arr, data);
     unsigned long index = get_ptr_index(arr, where);
+    abc_arr_push(arr, data);
     unsigned long n = arr->len - 2 - index;
-    memmove((char *) arr->data + (index + 2) * arr->elem_size + 2, (char *) arr->data + (index + 1) * arr->elem_size,
+    memmove((char *) arr->data + (index + 2) * arr->elem_size, (char *) arr->data + (index + 1) * arr->elem_size,
             n * arr->elem_size);
     memmove((char *) arr->data + (index + 1) * arr->elem_size, data, arr->elem_size);
     return (char *) arr->data + (index + 1) * arr->elem_size;
@@ -16,6 +16,8 @@ struct abc_arr {
 };
 
 void abc_arr_init(struct abc_arr *arr, size_t elem_size, struct abc_pool *pool);
+// Initialize with room for cap elements, for arrays whose final size can be estimated up front.
+void abc_arr_init_cap(struct abc_arr *arr, size_t elem_size, size_t cap, struct abc_pool *pool);
 
 void *abc_arr_push(struct abc_arr *arr, void *data);
 
@@ -0,0 +1,94 @@
+#include "abc_intern.h"
+
+#include <assert.h>
+#include <string.h>
+
+static uint32_t hash_bytes(const char *str, size_t len) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t) str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t *alloc_table(struct abc_pool *pool, size_t cap) {
+    uint32_t *table = abc_pool_alloc(pool, sizeof(uint32_t), cap);
+    memset(table, 0, sizeof(uint32_t) * cap);
+    return table;
+}
+
+void abc_intern_init(struct abc_intern *intern, struct abc_pool *pool) {
+    intern->pool = pool;
+    abc_arr_init(&intern->entries, sizeof(struct abc_intern_entry), pool);
+    intern->table_cap = ABC_INTERN_INIT_CAP;
+    intern->table = alloc_table(pool, intern->table_cap);
+}
+
+/*
+ * Index of the slot holding str, or of the empty slot where it should be inserted.
+ */
+static size_t find_slot(const struct abc_intern *intern, const char *str, size_t len, uint32_t hash) {
+    size_t mask = intern->table_cap - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint32_t slot = intern->table[i];
+        if (slot == 0) {
+            return i;
+        }
+        struct abc_intern_entry *entry = (struct abc_intern_entry *) intern->entries.data + (slot - 1);
+        if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0) {
+            return i;
+        }
+    }
+}
+
+static void grow(struct abc_intern *intern) {
+    intern->table_cap *= 2;
+    intern->table = alloc_table(intern->pool, intern->table_cap);
+    size_t mask = intern->table_cap - 1;
+    for (size_t sym = 0; sym < intern->entries.len; sym++) {
+        struct abc_intern_entry *entry = (struct abc_intern_entry *) intern->entries.data + sym;
+        size_t i = entry->hash & mask;
+        while (intern->table[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        intern->table[i] = (uint32_t) sym + 1;
+    }
+}
+
+abc_sym abc_intern(struct abc_intern *intern, const char *str, size_t len) {
+    uint32_t hash = hash_bytes(str, len);
+    size_t i = find_slot(intern, str, len, hash);
+    if (intern->table[i] != 0) {
+        return intern->table[i] - 1;
+    }
+
+    char *copy = abc_pool_alloc_aligned(intern->pool, len + 1, 1, 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    struct abc_intern_entry entry = {.str = copy, .len = (uint32_t) len, .hash = hash};
+    abc_arr_push(&intern->entries, &entry);
+    abc_sym sym = (abc_sym) intern->entries.len - 1;
+    intern->table[i] = sym + 1;
+
+    // keep the load factor below 1/2
+    if (intern->entries.len * 2 > intern->table_cap) {
+        grow(intern);
+    }
+    return sym;
+}
+
+bool abc_intern_find(const struct abc_intern *intern, const char *str, size_t len, abc_sym *sym) {
+    size_t i = find_slot(intern, str, len, hash_bytes(str, len));
+    if (intern->table[i] == 0) {
+        return false;
+    }
+    *sym = intern->table[i] - 1;
+    return true;
+}
+
+const char *abc_intern_str(const struct abc_intern *intern, abc_sym sym) {
+    assert(sym < intern->entries.len);
+    return ((struct abc_intern_entry *) intern->entries.data)[sym].str;
+}
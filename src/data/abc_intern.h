@@ -0,0 +1,49 @@
+/**
+ * String interning. Every distinct string gets one canonical copy and a dense 32-bit symbol id, so names can be
+ * compared with == from the lexer onwards.
+ */
+
+#ifndef ABC_INTERN_H
+#define ABC_INTERN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "abc_arr.h"
+#include "abc_pool.h"
+
+#define ABC_INTERN_INIT_CAP 64 // must be a power of two
+
+typedef uint32_t abc_sym;
+
+struct abc_intern_entry {
+  const char *str;
+  uint32_t len;
+  uint32_t hash;
+};
+
+struct abc_intern {
+  struct abc_pool *pool;
+  struct abc_arr entries; // abc_intern_entry, indexed by abc_sym
+  uint32_t *table; // open addressing, holds sym + 1 and 0 for empty slots
+  size_t table_cap;
+};
+
+void abc_intern_init(struct abc_intern *intern, struct abc_pool *pool);
+
+/*
+ * Intern the len bytes at str (which do not need to be NUL terminated), returning its symbol.
+ */
+abc_sym abc_intern(struct abc_intern *intern, const char *str, size_t len);
+
+/*
+ * Look up str without interning it. Returns false if it has never been interned.
+ */
+bool abc_intern_find(const struct abc_intern *intern, const char *str, size_t len, abc_sym *sym);
+
+/*
+ * The canonical, NUL terminated, string for sym.
+ */
+const char *abc_intern_str(const struct abc_intern *intern, abc_sym sym);
+
+#endif //ABC_INTERN_H
@@ -0,0 +1,121 @@
+#include "abc_map.h"
+
+#include <assert.h>
+#include <string.h>
+
+static uint32_t hash_key(uint64_t key) {
+    // Fibonacci hashing, the high bits are well mixed even for pointers and consecutive symbols
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static struct abc_map_slot *alloc_table(struct abc_pool *pool, size_t cap) {
+    struct abc_map_slot *table = abc_pool_alloc(pool, sizeof(struct abc_map_slot), cap);
+    memset(table, 0, sizeof(struct abc_map_slot) * cap);
+    return table;
+}
+
+void abc_map_init(struct abc_map *map, size_t value_size, struct abc_pool *pool) {
+    map->pool = pool;
+    abc_arr_init(&map->bindings, sizeof(struct abc_map_binding), pool);
+    abc_arr_init(&map->values, value_size, pool);
+    abc_arr_init(&map->scopes, sizeof(size_t), pool);
+    abc_arr_init(&map->keys, sizeof(uint64_t), pool);
+    map->table_cap = ABC_MAP_INIT_CAP;
+    map->table = alloc_table(pool, map->table_cap);
+}
+
+/*
+ * Index of the slot holding key, or of the unused slot where it should be inserted.
+ */
+static size_t find_slot(const struct abc_map *map, uint64_t key) {
+    size_t mask = map->table_cap - 1;
+    for (size_t i = hash_key(key) & mask;; i = (i + 1) & mask) {
+        if (!map->table[i].used || map->table[i].key == key) {
+            return i;
+        }
+    }
+}
+
+static void grow(struct abc_map *map) {
+    struct abc_map_slot *old = map->table;
+    size_t old_cap = map->table_cap;
+    map->table_cap *= 2;
+    map->table = alloc_table(map->pool, map->table_cap);
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].used) {
+            map->table[find_slot(map, old[i].key)] = old[i];
+        }
+    }
+}
+
+static void *value_at(const struct abc_map *map, uint32_t binding) {
+    return (char *) map->values.data + (size_t) binding * map->values.elem_size;
+}
+
+void *abc_map_put(struct abc_map *map, uint64_t key, const void *value) {
+    // keep the load factor below 1/2, keys keep their slot until the map is cleared
+    if ((map->keys.len + 1) * 2 > map->table_cap) {
+        grow(map);
+    }
+    struct abc_map_slot *slot = &map->table[find_slot(map, key)];
+    if (!slot->used) {
+        *slot = (struct abc_map_slot) {.key = key, .binding = 0, .used = true};
+        abc_arr_push(&map->keys, &key);
+    }
+
+    assert(map->bindings.len < UINT32_MAX);
+    struct abc_map_binding binding = {.key = key, .shadowed = slot->binding, .scope = (uint32_t) map->scopes.len};
+    abc_arr_push(&map->bindings, &binding);
+    slot->binding = (uint32_t) map->bindings.len;
+    return abc_arr_push(&map->values, (void *) value);
+}
+
+void *abc_map_get(const struct abc_map *map, uint64_t key) {
+    struct abc_map_slot *slot = &map->table[find_slot(map, key)];
+    if (!slot->used || slot->binding == 0) {
+        return NULL;
+    }
+    return value_at(map, slot->binding - 1);
+}
+
+void *abc_map_get_local(const struct abc_map *map, uint64_t key) {
+    struct abc_map_slot *slot = &map->table[find_slot(map, key)];
+    if (!slot->used || slot->binding == 0) {
+        return NULL;
+    }
+    struct abc_map_binding *binding = (struct abc_map_binding *) map->bindings.data + (slot->binding - 1);
+    if (binding->scope != map->scopes.len) {
+        return NULL;
+    }
+    return value_at(map, slot->binding - 1);
+}
+
+void abc_map_push_scope(struct abc_map *map) {
+    abc_arr_push(&map->scopes, &map->bindings.len);
+}
+
+void abc_map_pop_scope(struct abc_map *map) {
+    assert(map->scopes.len > 0);
+    size_t start = ((size_t *) map->scopes.data)[--map->scopes.len];
+    while (map->bindings.len > start) {
+        struct abc_map_binding *binding = (struct abc_map_binding *) map->bindings.data + --map->bindings.len;
+        map->table[find_slot(map, binding->key)].binding = binding->shadowed;
+    }
+    map->values.len = start;
+}
+
+void abc_map_clear(struct abc_map *map) {
+    // Only the used slots are touched, so clearing a map that once grew large stays cheap. They are all located before
+    // any is freed, since freeing a slot breaks the probe sequences running through it.
+    uint64_t *keys = map->keys.data;
+    for (size_t i = 0; i < map->keys.len; i++) {
+        keys[i] = find_slot(map, keys[i]);
+    }
+    for (size_t i = 0; i < map->keys.len; i++) {
+        map->table[keys[i]] = (struct abc_map_slot) {0};
+    }
+    map->keys.len = 0;
+    map->bindings.len = 0;
+    map->values.len = 0;
+    map->scopes.len = 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * Hash map from 64-bit keys (symbols, pointers, small integers) to fixed size values, with lexical scopes.
+ *
+ * Bindings live in arrays in insertion order and the open addressing table points at the innermost binding of each
+ * key. A binding remembers the one it shadows, so popping a scope only walks the bindings made in it.
+ */
+
+#ifndef ABC_MAP_H
+#define ABC_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "abc_arr.h"
+#include "abc_pool.h"
+
+#define ABC_MAP_INIT_CAP 16 // must be a power of two
+
+struct abc_map_slot {
+  uint64_t key;
+  uint32_t binding; // innermost binding + 1, 0 when the key is not bound
+  bool used;
+};
+
+struct abc_map_binding {
+  uint64_t key;
+  uint32_t shadowed; // binding + 1 of the same key in an outer scope, 0 if none
+  uint32_t scope; // scopes.len when bound
+};
+
+struct abc_map {
+  struct abc_pool *pool;
+  struct abc_arr bindings; // abc_map_binding
+  struct abc_arr values; // value_size bytes each, parallel to bindings
+  struct abc_arr scopes; // size_t, bindings.len at each push_scope
+  struct abc_arr keys; // uint64_t, every key with a used slot
+  struct abc_map_slot *table;
+  size_t table_cap;
+};
+
+void abc_map_init(struct abc_map *map, size_t value_size, struct abc_pool *pool);
+
+/*
+ * Bind key to a copy of value in the innermost scope, shadowing any outer binding. Returns the stored value, which
+ * stays valid until the next put.
+ */
+void *abc_map_put(struct abc_map *map, uint64_t key, const void *value);
+
+/*
+ * The value of the innermost binding of key, or NULL.
+ */
+void *abc_map_get(const struct abc_map *map, uint64_t key);
+
+/*
+ * Like abc_map_get, but only looks in the innermost scope.
+ */
+void *abc_map_get_local(const struct abc_map *map, uint64_t key);
+
+void abc_map_push_scope(struct abc_map *map);
+
+/*
+ * Drop the bindings made since the matching push_scope, uncovering the ones they shadowed.
+ */
+void abc_map_pop_scope(struct abc_map *map);
+
+/*
+ * Remove all bindings and scopes, keeping the memory.
+ */
+void abc_map_clear(struct abc_map *map);
+
+#endif //ABC_MAP_H
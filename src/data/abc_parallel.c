@@ -0,0 +1,68 @@
+#include "abc_parallel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct parallel_state {
+    abc_parallel_fn fn;
+    void *ctx;
+    size_t count;
+    atomic_size_t next;
+};
+
+struct parallel_worker {
+    struct parallel_state *state;
+    size_t id;
+    pthread_t thread;
+};
+
+static void *run_worker(void *arg) {
+    struct parallel_worker *worker = arg;
+    struct parallel_state *state = worker->state;
+    size_t index;
+    while ((index = atomic_fetch_add(&state->next, 1)) < state->count) {
+        state->fn(state->ctx, worker->id, index);
+    }
+    return NULL;
+}
+
+void abc_parallel_for(size_t count, size_t workers, abc_parallel_fn fn, void *ctx) {
+    if (workers > count) {
+        workers = count;
+    }
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            fn(ctx, 0, i);
+        }
+        return;
+    }
+
+    struct parallel_state state = {.fn = fn, .ctx = ctx, .count = count};
+    atomic_init(&state.next, 0);
+    struct parallel_worker *pool = malloc(sizeof(struct parallel_worker) * workers);
+    if (pool == NULL) {
+        fprintf(stderr, "worker allocation failed %s\n", __FILE__);
+        exit(EXIT_FAILURE);
+    }
+    // the calling thread is worker 0
+    for (size_t i = 0; i < workers; i++) {
+        pool[i] = (struct parallel_worker) {.state = &state, .id = i};
+        if (i > 0 && pthread_create(&pool[i].thread, NULL, run_worker, &pool[i]) != 0) {
+            fprintf(stderr, "failed to start worker thread %s\n", __FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+    run_worker(&pool[0]);
+    for (size_t i = 1; i < workers; i++) {
+        pthread_join(pool[i].thread, NULL);
+    }
+    free(pool);
+}
+
+size_t abc_parallel_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t) n : 1;
+}
@@ -0,0 +1,24 @@
+/**
+ * Minimal data parallelism: run a function for every index of a range on a fixed number of worker threads.
+ */
+
+#ifndef ABC_PARALLEL_H
+#define ABC_PARALLEL_H
+
+#include <stddef.h>
+
+// Called once per index, worker is in [0, workers) and no two concurrent calls share a worker id.
+typedef void (*abc_parallel_fn)(void *ctx, size_t worker, size_t index);
+
+/*
+ * Call fn for each index in [0, count) using up to workers threads, indices are handed out in order as threads become
+ * free. Returns when all calls are done. With workers <= 1 everything runs on the calling thread.
+ */
+void abc_parallel_for(size_t count, size_t workers, abc_parallel_fn fn, void *ctx);
+
+/*
+ * Number of online processors, at least 1.
+ */
+size_t abc_parallel_cpus(void);
+
+#endif //ABC_PARALLEL_H
@@ -13,6 +13,7 @@ struct abc_pool *abc_pool_create(void) {
     pool->data = NULL;
     pool->offset = 0;
     pool->capacity = 0;
+    pool->last = pool;
     return pool;
 }
 
@@ -20,16 +21,6 @@ void *abc_pool_alloc(struct abc_pool *pool, size_t size, size_t count) {
     return abc_pool_alloc_aligned(pool, size, count, FALLBACK_ALIGNMENT);
 }
 
-/*
- * Get the last pool page.
- */
-static struct abc_pool *find_page(struct abc_pool *pool) {
-    while (pool->next != NULL) {
-        pool = pool->next;
-    }
-    return pool;
-}
-
 static void alloc_page(struct abc_pool *pool, size_t size, size_t count) {
     size_t alloc_size = size * count > ABC_POOL_SIZE ? size * count : ABC_POOL_SIZE;
     pool->data = malloc(alloc_size);
@@ -43,7 +34,8 @@ static void alloc_page(struct abc_pool *pool, size_t size, size_t count) {
 
 void *abc_pool_alloc_aligned(struct abc_pool *pool, size_t size, size_t count, size_t alignment) {
     assert(pool != NULL);
-    pool = find_page(pool); // TODO insert new page first, so we don't need to iterate over all pages.
+    struct abc_pool *head = pool;
+    pool = head->last;
     // init page if not already
     if (pool->capacity == 0) {
         alloc_page(pool, size, count);
@@ -56,11 +48,13 @@ void *abc_pool_alloc_aligned(struct abc_pool *pool, size_t size, size_t count, s
         // does not fit current page, create new and put it there
         pool->next = malloc(sizeof(struct abc_pool));
         pool = pool->next;
-        pool->next = NULL;
         if (pool == NULL) {
             fprintf(stderr, "pool allocation failed %s\n", __FILE__);
             exit(EXIT_FAILURE);
         }
+        pool->next = NULL;
+        pool->last = NULL;
+        head->last = pool;
         alloc_page(pool, size, count);
         pool->offset = offset;
         return pool->data;
@@ -69,6 +63,13 @@ void *abc_pool_alloc_aligned(struct abc_pool *pool, size_t size, size_t count, s
     return pool->data + start;
 }
 
+void abc_pool_merge(struct abc_pool *pool, struct abc_pool *other) {
+    assert(pool != NULL && other != NULL);
+    pool->last->next = other;
+    pool->last = other->last;
+    other->last = NULL;
+}
+
 void abc_pool_destroy(struct abc_pool *pool) {
     for (struct abc_pool *p = pool; p != NULL; /* none */) {
         free(p->data);
@@ -15,6 +15,7 @@ struct abc_pool {
   size_t capacity;
   size_t offset;
   struct abc_pool *next;
+  struct abc_pool *last; // last page, only maintained in the first page
 };
 
 /*
@@ -32,6 +33,11 @@ void *abc_pool_alloc(struct abc_pool *pool, size_t size, size_t count);
  */
 void *abc_pool_alloc_aligned(struct abc_pool *pool, size_t size, size_t count, size_t alignment);
 
+/*
+ * Move all pages of other into pool, other is consumed and its allocations now live as long as pool.
+ */
+void abc_pool_merge(struct abc_pool *pool, struct abc_pool *other);
+
 /*
  * Destroy pool and all allocations made with it.
  */
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,7 +8,17 @@
 #include "abc_parser.h"
 #include "abc_typechecker.h"
 #include "codegen/ir.h"
+#include "codegen/ir_dce.h"
+#include "codegen/ir_fold.h"
+#include "codegen/ir_gvn.h"
+#include "codegen/ir_inline.h"
+#include "codegen/ir_iv.h"
+#include "codegen/ir_licm.h"
+#include "codegen/ir_sccp.h"
+#include "codegen/ir_ssa.h"
+#include "codegen/ir_tailcall.h"
 #include "codegen/x64.h"
+#include "data/abc_parallel.h"
 
 #define OUTPUT_FILE_MAX_LEN 100
 
@@ -16,6 +27,15 @@ struct compile_options {
     bool print_ir;
     bool print_x64;
     bool skip_output;
+    bool token_buffer;
+    size_t parse_threads; // 0 parses on the main thread only
+    size_t typecheck_threads; // 0 checks on the main thread only
+    bool lazy;
+    bool check_unreachable;
+    bool fused; // typecheck while translating to ir
+    bool ssa; // go through ssa form between ir translation and codegen
+    bool optimize; // run the ir optimizations, in ssa form
+    long inline_threshold; // largest cost of a call inlined when optimizing, 0 inlines nothing
     char *input_file;
     char *output_file;
 };
@@ -23,21 +43,42 @@ struct compile_options {
 void do_compile(struct compile_options *options);
 
 void usage(void) {
-    fprintf(stderr, "usage ./ablc <input_file.al> [--print-ast] [--print-ir] [--print-asm] "
-                    "<--skip-output | --output outputfile>\n");
+    fprintf(stderr, "usage ./ablc <input_file.al> [--print-ast] [--print-ir] [--print-asm] [--token-buffer] "
+                    "[--parse-threads n] [--typecheck-threads n] [--lazy] [--check-unreachable] [--fused] "
+                    "[--ssa] [--optimize] [--inline-threshold n] <--skip-output | --output outputfile>\n");
     exit(EXIT_FAILURE);
 }
 
+// The value of a numeric option, anything but a whole non-negative decimal number prints the usage.
+static long parse_count(const char *arg) {
+    char *end;
+    errno = 0;
+    long n = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno == ERANGE || n < 0) {
+        usage();
+    }
+    return n;
+}
+
 int main(int argc, char **argv) {
-    struct compile_options compile_options = {0};
+    struct compile_options compile_options = {.inline_threshold = IR_INLINE_THRESHOLD};
     struct option options[] = {{.flag = NULL, .val = 'a', .has_arg = false, .name = "print-ast"},
                                {.flag = NULL, .val = 'i', .has_arg = false, .name = "print-ir"},
                                {.flag = NULL, .val = 'x', .has_arg = false, .name = "print-asm"},
                                {.flag = NULL, .val = 's', .has_arg = false, .name = "skip-output"},
                                {.flag = NULL, .val = 'o', .has_arg = required_argument, .name = "output"},
+                               {.flag = NULL, .val = 't', .has_arg = false, .name = "token-buffer"},
+                               {.flag = NULL, .val = 'j', .has_arg = required_argument, .name = "parse-threads"},
+                               {.flag = NULL, .val = 'T', .has_arg = required_argument, .name = "typecheck-threads"},
+                               {.flag = NULL, .val = 'l', .has_arg = false, .name = "lazy"},
+                               {.flag = NULL, .val = 'c', .has_arg = false, .name = "check-unreachable"},
+                               {.flag = NULL, .val = 'f', .has_arg = false, .name = "fused"},
+                               {.flag = NULL, .val = 'S', .has_arg = false, .name = "ssa"},
+                               {.flag = NULL, .val = 'O', .has_arg = false, .name = "optimize"},
+                               {.flag = NULL, .val = 'I', .has_arg = required_argument, .name = "inline-threshold"},
                                {0, 0, 0, 0}};
     int c;
-    while ((c = getopt_long(argc, argv, "aixso:", options, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "aixso:tj:T:lcfSOI:", options, NULL)) != -1) {
         switch (c) {
             case 'a':
                 compile_options.print_ast = true;
@@ -54,6 +95,41 @@ int main(int argc, char **argv) {
             case 'o':
                 compile_options.output_file = optarg;
                 break;
+            case 't':
+                compile_options.token_buffer = true;
+                break;
+            case 'j':
+                compile_options.parse_threads = (size_t) parse_count(optarg);
+                if (compile_options.parse_threads == 0) {
+                    compile_options.parse_threads = abc_parallel_cpus();
+                }
+                break;
+            case 'T':
+                compile_options.typecheck_threads = (size_t) parse_count(optarg);
+                if (compile_options.typecheck_threads == 0) {
+                    compile_options.typecheck_threads = abc_parallel_cpus();
+                }
+                break;
+            case 'l':
+                compile_options.lazy = true;
+                break;
+            case 'c':
+                compile_options.lazy = true;
+                compile_options.check_unreachable = true;
+                break;
+            case 'f':
+                compile_options.fused = true;
+                break;
+            case 'S':
+                compile_options.ssa = true;
+                break;
+            case 'O':
+                compile_options.optimize = true;
+                compile_options.ssa = true;
+                break;
+            case 'I':
+                compile_options.inline_threshold = parse_count(optarg);
+                break;
             default:
                 usage();
         }
@@ -75,8 +151,22 @@ void do_compile(struct compile_options *options) {
         exit(EXIT_FAILURE);
     }
     struct abc_parser parser;
-    abc_parser_init(&parser, &lexer);
-    struct abc_program program = abc_parser_parse(&parser);
+    struct abc_token_buf tokens;
+    if (options->token_buffer || options->parse_threads > 0 || options->lazy) {
+        abc_lexer_tokenize(&lexer, &tokens);
+        abc_parser_init_tokens(&parser, &lexer, &tokens);
+    } else {
+        abc_parser_init(&parser, &lexer);
+    }
+    struct abc_program program;
+    if (options->lazy) {
+        size_t threads = options->parse_threads > 0 ? options->parse_threads : 1;
+        program = abc_parser_parse_lazy(&parser, threads, options->check_unreachable);
+    } else if (options->parse_threads > 0) {
+        program = abc_parser_parse_parallel(&parser, options->parse_threads);
+    } else {
+        program = abc_parser_parse(&parser);
+    }
     if (parser.has_error) {
         fprintf(stderr, "failed to parse program\n");
         exit(EXIT_FAILURE);
@@ -85,10 +175,15 @@ void do_compile(struct compile_options *options) {
         abc_parser_print(&program, stdout);
     }
 
-    // typechecker
-    if (!abc_typechecker_typecheck(&program)) {
-        fprintf(stderr, "typecheck failed, exiting\n");
-        exit(EXIT_FAILURE);
+    // typechecker, done during ir translation when fused
+    if (!options->fused) {
+        bool typechecked = options->typecheck_threads > 0
+                                   ? abc_typechecker_typecheck_parallel(&program, options->typecheck_threads)
+                                   : abc_typechecker_typecheck(&program);
+        if (!typechecked) {
+            fprintf(stderr, "typecheck failed, exiting\n");
+            exit(EXIT_FAILURE);
+        }
     }
     if (parser.has_error || lexer.has_error) {
         fprintf(stderr, "skipping code generation because of parser/lexer errors\n");
@@ -98,10 +193,33 @@ void do_compile(struct compile_options *options) {
     // ir
     struct ir_translator ir_translator;
     ir_translator_init(&ir_translator);
+    ir_translator.check = options->fused;
     struct ir_program ir_program = ir_translate(&ir_translator, &program);
+    if (ir_translator.has_error) {
+        fprintf(stderr, "typecheck failed, exiting\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->optimize) {
+        ir_tailcall_program(&ir_program, ir_translator.pool);
+        ir_inline_program(&ir_program, options->inline_threshold, ir_translator.pool);
+    }
+    if (options->ssa) {
+        ir_ssa_construct(&ir_program, ir_translator.pool);
+    }
+    if (options->optimize) {
+        ir_fold_program(&ir_program);
+        ir_sccp_program(&ir_program);
+        ir_gvn_program(&ir_program);
+        ir_licm_program(&ir_program, ir_translator.pool);
+        ir_iv_program(&ir_program, ir_translator.pool);
+        ir_dce_program(&ir_program);
+    }
     if (options->print_ir) {
         ir_program_print(&ir_program, stdout);
     }
+    if (options->ssa) {
+        ir_ssa_destruct(&ir_program, ir_translator.pool);
+    }
 
     // codegen
     struct x64_translator x64_translator;
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Compiles a test program with ablc, links it and compares what it prints with the .out file next to it.
+# usage: check.sh <ablc> <program.al> [ablc options]
+set -e
+ablc=$1
+program=$2
+shift 2
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+"$ablc" "$program" --output "$dir/prog.s" "$@"
+cc -no-pie "$dir/prog.s" -o "$dir/prog"
+# main is void, so the exit status is whatever was left in rax
+"$dir/prog" > "$dir/prog.out" || true
+diff -u "${program%.al}.out" "$dir/prog.out"
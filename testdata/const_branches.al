@@ -0,0 +1,26 @@
+int steps(int n, int verbose) {
+    int mode = 1;
+    int total = 0;
+    int i = 0;
+    while (i < n) {
+        if (mode != 1) {
+            mode = 2;
+        }
+        if (mode == 1) {
+            total = total + i;
+        } else {
+            total = total - i;
+        }
+        if (verbose > 0) {
+            print(i);
+        }
+        i = i + 1;
+    }
+    print(mode);
+    return total;
+}
+
+void main() {
+    print(steps(5, 0));
+    print(steps(3, 1));
+}
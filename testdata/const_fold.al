@@ -0,0 +1,12 @@
+void main() {
+    int a = 6;
+    int b = a * 7;
+    print(b - 2 * 3);
+    if (b > 40) {
+        print(1);
+    } else {
+        print(0);
+    }
+    print((0 - 9) / 2);
+    print(0 - 9 / 2 * 2);
+}
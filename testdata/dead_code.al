@@ -0,0 +1,21 @@
+int noisy(int x) {
+    print(x);
+    return x * 2;
+}
+
+int work(int a, int b) {
+    int unused = a * b + 7;
+    int dropped = noisy(a);
+    int quotient = a / b;
+    int checked = 100 / b;
+    if (a > 100) {
+        return quotient;
+    }
+    return b;
+    print(999);
+}
+
+void main() {
+    print(work(3, 1));
+    print(work(200, 10));
+}
@@ -0,0 +1,22 @@
+void main() {
+    int x = 4;
+    if (x > 1) {
+        print(1);
+    }
+    if (x > 2) {
+        print(2);
+    }
+    if (x > 3) {
+        print(3);
+    }
+    if (x > 4) {
+        print(4);
+    }
+    if (x > 5) {
+        print(5);
+    }
+    if (x > 6) {
+        print(6);
+    }
+    print(x);
+}
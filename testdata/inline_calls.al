@@ -0,0 +1,70 @@
+int scale(int x, int mode) {
+    if (mode == 0) {
+        return x;
+    }
+    if (mode == 1) {
+        return x * 2;
+    }
+    if (mode == 2) {
+        return x * 3;
+    }
+    if (mode == 3) {
+        return x * 4;
+    }
+    if (mode == 4) {
+        return x * 5;
+    }
+    return 0 - x;
+}
+
+int square(int x) {
+    return x * x;
+}
+
+int report(int a, int b, int c) {
+    int s = a + b + c;
+    print(s);
+    int m = a;
+    if (b > m) {
+        m = b;
+    }
+    if (c > m) {
+        m = c;
+    }
+    print(m);
+    int n = a;
+    if (b < n) {
+        n = b;
+    }
+    if (c < n) {
+        n = c;
+    }
+    print(n);
+    int d = a - b;
+    if (d < 0) {
+        d = 0 - d;
+    }
+    return s * m + d;
+}
+
+int sumto(int n) {
+    if (n == 0) {
+        return 0;
+    }
+    return n + sumto(n - 1);
+}
+
+void main() {
+    print(scale(7, 0));
+    print(scale(7, 2));
+    print(scale(7, 9));
+    int total = 0;
+    int i = 0;
+    while (i < 5) {
+        total = total + square(i);
+        i = i + 1;
+    }
+    print(total);
+    print(report(3, 8, 5));
+    print(sumto(10));
+}
@@ -0,0 +1,29 @@
+int guarded(int n, int d) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        if (d != 0) {
+            s = s + 100 / d;
+        }
+        s = s + n * 3;
+        i = i + 1;
+    }
+    return s;
+}
+
+int header(int n, int d) {
+    int s = 0;
+    int i = 0;
+    while (i < n / d) {
+        s = s + i;
+        i = i + 1;
+    }
+    return s;
+}
+
+void main() {
+    print(guarded(4, 5));
+    print(guarded(3, 0));
+    print(guarded(0, 0));
+    print(header(20, 4));
+}
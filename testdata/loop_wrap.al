@@ -0,0 +1,43 @@
+int f(int n) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        if (i == 5) {
+            return s;
+        }
+        s = s + i * 3;
+        i = i + 1;
+    }
+    return s;
+}
+
+void main() {
+    print(f(4000000000000000000));
+    int n = 4000000000000000000;
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        if (i == 5) {
+            print(s);
+            n = 0;
+        } else {
+            s = s + i * 3;
+            i = i + 1;
+        }
+    }
+    int k = 4611686018427387904;
+    int t = 0;
+    int j = 1;
+    while (j < 3) {
+        t = t + j * k;
+        j = j + 1;
+    }
+    print(t);
+    int e = 0;
+    j = 0;
+    while (j != 4) {
+        e = e + j * 4611686018427387904;
+        j = j + 1;
+    }
+    print(e);
+}
@@ -0,0 +1,17 @@
+int rem(int a, int b) {
+    return a - a / b * b;
+}
+
+void main() {
+    int a = 0 - 7;
+    int b = 2;
+    print(a / b);
+    print(rem(a, b));
+    print(7 / (0 - b));
+    print(rem(7, 0 - b));
+    print(a / (0 - b));
+    print(rem(a, 0 - b));
+    int big = 0 - 1000000007;
+    print(big / 3);
+    print(rem(big, 3));
+}
@@ -0,0 +1,42 @@
+int f(int a, int b) {
+    int r = 0;
+    while (a > 0) {
+        int j = 0;
+        while (j < b) {
+            r = r + a * j;
+            j = j + 1;
+        }
+        a = a - 1;
+    }
+    return r;
+}
+
+int g(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return g(n - 1) + g(n - 2);
+}
+
+void h(int x) {
+    if (x > 3) {
+        print(x);
+        return;
+    }
+    print(0 - x);
+}
+
+void main() {
+    print(f(5, 4));
+    print(g(12));
+    h(2);
+    h(9);
+    int t = 1;
+    int u = t;
+    t = t + 1;
+    print(t + u);
+    int q = 8;
+    int w = q / 2 + q / 2;
+    print(w);
+    print(((((1 + 2) * 3) - 4) * (5 + 6)));
+}
@@ -0,0 +1,18 @@
+int second(int a, int b) {
+    return b;
+}
+
+int third(int a, int b, int c) {
+    int x = c * 2;
+    return x + b;
+}
+
+int last(int a, int b, int c, int d, int e, int f) {
+    return f - e;
+}
+
+void main() {
+    print(second(1, 2));
+    print(third(1, 2, 3));
+    print(last(1, 2, 3, 4, 5, 7));
+}
@@ -0,0 +1,19 @@
+int mix(int a, int b) {
+    int s = a * b + 1;
+    if (a > b) {
+        int t = b * a + 1;
+        return s + t;
+    }
+    int u = a * b;
+    if (u > 10) {
+        int v = a * b + 1;
+        return v - s;
+    }
+    return u + s;
+}
+
+void main() {
+    print(mix(5, 3));
+    print(mix(3, 5));
+    print(mix(1, 2));
+}
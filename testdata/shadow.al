@@ -0,0 +1,29 @@
+int f(int a) {
+    int b = a + 1;
+    {
+        int a = 10;
+        b = b + a;
+    }
+    return b + a;
+}
+
+void main() {
+    int a = 1;
+    {
+        int a = 2;
+        print(a);
+        {
+            int a = 3;
+            print(a);
+        }
+        print(a);
+    }
+    print(a);
+    print(f(5));
+    int b = 7;
+    while (b > 5) {
+        int c = b;
+        print(c);
+        b = b - 1;
+    }
+}
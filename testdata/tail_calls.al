@@ -0,0 +1,29 @@
+int sum(int n, int acc) {
+    if (n == 0) {
+        return acc;
+    }
+    return sum(n - 1, acc + n);
+}
+
+int spread(int a, int b, int c, int d, int e, int f, int g, int h) {
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8;
+}
+
+int rotate(int n, int a, int b, int c, int d, int e, int f, int g) {
+    if (n == 0) {
+        return spread(g, f, e, d, c, b, a, n);
+    }
+    return rotate(n - 1, g, a, b, c, d, e, f + 1);
+}
+
+int wide(int a, int b, int c, int d, int e, int f, int g) {
+    int x = spread(a, b, c, d, e, f, g, 1);
+    return spread(x, a, b, c, d, e, f, g);
+}
+
+void main() {
+    print(sum(10000000, 0));
+    print(rotate(10000000, 1, 2, 3, 4, 5, 6, 7));
+    print(spread(8, 7, 6, 5, 4, 3, 2, 1));
+    print(wide(1, 2, 3, 4, 5, 6, 7));
+}